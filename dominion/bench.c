@@ -0,0 +1,486 @@
+/* Engine benchmark harness.
+
+   Runs each benchmark with the hardware performance counters from
+   perfctr.c around it and reports time, cycles, IPC, cache and branch
+   misses per game and per engine operation.  Counters that are not
+   available (containers, VMs) are shown as "-".  Ends with the rate of
+   playouts (playout.h) against whole engine games, and the memory and
+   speed of search tree branching with zone states (zones.h) against
+   copying gameStates, the cost of action sequencing (sequence.h), and
+   of building a buy table (buyplan.h) against looking a purchase up.
+
+   Usage: bench [games] [seed] */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include "buyplan.h"
+#include "dominion.h"
+#include "dominion_helpers.h"
+#include "perfctr.h"
+#include "playout.h"
+#include "pool.h"
+#include "rngs.h"
+#include "sequence.h"
+#include "statekey.h"
+#include "zones.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define MAX_TURNS 1000
+#define TREE_NODES 64
+
+static int kingdom[10] = {adventurer, gardens, embargo, village, minion, mine,
+                          cutpurse, sea_hag, tribute, smithy
+                         };
+
+static int handMoney(struct gameState *G) {
+    int i, money = 0;
+    for (i = 0; i < numHandCards(G); i++) {
+        if (handCard(i, G) == copper)
+            money++;
+        else if (handCard(i, G) == silver)
+            money += 2;
+        else if (handCard(i, G) == gold)
+            money += 3;
+    }
+    return money;
+}
+
+static int findInHand(struct gameState *G, int card) {
+    int i;
+    for (i = 0; i < numHandCards(G); i++) {
+        if (handCard(i, G) == card)
+            return i;
+    }
+    return -1;
+}
+
+//the two bots from playdom.c, without the printing; returns engine calls made
+static long long botTurn(struct gameState *G, int owned[MAX_PLAYERS]) {
+    int player = whoseTurn(G);
+    int action = player == 0 ? smithy : adventurer;
+    int pos = findInHand(G, action);
+    int money;
+    long long ops = 0;
+
+    if (pos != -1) {
+        playCard(pos, -1, -1, -1, G);
+        ops++;
+    }
+
+    money = handMoney(G);
+    if (money >= 8) {
+        buyCard(province, G);
+        ops++;
+    }
+    else if (money >= 6 && player == 1 && owned[player] < 2) {
+        buyCard(adventurer, G);
+        owned[player]++;
+        ops++;
+    }
+    else if (money >= 6) {
+        buyCard(gold, G);
+        ops++;
+    }
+    else if (money >= 4 && player == 0 && owned[player] < 2) {
+        buyCard(smithy, G);
+        owned[player]++;
+        ops++;
+    }
+    else if (money >= 3) {
+        buyCard(silver, G);
+        ops++;
+    }
+
+    endTurn(G);
+    return ops + 1;
+}
+
+static long long benchGames(int reps, int seed) {
+    struct gameState *G;
+    int owned[MAX_PLAYERS];
+    int n, turn;
+    long long ops = 0;
+
+    for (n = 0; n < reps; n++) {
+        G = poolAcquire();
+        memset(owned, 0, sizeof(owned));
+        initializeGame(2, kingdom, seed + n, G);
+        ops++;
+        for (turn = 0; turn < MAX_TURNS && !isGameOver(G); turn++) {
+            ops += botTurn(G, owned) + 1;
+        }
+        poolRelease(G);
+    }
+    return ops;
+}
+
+//the same kingdom played out from template starts by big money bots
+static long long benchPlayouts(int reps, int seed) {
+    struct gameState *G = poolAcquire();
+    struct gameTemplate T;
+    struct playoutRng rng;
+    long long turns = 0;
+    int n;
+
+    initializeGameTemplate(2, kingdom, &T);
+    for (n = 0; n < reps; n++) {
+        memset(G, 0, sizeof(struct gameState));
+        initializeGameFromTemplate(&T, seed + n, G);
+        playoutSeed(&rng, seed + n);
+        turns += playoutToEnd(G, &playoutBigMoneyPolicy, &rng);
+    }
+    poolRelease(G);
+    return turns;
+}
+
+//canonical keys of the positions at the start of every turn of the
+//bench games, kept for the footprint line
+static struct keySet *positions;
+
+static long long benchStateKeys(int reps, int seed) {
+    struct gameState *G;
+    unsigned char key[STATE_KEY_MAX];
+    int owned[MAX_PLAYERS];
+    int n, turn;
+    long long keys = 0;
+
+    keySetFree(positions);
+    positions = keySetNew(reps * 30);
+    for (n = 0; n < reps; n++) {
+        G = poolAcquire();
+        memset(owned, 0, sizeof(owned));
+        initializeGame(2, kingdom, seed + n, G);
+        for (turn = 0; turn < MAX_TURNS && !isGameOver(G); turn++) {
+            keySetAdd(positions, key, stateKey(G, key));
+            keys++;
+            botTurn(G, owned);
+        }
+        poolRelease(G);
+    }
+    return keys;
+}
+
+static long long benchInitialize(int reps, int seed) {
+    struct gameState G;
+    int n;
+
+    for (n = 0; n < reps; n++) {
+        initializeGame(2, kingdom, seed + n, &G);
+    }
+    return reps;
+}
+
+static long long benchFromTemplate(int reps, int seed) {
+    struct gameState G;
+    struct gameTemplate T;
+    int n;
+
+    initializeGameTemplate(2, kingdom, &T);
+    for (n = 0; n < reps; n++) {
+        initializeGameFromTemplate(&T, seed + n, &G);
+    }
+    return reps;
+}
+
+static long long benchShuffle(int reps, int seed) {
+    struct gameState G;
+    int n;
+
+    initializeGame(2, kingdom, seed, &G);
+    //a mid-game sized deck: the starting cards plus 20 gains
+    for (n = G.deckCount[0]; n < 30; n++) {
+        G.deck[0][n] = n % 2 ? silver : smithy;
+    }
+    G.deckCount[0] = 30;
+    for (n = 0; n < reps; n++) {
+        shuffle(0, &G);
+    }
+    return reps;
+}
+
+static long long benchDrawDiscard(int reps, int seed) {
+    struct gameState G;
+    int n, i;
+
+    initializeGame(2, kingdom, seed, &G);
+    for (n = 0; n < reps; n++) {
+        for (i = 0; i < 5; i++) {
+            drawCard(0, &G);
+        }
+        while (G.handCount[0] > 0) {
+            discardCard(0, 0, &G, 0);
+        }
+    }
+    return (long long)reps * 10;
+}
+
+static long long benchEndTurn(int reps, int seed) {
+    struct gameState G;
+    int n;
+
+    initializeGame(2, kingdom, seed, &G);
+    for (n = 0; n < reps; n++) {
+        endTurn(&G);
+    }
+    return reps;
+}
+
+//a position ten turns into a bench game
+static void midGame(int seed, struct gameState *G) {
+    int owned[MAX_PLAYERS] = {0};
+    int turn;
+
+    memset(G, 0, sizeof(struct gameState));
+    initializeGame(2, kingdom, seed, G);
+    for (turn = 0; turn < 10; turn++) {
+        botTurn(G, owned);
+    }
+}
+
+//search tree growth: every node is a branch of a random earlier one with
+//a card in hand and one in the deck changed, all kept until the tree is
+//done; as whole gameState copies and as zone states (zones.h)
+static long long benchBranchCopy(int reps, int seed) {
+    struct gameState *tree[TREE_NODES];
+    struct gameState root;
+    int n, i, player;
+
+    midGame(seed, &root);
+    player = whoseTurn(&root);
+    for (n = 0; n < reps; n++) {
+        tree[0] = poolAcquire();
+        memcpy(tree[0], &root, sizeof(struct gameState));
+        for (i = 1; i < TREE_NODES; i++) {
+            tree[i] = poolAcquire();
+            memcpy(tree[i], tree[(i * 7 + n) % i], sizeof(struct gameState));
+            tree[i]->hand[player][i % tree[i]->handCount[player]] = i % (treasure_map + 1);
+            tree[i]->deck[player][i % tree[i]->deckCount[player]] = i % (treasure_map + 1);
+        }
+        for (i = 0; i < TREE_NODES; i++) {
+            poolRelease(tree[i]);
+        }
+    }
+    return (long long)reps * (TREE_NODES - 1);
+}
+
+//bytes held per node of the last zone tree
+static double zoneNodeBytes, zoneChunksPerBranch;
+
+static long long benchBranchZones(int reps, int seed) {
+    struct zoneState *tree[TREE_NODES];
+    struct zoneStats before, after;
+    struct gameState root;
+    int n, i, player;
+
+    midGame(seed, &root);
+    player = whoseTurn(&root);
+    for (n = 0; n < reps; n++) {
+        zoneGetStats(&before);
+        tree[0] = zoneCapture(&root, NULL);
+        for (i = 1; i < TREE_NODES; i++) {
+            tree[i] = zoneBranch(tree[(i * 7 + n) % i]);
+            zoneSetCard(tree[i], ZONE_HAND(player), i % zoneCount(tree[i], ZONE_HAND(player)),
+                        i % (treasure_map + 1));
+            zoneSetCard(tree[i], ZONE_DECK(player), i % zoneCount(tree[i], ZONE_DECK(player)),
+                        i % (treasure_map + 1));
+        }
+        zoneGetStats(&after);
+        zoneNodeBytes = (double)(after.bytes - before.bytes) / TREE_NODES;
+        zoneChunksPerBranch = (double)(after.chunksCopied - before.chunksCopied) / TREE_NODES;
+        for (i = 0; i < TREE_NODES; i++) {
+            zoneFree(tree[i]);
+        }
+    }
+    return (long long)reps * (TREE_NODES - 1);
+}
+
+//action sequencing (sequence.h) in a deck with villages and smithies:
+//a new sequencer's first query, and queries it has seen before
+static long long benchSequenceFirst(int reps, int seed) {
+    struct drawOdds odds = {20, {2, 1, 2, 0, 0}, 10, 13};
+    int held[SEQ_KINDS] = {1, 0, 1, 0, 0};
+    struct sequencer *s;
+    struct seqPlan plan;
+    int n;
+
+    (void)seed;
+    for (n = 0; n < reps; n++) {
+        odds.cards = 16 + n % 16;
+        s = sequencerNew(&odds, 2.0);
+        sequencerPlan(s, held, 1, SEQ_MAX_DRAWS, &plan);
+        sequencerFree(s);
+    }
+    return reps;
+}
+
+static long long benchSequenceMemo(int reps, int seed) {
+    struct drawOdds odds = {20, {2, 1, 2, 0, 0}, 10, 13};
+    int held[SEQ_KINDS] = {1, 0, 1, 0, 0};
+    struct sequencer *s = sequencerNew(&odds, 2.0);
+    struct seqPlan plan;
+    int n;
+
+    (void)seed;
+    for (n = 0; n < reps; n++) {
+        held[0] = n % 2;
+        held[2] = 1 + n % 3;
+        sequencerPlan(s, held, 1 + n % 2, SEQ_MAX_DRAWS - n % 4, &plan);
+    }
+    sequencerFree(s);
+    return reps;
+}
+
+//buy planning (buyplan.h): a kingdom's table, and lookups in it
+static int benchBuyValue(int card, void *ctx) {
+    (void)ctx;
+    return card == province ? 100 : card == gold ? 30 : card == silver ? 10 : card == smithy ? 12 : 0;
+}
+
+static long long benchBuyBuild(int reps, int seed) {
+    static struct buyTable table;
+    struct gameTemplate T;
+    int n;
+
+    (void)seed;
+    initializeGameTemplate(2, kingdom, &T);
+    for (n = 0; n < reps; n++) {
+        buyTableBuild(&table, T.supplyCount, benchBuyValue, NULL);
+    }
+    return reps;
+}
+
+static long long benchBuyLookup(int reps, int seed) {
+    static struct buyTable table;
+    struct gameTemplate T;
+    long long spent = 0;
+    int n;
+
+    initializeGameTemplate(2, kingdom, &T);
+    buyTableBuild(&table, T.supplyCount, benchBuyValue, NULL);
+    for (n = 0; n < reps; n++) {
+        spent += buyTableLookup(&table, (seed + n) % 16, 1 + n % 3)->cost;
+    }
+    return spent >= 0 ? reps : 0;
+}
+
+struct benchmark {
+    const char *name;
+    long long (*run)(int reps, int seed);
+    int repsPerGame; //how many reps make up one "game" row
+};
+
+static struct benchmark benchmarks[] = {
+    {"game", benchGames, 1},
+    {"playout", benchPlayouts, 1},
+    {"stateKey", benchStateKeys, 1},
+    {"branch copy", benchBranchCopy, 1},
+    {"branch zones", benchBranchZones, 1},
+    {"sequence first", benchSequenceFirst, 1},
+    {"sequence memo", benchSequenceMemo, 40},
+    {"buy table", benchBuyBuild, 1},
+    {"buy lookup", benchBuyLookup, 40},
+    {"initializeGame", benchInitialize, 1},
+    {"fromTemplate", benchFromTemplate, 1},
+    {"shuffle", benchShuffle, 20},
+    {"draw+discard", benchDrawDiscard, 40},
+    {"endTurn", benchEndTurn, 40},
+};
+
+static void printRatios(const char *name, const char *unit, double count,
+                        struct perfCounters *pc) {
+    int i;
+
+    printf("%-16s %-5s %12.0f %10.1f", name, unit, count, pc->nanoseconds / count);
+    for (i = 0; i < PERF_NUM_COUNTERS; i++) {
+        if (pc->measured[i])
+            printf(" %13.2f", pc->value[i] / count);
+        else
+            printf(" %13s", "-");
+    }
+    if (pc->measured[PERF_CYCLES] && pc->measured[PERF_INSTRUCTIONS] &&
+            pc->value[PERF_CYCLES] > 0)
+        printf(" %6.2f\n", (double)pc->value[PERF_INSTRUCTIONS] / pc->value[PERF_CYCLES]);
+    else
+        printf(" %6s\n", "-");
+}
+
+int main(int argc, char** argv) {
+    struct perfCounters pc;
+    struct poolStats before, after;
+    int games = 1000;
+    int seed = 1;
+    int available, b, i;
+    long long ops;
+    double gameNs = 0, playoutNs = 0, copyNs = 0, zoneNs = 0, firstNs = 0, memoNs = 0;
+    double buildNs = 0, lookupNs = 0;
+
+    if (argc > 1)
+        games = atoi(argv[1]);
+    if (argc > 2)
+        seed = atoi(argv[2]);
+    if (games < 1 || seed < 1) {
+        printf("Usage: bench [games] [seed]\n");
+        return 1;
+    }
+
+    available = perfOpen(&pc);
+    if (available < PERF_NUM_COUNTERS) {
+        printf("note: %d of %d hardware counters available", available, PERF_NUM_COUNTERS);
+        printf(available == 0 ? " (no perf access?), timing only\n" : "\n");
+    }
+
+    printf("%-16s %-5s %12s %10s", "benchmark", "per", "count", "ns");
+    for (i = 0; i < PERF_NUM_COUNTERS; i++)
+        printf(" %13s", perfCounterName(i));
+    printf(" %6s\n", "IPC");
+
+    for (b = 0; b < (int)(sizeof(benchmarks) / sizeof(benchmarks[0])); b++) {
+        int reps = games * benchmarks[b].repsPerGame;
+
+        benchmarks[b].run(reps / 10 + 1, seed); //warm up
+        poolGetStats(&before);
+        perfStart(&pc);
+        ops = benchmarks[b].run(reps, seed);
+        perfStop(&pc);
+        poolGetStats(&after);
+
+        if (benchmarks[b].run == benchGames)
+            gameNs = pc.nanoseconds;
+        if (benchmarks[b].run == benchPlayouts)
+            playoutNs = pc.nanoseconds;
+        if (benchmarks[b].run == benchBranchCopy)
+            copyNs = pc.nanoseconds;
+        if (benchmarks[b].run == benchBranchZones)
+            zoneNs = pc.nanoseconds;
+        if (benchmarks[b].run == benchSequenceFirst)
+            firstNs = pc.nanoseconds;
+        if (benchmarks[b].run == benchSequenceMemo)
+            memoNs = pc.nanoseconds;
+        if (benchmarks[b].run == benchBuyBuild)
+            buildNs = pc.nanoseconds;
+        if (benchmarks[b].run == benchBuyLookup)
+            lookupNs = pc.nanoseconds;
+        printRatios(benchmarks[b].name, "game", (double)games, &pc);
+        printRatios("", "op", (double)ops, &pc);
+        if (after.slabs != before.slabs) {
+            printf("%-16s %lld pool slabs allocated after warm-up\n", "", after.slabs - before.slabs);
+        }
+    }
+
+    printf("\n%lld distinct positions in %zu bytes, %.0f bytes each (a gameState is %zu)\n",
+           keySetCount(positions), keySetBytes(positions),
+           (double)keySetBytes(positions) / keySetCount(positions), sizeof(struct gameState));
+    printf("%.0f playouts/s (%.0f engine games/s)\n", games / (playoutNs / 1e9), games / (gameNs / 1e9));
+    printf("search tree nodes: %zu bytes each copied, %.0f as zones (%.1f chunks made per node); %.0f branches/s copied, %.0f as zones\n",
+           sizeof(struct gameState), zoneNodeBytes, zoneChunksPerBranch,
+           games * (TREE_NODES - 1) / (copyNs / 1e9), games * (TREE_NODES - 1) / (zoneNs / 1e9));
+    printf("action sequencing: %.0f us for a new sequencer's first query, %.2f us for one it has seen\n",
+           firstNs / games / 1e3, memoNs / (games * 40.0) / 1e3);
+    printf("buy planning: %.0f us to build a kingdom's table, %.3f us a lookup\n",
+           buildNs / games / 1e3, lookupNs / (games * 40.0) / 1e3);
+
+    perfClose(&pc);
+    return 0;
+}
@@ -0,0 +1,43 @@
+#ifndef _BOTPLUGIN_H
+#define _BOTPLUGIN_H
+
+#include "dominion.h"
+#include <stddef.h>
+
+/* Bot plugin ABI: the one header a bot kept outside this tree needs.
+
+   A plugin is a shared object exporting
+
+     const struct dominionBot* dominionBotEntry(void);
+
+   and is loaded by file name wherever a bot is named, e.g.
+   ./tournament -bots ./mybot.so,bigmoney or ./player 5 ./mybot.so.
+
+   The callbacks see the live game state, read-only; they get no copy and
+   no serialized form, so a plugin bot costs what a built-in one does.
+   Plugins must not call engine functions: the programs loading them do
+   not export them.  The state layout is part of the ABI, so a plugin
+   built against a different dominion.h is refused at load time. */
+
+#define DOMINION_BOT_ABI 1
+#define DOMINION_BOT_ENTRY "dominionBotEntry"
+
+struct dominionBot {
+    int abi;            /* DOMINION_BOT_ABI */
+    int stateSize;      /* sizeof(struct gameState) */
+    const char *name;
+
+    int (*action)(const struct gameState *state, int choices[3], void *ctx);
+    /* Hand position of the action card to play next, with its choices in
+       choices[0..2], or -1 to end the action phase */
+
+    int (*buy)(const struct gameState *state, void *ctx);
+    /* Card to buy next, or -1 to end the buy phase */
+
+    void *ctx;
+};
+
+#define DOMINION_BOT_INIT(name, action, buy, ctx) \
+    {DOMINION_BOT_ABI, (int)sizeof(struct gameState), name, action, buy, ctx}
+
+#endif
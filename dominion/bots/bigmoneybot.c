@@ -0,0 +1,41 @@
+/* Big Money as a bot plugin, built outside the engine:
+
+     gcc -shared -fpic -std=c99 -O2 -I.. -o bigmoneybot.so bigmoneybot.c
+
+   It reads the state directly, since plugins cannot call the engine. */
+
+#include "botplugin.h"
+
+static int bigMoneyAction(const struct gameState *state, int choices[3], void *ctx) {
+    (void)state;
+    (void)ctx;
+    choices[0] = choices[1] = choices[2] = -1;
+    return -1;
+}
+
+static int bigMoneyBuy(const struct gameState *state, void *ctx) {
+    int coins = state->coins;
+    int provinces = state->supplyCount[province];
+
+    (void)ctx;
+    if (coins >= 8 && provinces > 0)
+        return province;
+    if (coins >= 6 && provinces <= 2 && state->supplyCount[duchy] > 0)
+        return duchy;
+    if (coins >= 6 && state->supplyCount[gold] > 0)
+        return gold;
+    if (coins >= 5 && provinces <= 4 && state->supplyCount[duchy] > 0)
+        return duchy;
+    if (coins >= 3 && state->supplyCount[silver] > 0)
+        return silver;
+    if (coins >= 2 && provinces <= 2 && state->supplyCount[estate] > 0)
+        return estate;
+    return -1;
+}
+
+static const struct dominionBot bot =
+    DOMINION_BOT_INIT("bigmoney-plugin", bigMoneyAction, bigMoneyBuy, NULL);
+
+const struct dominionBot* dominionBotEntry(void) {
+    return &bot;
+}
@@ -0,0 +1,26 @@
+/* Serves one bot to a driver in another process (see ipcbot.h).
+
+   Usage: botserver <bot>          started by the driver for ipc:<command>
+          botserver -pipe <bot>    started by the driver for pipe:<command>
+
+   e.g. ./tournament -bots "ipc:./botserver smithy",bigmoney */
+
+#include "ipcbot.h"
+#include <stdio.h>
+#include <string.h>
+
+int main(int argc, char** argv) {
+    struct simBot *bot;
+    int pipes = argc == 3 && strcmp(argv[1], "-pipe") == 0;
+
+    if (argc != 2 + pipes) {
+        fprintf(stderr, "Usage: botserver [-pipe] <bot>\nbots: %s\n", simBotNames());
+        return 1;
+    }
+    bot = simFindBot(argv[1 + pipes]);
+    if (bot == NULL) {
+        fprintf(stderr, "unknown bot: %s (bots: %s)\n", argv[1 + pipes], simBotNames());
+        return 1;
+    }
+    return (pipes ? ipcBotServePipe(bot, 0, 1) : ipcBotServe(bot)) < 0 ? 1 : 0;
+}
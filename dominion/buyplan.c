@@ -0,0 +1,134 @@
+#include "buyplan.h"
+#include "dominion_helpers.h"
+#include <stdlib.h>
+#include <string.h>
+
+//is a better than b: worth more, then cheaper, then fewer cards
+static int better(const struct buyPlan *a, const struct buyPlan *b) {
+    if (a->value != b->value)
+        return a->value > b->value;
+    if (a->cost != b->cost)
+        return a->cost < b->cost;
+    return a->count < b->count;
+}
+
+static int taken(const struct buyPlan *plan, int card) {
+    int i, n = 0;
+
+    for (i = 0; i < plan->count; i++)
+        n += plan->cards[i] == card;
+    return n;
+}
+
+//plans for up to maxBuys cards and maxCoins coins from these piles: a
+//plan for b buys is the one for b - 1, or one of those for b - 1 buys
+//and fewer coins with a card more
+static void solve(struct buyPlan plan[BUY_MAX_BUYS + 1][BUY_MAX_COINS + 1],
+                  const int pile[treasure_map + 1], const int worth[treasure_map + 1],
+                  int maxBuys, int maxCoins) {
+    struct buyPlan next;
+    int b, c, card, cost;
+
+    memset(plan, 0, sizeof(struct buyPlan) * (BUY_MAX_BUYS + 1) * (BUY_MAX_COINS + 1));
+    for (b = 1; b <= maxBuys; b++) {
+        for (c = 0; c <= maxCoins; c++) {
+            plan[b][c] = plan[b - 1][c];
+            for (card = curse; card <= treasure_map; card++) {
+                cost = getCost(card);
+                if (worth[card] <= 0 || cost < 0 || cost > c ||
+                        taken(&plan[b - 1][c - cost], card) >= pile[card])
+                    continue;
+                next = plan[b - 1][c - cost];
+                next.cards[next.count++] = card;
+                next.cost += cost;
+                next.value += worth[card];
+                if (better(&next, &plan[b][c]))
+                    plan[b][c] = next;
+            }
+        }
+    }
+}
+
+void buyTableBuild(struct buyTable *table, const int supplyCount[treasure_map + 1],
+                   buyValue value, void *ctx) {
+    int pile[treasure_map + 1], worth[treasure_map + 1];
+    int card;
+
+    table->value = value;
+    table->ctx = ctx;
+    for (card = curse; card <= treasure_map; card++) {
+        table->inGame[card] = supplyCount[card] != -1;
+        pile[card] = table->inGame[card] ? BUY_MAX_BUYS : 0;
+        worth[card] = table->inGame[card] ? value(card, ctx) : 0;
+    }
+    solve(table->plan, pile, worth, BUY_MAX_BUYS, BUY_MAX_COINS);
+}
+
+const struct buyPlan* buyTableLookup(const struct buyTable *table, int coins, int buys) {
+    coins = coins < 0 ? 0 : coins > BUY_MAX_COINS ? BUY_MAX_COINS : coins;
+    buys = buys < 0 ? 0 : buys > BUY_MAX_BUYS ? BUY_MAX_BUYS : buys;
+    return &table->plan[buys][coins];
+}
+
+int buyTablePlan(const struct buyTable *table, struct gameState *state, int coins, int buys,
+                 struct buyPlan *plan) {
+    struct buyPlan scratch[BUY_MAX_BUYS + 1][BUY_MAX_COINS + 1];
+    int pile[treasure_map + 1], worth[treasure_map + 1];
+    const struct buyPlan *p = buyTableLookup(table, coins, buys);
+    int i, card;
+
+    for (i = 0; i < p->count; i++) {
+        if (taken(p, p->cards[i]) > state->supplyCount[p->cards[i]])
+            break;
+    }
+    if (i == p->count) {
+        *plan = *p;
+        return 1;
+    }
+
+    for (card = curse; card <= treasure_map; card++) {
+        pile[card] = state->supplyCount[card] > 0 ? state->supplyCount[card] : 0;
+        worth[card] = table->inGame[card] ? table->value(card, table->ctx) : 0;
+    }
+    coins = coins > BUY_MAX_COINS ? BUY_MAX_COINS : coins < 0 ? 0 : coins;
+    buys = buys > BUY_MAX_BUYS ? BUY_MAX_BUYS : buys < 0 ? 0 : buys;
+    solve(scratch, pile, worth, buys, coins);
+    *plan = scratch[buys][coins];
+    return 0;
+}
+
+//tables for the kingdoms and value functions asked for last, replaced
+//in turn
+static struct buyTable *kept[BUY_KEPT_TABLES];
+static int nextVictim;
+
+const struct buyTable* buyTableFor(struct gameState *state, buyValue value, void *ctx) {
+    int i, card;
+
+    for (i = 0; i < BUY_KEPT_TABLES; i++) {
+        if (kept[i] == NULL || kept[i]->value != value || kept[i]->ctx != ctx)
+            continue;
+        for (card = curse; card <= treasure_map; card++) {
+            if (kept[i]->inGame[card] != (state->supplyCount[card] != -1))
+                break;
+        }
+        if (card > treasure_map)
+            return kept[i];
+    }
+    if (kept[nextVictim] == NULL && (kept[nextVictim] = malloc(sizeof(struct buyTable))) == NULL)
+        return NULL;
+    buyTableBuild(kept[nextVictim], state->supplyCount, value, ctx);
+    i = nextVictim;
+    nextVictim = (nextVictim + 1) % BUY_KEPT_TABLES;
+    return kept[i];
+}
+
+void buyTableForget(void) {
+    int i;
+
+    for (i = 0; i < BUY_KEPT_TABLES; i++) {
+        free(kept[i]);
+        kept[i] = NULL;
+    }
+    nextVictim = 0;
+}
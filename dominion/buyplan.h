@@ -0,0 +1,64 @@
+#ifndef _BUYPLAN_H
+#define _BUYPLAN_H
+
+#include "dominion.h"
+
+/* Buy phase planning.
+
+   With more than one buy the best purchase is a small knapsack: up to
+   buys cards from the supply, costing at most coins together, worth the
+   most under a value function.  A buyTable holds the answer for every
+   (coins, buys) pair of one kingdom, so a turn only looks it up.  Among
+   purchases worth the same the cheapest is kept, so the plans for fewer
+   coins at the same buys are the rest of the value/cost frontier.
+
+   Values are per card and add up; a card worth 0 or less is never
+   bought.  Tables are worked out from a supply the game starts with (a
+   gameTemplate's, or a state's), once per kingdom: cards out of the game
+   are left out, piles are assumed to hold at least BUY_MAX_BUYS cards.
+   buyTablePlan checks the piles a plan takes from and works the purchase
+   out again from the state's supply when one has run short. */
+
+#define BUY_MAX_BUYS 4
+#define BUY_MAX_COINS 32    /* more coins are planned as this many */
+#define BUY_KEPT_TABLES 8   /* tables buyTableFor keeps */
+
+typedef int (*buyValue)(int card, void *ctx);
+
+struct buyPlan {
+    int count;                  //cards to buy, 0 for none
+    int cards[BUY_MAX_BUYS];
+    int cost;
+    int value;
+};
+
+struct buyTable {
+    buyValue value;
+    void *ctx;
+    int inGame[treasure_map + 1];   //1 for every card with a pile
+    struct buyPlan plan[BUY_MAX_BUYS + 1][BUY_MAX_COINS + 1];
+};
+
+void buyTableBuild(struct buyTable *table, const int supplyCount[treasure_map + 1],
+                   buyValue value, void *ctx);
+/* Work out every plan for the cards whose supplyCount is not -1 */
+
+const struct buyPlan* buyTableLookup(const struct buyTable *table, int coins, int buys);
+/* The plan for coins and buys, clamped to the table; never NULL */
+
+int buyTablePlan(const struct buyTable *table, struct gameState *state, int coins, int buys,
+                 struct buyPlan *plan);
+/* The plan for coins and buys that the state's supply can fill; returns
+   1 if it came from the table, 0 if it had to be worked out */
+
+const struct buyTable* buyTableFor(struct gameState *state, buyValue value, void *ctx);
+/* Table for the state's kingdom and this value function, built the
+   first time it is asked for; NULL if out of memory.  The last
+   BUY_KEPT_TABLES built are kept, so the table returned stays valid
+   until a later call has to build one.  They are per process and not
+   locked: threads sharing them need a lock of their own */
+
+void buyTableForget(void);
+/* Free the tables buyTableFor has kept */
+
+#endif
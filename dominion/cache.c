@@ -0,0 +1,224 @@
+#define _DEFAULT_SOURCE
+
+#include "cache.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+//checksum of the engine and bot sources, set by the Makefile
+#ifndef ENGINE_HASH
+#define ENGINE_HASH 0
+#endif
+
+#define CACHE_MAGIC "DOMCACH1"
+#define CACHE_MAX_PROBE 64
+
+#define SLOT_EMPTY 0
+#define SLOT_READY 1
+
+struct cacheHeader {
+    char magic[8];
+    unsigned long long valueSize;
+    unsigned long long capacity;    //power of two
+    char pad[40];
+};
+
+//h1 is claimed first (0 means free); ready is set last, after the value
+struct cacheSlot {
+    unsigned long long h1;
+    unsigned long long h2;
+    unsigned int ready;
+    unsigned int pad;
+    //value follows
+};
+
+struct resultCache {
+    struct cacheHeader *header;
+    unsigned char *slots;
+    size_t slotSize;
+    size_t valueSize;
+    unsigned long long mask;
+    size_t mapSize;
+    struct cacheStats stats;
+};
+
+static unsigned long long mix(unsigned long long x) {
+    x ^= x >> 30;
+    x *= 0xBF58476D1CE4E5B9ULL;
+    x ^= x >> 27;
+    x *= 0x94D049BB133111EBULL;
+    x ^= x >> 31;
+    return x;
+}
+
+void cacheKeyAdd(struct cacheKey *key, const void *data, size_t size) {
+    const unsigned char *p = data;
+    size_t i;
+
+    //FNV-1a and a multiply-rotate hash, run independently over the bytes
+    for (i = 0; i < size; i++) {
+        key->h1 = (key->h1 ^ p[i]) * 1099511628211ULL;
+        key->h2 = (key->h2 + p[i] + 1) * 0x9E3779B97F4A7C15ULL;
+        key->h2 ^= key->h2 >> 29;
+    }
+}
+
+void cacheKeyAddInt(struct cacheKey *key, long value) {
+    cacheKeyAdd(key, &value, sizeof(value));
+}
+
+void cacheKeyAddString(struct cacheKey *key, const char *s) {
+    //length first so that ("ab","c") and ("a","bc") differ
+    cacheKeyAddInt(key, (long)strlen(s));
+    cacheKeyAdd(key, s, strlen(s));
+}
+
+void cacheKeyInit(struct cacheKey *key, const char *driver) {
+    key->h1 = 14695981039346656037ULL;
+    key->h2 = 0x243F6A8885A308D3ULL;
+    cacheKeyAddInt(key, (long)ENGINE_HASH);
+    cacheKeyAddString(key, driver);
+}
+
+static struct cacheSlot* slotAt(struct resultCache *c, unsigned long long i) {
+    return (struct cacheSlot*)(c->slots + (i & c->mask) * c->slotSize);
+}
+
+//final hashes; h1 is never 0 since 0 marks a free slot
+static void finish(const struct cacheKey *key, unsigned long long *h1, unsigned long long *h2) {
+    *h1 = mix(key->h1) | 1;
+    *h2 = mix(key->h2 ^ key->h1);
+}
+
+struct resultCache* cacheOpen(const char *path, size_t valueSize, long capacity) {
+    struct resultCache *c;
+    struct cacheHeader h;
+    struct stat st;
+    unsigned long long slots = 1;
+    size_t slotSize;
+    void *map;
+    int fd, ok = 1;
+
+    if (valueSize == 0 || capacity < 1) {
+        return NULL;
+    }
+    while (slots < (unsigned long long)capacity) {
+        slots <<= 1;
+    }
+    slotSize = (sizeof(struct cacheSlot) + valueSize + 7) & ~(size_t)7;
+
+    fd = open(path, O_RDWR | O_CREAT, 0644);
+    if (fd < 0) {
+        perror(path);
+        return NULL;
+    }
+
+    //whoever creates the file writes the header under the lock
+    flock(fd, LOCK_EX);
+    if (fstat(fd, &st) < 0) {
+        ok = 0;
+    } else if (st.st_size == 0) {
+        memset(&h, 0, sizeof(h));
+        memcpy(h.magic, CACHE_MAGIC, sizeof(h.magic));
+        h.valueSize = valueSize;
+        h.capacity = slots;
+        ok = ftruncate(fd, sizeof(h) + slots * slotSize) == 0 &&
+             pwrite(fd, &h, sizeof(h), 0) == sizeof(h);
+    } else {
+        ok = pread(fd, &h, sizeof(h), 0) == sizeof(h) &&
+             memcmp(h.magic, CACHE_MAGIC, sizeof(h.magic)) == 0 &&
+             h.valueSize == valueSize &&
+             (unsigned long long)st.st_size == sizeof(h) + h.capacity * slotSize;
+        slots = h.capacity;
+    }
+    flock(fd, LOCK_UN);
+
+    if (!ok) {
+        fprintf(stderr, "%s is not a result cache for this driver\n", path);
+        close(fd);
+        return NULL;
+    }
+
+    map = mmap(NULL, sizeof(h) + slots * slotSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    c = calloc(1, sizeof(struct resultCache));
+    if (map == MAP_FAILED || c == NULL) {
+        if (map != MAP_FAILED)
+            munmap(map, sizeof(h) + slots * slotSize);
+        free(c);
+        return NULL;
+    }
+
+    c->header = map;
+    c->slots = (unsigned char*)map + sizeof(struct cacheHeader);
+    c->slotSize = slotSize;
+    c->valueSize = valueSize;
+    c->mask = slots - 1;
+    c->mapSize = sizeof(h) + slots * slotSize;
+    return c;
+}
+
+int cacheGet(struct resultCache *c, const struct cacheKey *key, void *value) {
+    unsigned long long h1, h2, i, start;
+    struct cacheSlot *s;
+
+    finish(key, &h1, &h2);
+    start = h1 >> 8;
+    for (i = start; i < start + CACHE_MAX_PROBE; i++) {
+        s = slotAt(c, i);
+        if (__atomic_load_n(&s->h1, __ATOMIC_ACQUIRE) == SLOT_EMPTY)
+            break;
+        if (s->h1 == h1 && __atomic_load_n(&s->ready, __ATOMIC_ACQUIRE) == SLOT_READY &&
+                s->h2 == h2) {
+            memcpy(value, s + 1, c->valueSize);
+            c->stats.hits++;
+            return 1;
+        }
+    }
+    c->stats.misses++;
+    return 0;
+}
+
+int cachePut(struct resultCache *c, const struct cacheKey *key, const void *value) {
+    unsigned long long h1, h2, i, start, seen;
+    struct cacheSlot *s;
+
+    finish(key, &h1, &h2);
+    start = h1 >> 8;
+    for (i = start; i < start + CACHE_MAX_PROBE; i++) {
+        s = slotAt(c, i);
+        seen = SLOT_EMPTY;
+        if (__atomic_compare_exchange_n(&s->h1, &seen, h1, 0, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+            s->h2 = h2;
+            memcpy(s + 1, value, c->valueSize);
+            __atomic_store_n(&s->ready, SLOT_READY, __ATOMIC_RELEASE);
+            c->stats.stores++;
+            return 0;
+        }
+        //a slot another process is still filling is skipped, which at
+        //worst stores the same result twice
+        if (seen == h1 && __atomic_load_n(&s->ready, __ATOMIC_ACQUIRE) == SLOT_READY &&
+                s->h2 == h2) {
+            return 0;
+        }
+    }
+    c->stats.full++;
+    return -1;
+}
+
+void cacheClose(struct resultCache *c) {
+    if (c == NULL) {
+        return;
+    }
+    munmap(c->header, c->mapSize);
+    free(c);
+}
+
+void cacheGetStats(struct resultCache *c, struct cacheStats *stats) {
+    *stats = c->stats;
+}
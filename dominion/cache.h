@@ -0,0 +1,60 @@
+#ifndef _CACHE_H
+#define _CACHE_H
+
+#include <stddef.h>
+
+/* Content-addressed cache of work-unit results.
+
+   A unit is identified by a 128-bit hash of everything that decides its
+   result: the engine build (a checksum of the engine and bot sources,
+   baked in by the Makefile), the driver, the strategies, the kingdom,
+   the player count and the seeds.  Drivers look a unit up before handing
+   it to a worker and store every result they collect, so a rerun only
+   simulates units that changed.
+
+   The cache is a fixed-size open-addressed table in a memory-mapped file.
+   Any number of processes on one host may open the same file and read
+   and insert at the same time: a slot is claimed with an atomic
+   compare-and-swap and only becomes visible once its value is complete,
+   so a reader never sees a half-written result.  Entries are never
+   removed; delete the file to start over. */
+
+struct cacheKey {
+    unsigned long long h1;
+    unsigned long long h2;
+};
+
+void cacheKeyInit(struct cacheKey *key, const char *driver);
+/* Start a key for the named driver; the engine build is already included */
+
+void cacheKeyAdd(struct cacheKey *key, const void *data, size_t size);
+void cacheKeyAddInt(struct cacheKey *key, long value);
+void cacheKeyAddString(struct cacheKey *key, const char *s);
+
+struct resultCache;
+
+struct resultCache* cacheOpen(const char *path, size_t valueSize, long capacity);
+/* Open or create a cache of capacity slots holding valueSize-byte values;
+   NULL if it cannot be mapped or the file was created with another value
+   size (a different capacity is fine, the file's wins) */
+
+int cacheGet(struct resultCache *c, const struct cacheKey *key, void *value);
+/* 1 and the stored value if the key is present, otherwise 0 */
+
+int cachePut(struct resultCache *c, const struct cacheKey *key, const void *value);
+/* Store value under key (a no-op if it is already there); -1 if the
+   table is too full to take it */
+
+void cacheClose(struct resultCache *c);
+
+struct cacheStats {
+    long hits;
+    long misses;
+    long stores;
+    long full;      //puts dropped because the table was full
+};
+
+void cacheGetStats(struct resultCache *c, struct cacheStats *stats);
+/* Counts for this process since cacheOpen */
+
+#endif
@@ -0,0 +1,226 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include "checkpoint.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <unistd.h>
+
+#define CHECKPOINT_MAGIC "DOMCKPT1"
+
+struct checkpointHeader {
+    char magic[8];
+    unsigned long long size;
+    unsigned long long checksum;
+};
+
+static unsigned long long fnv1a(const void *data, size_t size) {
+    const unsigned char *p = data;
+    unsigned long long h = 14695981039346656037ULL;
+    size_t i;
+
+    for (i = 0; i < size; i++) {
+        h ^= p[i];
+        h *= 1099511628211ULL;
+    }
+    return h;
+}
+
+static int writeAll(int fd, const void *data, size_t size) {
+    const char *p = data;
+    ssize_t n;
+
+    while (size > 0) {
+        n = write(fd, p, size);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+            return -1;
+        p += n;
+        size -= n;
+    }
+    return 0;
+}
+
+//make the rename itself durable
+static void syncDirectory(const char *path) {
+    char dir[1024];
+    char *slash;
+    int fd;
+
+    snprintf(dir, sizeof(dir), "%s", path);
+    slash = strrchr(dir, '/');
+    if (slash == NULL)
+        strcpy(dir, ".");
+    else if (slash == dir)
+        dir[1] = '\0';
+    else
+        *slash = '\0';
+
+    fd = open(dir, O_RDONLY);
+    if (fd >= 0) {
+        fsync(fd);
+        close(fd);
+    }
+}
+
+int checkpointSave(const char *path, const void *data, size_t size) {
+    struct checkpointHeader h;
+    char tmp[1024];
+    int fd, ok;
+
+    memcpy(h.magic, CHECKPOINT_MAGIC, sizeof(h.magic));
+    h.size = size;
+    h.checksum = fnv1a(data, size);
+
+    snprintf(tmp, sizeof(tmp), "%s.tmp", path);
+    fd = open(tmp, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        return -1;
+    }
+    ok = writeAll(fd, &h, sizeof(h)) == 0 && writeAll(fd, data, size) == 0 &&
+         fsync(fd) == 0;
+    ok = close(fd) == 0 && ok;
+    if (!ok || rename(tmp, path) < 0) {
+        unlink(tmp);
+        return -1;
+    }
+    syncDirectory(path);
+    return 0;
+}
+
+int checkpointLoad(const char *path, void *data, size_t size) {
+    struct checkpointHeader h;
+    FILE *f = fopen(path, "rb");
+    int ok;
+
+    if (f == NULL) {
+        return errno == ENOENT ? 0 : -1;
+    }
+    ok = fread(&h, sizeof(h), 1, f) == 1 &&
+         memcmp(h.magic, CHECKPOINT_MAGIC, sizeof(h.magic)) == 0 &&
+         h.size == size && fread(data, 1, size, f) == size &&
+         fnv1a(data, size) == h.checksum;
+    fclose(f);
+    return ok ? 1 : -1;
+}
+
+struct checkpointWriter {
+    char path[1024];
+    int interval;
+    time_t last;
+
+    pthread_t thread;
+    pthread_mutex_t lock;
+    pthread_cond_t wake;
+    void *pending;          //latest snapshot not yet written, or NULL
+    size_t pendingSize;
+    int syncFd;             //synced before each save, -1 for none
+    int stopping;
+    int failed;
+};
+
+static void* writerMain(void *arg) {
+    struct checkpointWriter *w = arg;
+    void *data;
+    size_t size;
+    int fd;
+
+    pthread_mutex_lock(&w->lock);
+    while (1) {
+        while (w->pending == NULL && !w->stopping) {
+            pthread_cond_wait(&w->wake, &w->lock);
+        }
+        if (w->pending == NULL) {
+            break;
+        }
+        data = w->pending;
+        size = w->pendingSize;
+        fd = w->syncFd;
+        w->pending = NULL;
+        pthread_mutex_unlock(&w->lock);
+
+        //what the snapshot covers was written before it was taken
+        if (fd >= 0 && fsync(fd) < 0) {
+            fprintf(stderr, "checkpoint: cannot sync the file %s covers\n", w->path);
+            w->failed = 1;
+        } else if (checkpointSave(w->path, data, size) < 0) {
+            fprintf(stderr, "checkpoint: cannot write %s\n", w->path);
+            w->failed = 1;
+        }
+        free(data);
+
+        pthread_mutex_lock(&w->lock);
+    }
+    pthread_mutex_unlock(&w->lock);
+    return NULL;
+}
+
+struct checkpointWriter* checkpointOpen(const char *path, int interval) {
+    struct checkpointWriter *w = calloc(1, sizeof(struct checkpointWriter));
+
+    if (w == NULL) {
+        return NULL;
+    }
+    snprintf(w->path, sizeof(w->path), "%s", path);
+    w->interval = interval;
+    w->last = time(NULL);
+    w->syncFd = -1;
+    pthread_mutex_init(&w->lock, NULL);
+    pthread_cond_init(&w->wake, NULL);
+    if (pthread_create(&w->thread, NULL, writerMain, w) != 0) {
+        free(w);
+        return NULL;
+    }
+    return w;
+}
+
+int checkpointDue(struct checkpointWriter *w) {
+    return time(NULL) - w->last >= w->interval;
+}
+
+void checkpointSyncFirst(struct checkpointWriter *w, int fd) {
+    pthread_mutex_lock(&w->lock);
+    w->syncFd = fd;
+    pthread_mutex_unlock(&w->lock);
+}
+
+int checkpointWrite(struct checkpointWriter *w, const void *data, size_t size) {
+    void *copy = malloc(size);
+    void *old;
+
+    if (copy == NULL) {
+        return -1;
+    }
+    memcpy(copy, data, size);
+    w->last = time(NULL);
+
+    pthread_mutex_lock(&w->lock);
+    old = w->pending;
+    w->pending = copy;
+    w->pendingSize = size;
+    pthread_cond_signal(&w->wake);
+    pthread_mutex_unlock(&w->lock);
+
+    free(old);
+    return 0;
+}
+
+int checkpointClose(struct checkpointWriter *w) {
+    int failed;
+
+    pthread_mutex_lock(&w->lock);
+    w->stopping = 1;
+    pthread_cond_signal(&w->wake);
+    pthread_mutex_unlock(&w->lock);
+    pthread_join(w->thread, NULL);
+
+    failed = w->failed;
+    pthread_mutex_destroy(&w->lock);
+    pthread_cond_destroy(&w->wake);
+    free(w);
+    return failed ? -1 : 0;
+}
@@ -0,0 +1,44 @@
+#ifndef _CHECKPOINT_H
+#define _CHECKPOINT_H
+
+#include <stddef.h>
+#include <time.h>
+
+/* Atomic checkpoint files for long campaigns.
+
+   A checkpoint is one opaque blob, written to <path>.tmp, synced and
+   renamed over <path>, so a crash leaves either the old or the new
+   checkpoint, never a torn one.  The blob is stored with its size and a
+   checksum and rejected on load if either does not match.
+
+   checkpointWrite hands the blob to a background thread: the caller only
+   pays for a copy, never for the write and fsync. */
+
+int checkpointSave(const char *path, const void *data, size_t size);
+/* Write a checkpoint now; 0 on success */
+
+int checkpointLoad(const char *path, void *data, size_t size);
+/* 1 if a checkpoint of exactly size bytes was loaded into data, 0 if
+   there is none, -1 if it is corrupt or of another size */
+
+struct checkpointWriter;
+
+struct checkpointWriter* checkpointOpen(const char *path, int interval);
+/* Background writer for path, saving at most every interval seconds */
+
+int checkpointDue(struct checkpointWriter *w);
+/* Nonzero when interval seconds have passed since the last snapshot */
+
+void checkpointSyncFirst(struct checkpointWriter *w, int fd);
+/* Sync fd before every later snapshot is saved, for a file whose
+   contents the snapshots describe (such as its length), so a saved
+   checkpoint never covers data that was lost in a crash; -1 for none */
+
+int checkpointWrite(struct checkpointWriter *w, const void *data, size_t size);
+/* Copy data and queue it; a snapshot still waiting to be written is
+   replaced by the newer one.  -1 if out of memory */
+
+int checkpointClose(struct checkpointWriter *w);
+/* Finish pending writes and stop the thread; -1 if any write failed */
+
+#endif
@@ -0,0 +1,247 @@
+#include "decide.h"
+#include "dominion_helpers.h"
+#include "prof.h"
+#include <limits.h>
+#include <string.h>
+
+static int isTreasure(int card) {
+    return card >= copper && card <= gold;
+}
+
+static void askHand(struct decisionRequest *r, int treasure, int exclude, int none) {
+    r->kind = DECIDE_HAND;
+    r->treasure = treasure;
+    r->exclude = exclude;
+    r->none = none;
+}
+
+static void askSupply(struct decisionRequest *r, int treasure, int maxCost, int empty) {
+    r->kind = DECIDE_SUPPLY;
+    r->treasure = treasure;
+    r->maxCost = maxCost;
+    r->empty = empty;
+}
+
+static void askOption(struct decisionRequest *r, int first, int last) {
+    r->kind = DECIDE_OPTION;
+    r->first = first;
+    r->last = last;
+}
+
+//fills frame->request with the choice the card needs next; 0 when the
+//card needs no more choices
+static int nextRequest(struct playFrame *f, struct gameState *state) {
+    struct decisionRequest *r = &f->request;
+    int player = whoseTurn(state);
+    int *hand = state->hand[player];
+    int i, copies;
+
+    memset(r, 0, sizeof(struct decisionRequest));
+    r->card = f->card;
+    r->player = player;
+    r->exclude = -1;
+
+    switch (f->card) {
+    case feast:
+        if (f->step == 0) {
+            askSupply(r, 0, 5, 0);
+            return 1;
+        }
+        return 0;
+
+    case mine:
+        if (f->step == 0) {
+            askHand(r, 1, -1, 0);
+            return 1;
+        }
+        if (f->step == 1) {
+            askSupply(r, 1, getCost(hand[f->choice[0]]) + 3, 0);
+            return 1;
+        }
+        return 0;
+
+    case remodel:
+        if (f->step == 0) {
+            askHand(r, 0, -1, 0);
+            return 1;
+        }
+        if (f->step == 1) {
+            askSupply(r, 0, getCost(hand[f->choice[0]]) + 2, 0);
+            return 1;
+        }
+        return 0;
+
+    case baron:
+        //1 discards an estate for +4 coins, 0 gains one
+        if (f->step == 0) {
+            for (i = 0; i < state->handCount[player] && hand[i] != estate; i++);
+            askOption(r, 0, i < state->handCount[player]);
+            return 1;
+        }
+        return 0;
+
+    case minion:
+        if (f->step == 0) {
+            askOption(r, 1, 2);
+            return 1;
+        }
+        return 0;
+
+    case steward:
+        if (f->step == 0) {
+            askOption(r, 1, state->handCount[player] >= 2 ? 3 : 2);
+            return 1;
+        }
+        if (f->choice[0] == 3 && f->step < 3) {
+            askHand(r, 0, f->step == 2 ? f->choice[1] : -1, 0);
+            return 1;
+        }
+        return 0;
+
+    case ambassador:
+        if (f->step == 0) {
+            askHand(r, 0, -1, 0);
+            return 1;
+        }
+        if (f->step == 1) {
+            copies = 0;
+            for (i = 0; i < state->handCount[player]; i++) {
+                if (i != f->choice[0] && hand[i] == hand[f->choice[0]])
+                    copies++;
+            }
+            askOption(r, 0, copies < 2 ? copies + 1 : 2);
+            return 1;
+        }
+        return 0;
+
+    case embargo:
+        if (f->step == 0) {
+            askSupply(r, 0, INT_MAX, 1);
+            return 1;
+        }
+        return 0;
+
+    case salvager:
+        //the engine takes position 0 for "trash nothing"
+        if (f->step == 0) {
+            askHand(r, 0, 0, 1);
+            return 1;
+        }
+        return 0;
+    }
+    return 0;
+}
+
+int decisionLegal(const struct decisionRequest *r, int answer, struct gameState *state) {
+    int card;
+
+    if (answer == -1)
+        return r->none;
+
+    switch (r->kind) {
+    case DECIDE_HAND:
+        if (answer < 0 || answer >= state->handCount[r->player] || answer == r->exclude)
+            return 0;
+        return !r->treasure || isTreasure(state->hand[r->player][answer]);
+
+    case DECIDE_SUPPLY:
+        card = answer;
+        if (card < curse || card > treasure_map || state->supplyCount[card] < (r->empty ? 0 : 1))
+            return 0;
+        return getCost(card) <= r->maxCost && (!r->treasure || isTreasure(card));
+
+    case DECIDE_OPTION:
+        return answer >= r->first && answer <= r->last;
+    }
+    return 0;
+}
+
+int decisionOptions(const struct decisionRequest *r, struct gameState *state,
+                    int options[], int max) {
+    int first = r->kind == DECIDE_OPTION ? r->first : 0;
+    int last = r->kind == DECIDE_OPTION ? r->last :
+               r->kind == DECIDE_HAND ? state->handCount[r->player] - 1 : treasure_map;
+    int answer, count = 0;
+
+    if (r->none) {
+        if (count < max)
+            options[count] = -1;
+        count++;
+    }
+    for (answer = first; answer <= last; answer++) {
+        if (decisionLegal(r, answer, state)) {
+            if (count < max)
+                options[count] = answer;
+            count++;
+        }
+    }
+    return count;
+}
+
+//carries out the card with the answers given, as playCard does
+static int finishPlay(struct playFrame *f, struct gameState *state) {
+    int bonus = 0;
+
+    PROF_ZONE(PROF_PLAY_CARD);
+
+    if (cardEffect(f->card, f->choice[0], f->choice[1], f->choice[2], state, f->handPos, &bonus) < 0)
+        return -1;
+    state->numActions--;
+    updateCoins(state->whoseTurn, state, bonus);
+    return 0;
+}
+
+//the next choice, or the play once there are none left
+static int advance(struct playFrame *f, struct gameState *state) {
+    if (!nextRequest(f, state))
+        return finishPlay(f, state);
+    if (f->step > 0 && decisionOptions(&f->request, state, NULL, 0) == 0)
+        f->request.none = 1;
+    return PLAY_DECIDE;
+}
+
+int playBegin(struct playFrame *f, int handPos, struct gameState *state) {
+    int player = whoseTurn(state);
+    int i, handTail, discardTail;
+
+    if (state->phase != 0 || state->numActions < 1 ||
+            handPos < 0 || handPos >= state->handCount[player])
+        return -1;
+    f->card = state->hand[player][handPos];
+    if (f->card < adventurer || f->card > treasure_map || f->card == gardens)
+        return -1;
+    f->handPos = handPos;
+    f->step = 0;
+    f->choice[0] = f->choice[1] = f->choice[2] = -1;
+
+    handTail = state->hand[player][state->handCount[player]];
+    discardTail = state->discard[player][state->discardCount[player]];
+    discardCard(handPos, player, state, 0);
+
+    if (nextRequest(f, state) && decisionOptions(&f->request, state, NULL, 0) == 0) {
+        //put the card back where it was
+        for (i = state->handCount[player]; i > handPos; i--) {
+            state->hand[player][i] = state->hand[player][i - 1];
+        }
+        state->hand[player][handPos] = f->card;
+        state->hand[player][++state->handCount[player]] = handTail;
+        state->discard[player][--state->discardCount[player]] = discardTail;
+        stateHashReset(state);
+        return -1;
+    }
+    return advance(f, state);
+}
+
+int playResume(struct playFrame *f, int answer, struct gameState *state) {
+    if (!decisionLegal(&f->request, answer, state))
+        return -1;
+
+    //the engine removes steward's first card before looking up the second
+    if (f->card == steward && f->step == 2 && answer > f->choice[1])
+        f->choice[f->step++] = answer - 1;
+    else if (f->card == salvager && answer == -1)
+        f->choice[f->step++] = 0;
+    else
+        f->choice[f->step++] = answer;
+    return advance(f, state);
+}
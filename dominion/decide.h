@@ -0,0 +1,68 @@
+#ifndef _DECIDE_H
+#define _DECIDE_H
+
+#include "dominion.h"
+
+/* Playing a card one decision at a time.
+
+   playCard needs every choice before the card does anything.  Here the
+   card is started with playBegin, which takes it out of the hand, and
+   each choice the card needs is asked for in turn through the frame's
+   request, once the earlier answers are known: mine asks which treasure
+   to trash and then offers only the treasures that one may become,
+   steward asks for the cards to trash only if trashing was chosen.  The
+   frame holds the answers and the position in the card's script, a few
+   ints, so nothing is copied while the caller thinks.  After the last
+   answer the card's effect is carried out by the engine as playCard would
+   with the same choices.
+
+   Hand positions in answers are positions in the hand as it is when
+   asked, without the card being played.  A card none of whose first
+   answers is legal (mine without another treasure) is not played; when
+   a later choice has no legal answer, -1 is its answer.  The state must
+   not be changed between playBegin and the end of the play other than by
+   playResume. */
+
+#define PLAY_DECIDE 1   /* playBegin / playResume: answer frame->request */
+
+#define DECIDE_HAND 1   /* answer: a position in the player's hand */
+#define DECIDE_SUPPLY 2 /* answer: a card from the supply */
+#define DECIDE_OPTION 3 /* answer: a number from first to last */
+
+struct decisionRequest {
+    int kind;           //DECIDE_HAND, DECIDE_SUPPLY or DECIDE_OPTION
+    int card;           //the card being played
+    int player;         //who decides
+    int treasure;       //DECIDE_HAND, DECIDE_SUPPLY: treasures only
+    int maxCost;        //DECIDE_SUPPLY: cost limit
+    int empty;          //DECIDE_SUPPLY: empty piles may be chosen
+    int exclude;        //DECIDE_HAND: position already chosen, or -1
+    int first, last;    //DECIDE_OPTION: the range of answers
+    int none;           //-1 (no card) is also an answer
+};
+
+struct playFrame {
+    int card;
+    int handPos;
+    int step;           //choices answered so far
+    int choice[3];      //as for playCard
+    struct decisionRequest request;
+};
+
+int playBegin(struct playFrame *frame, int handPos, struct gameState *state);
+/* Start playing the card at handPos.  Returns PLAY_DECIDE when the card
+   needs a choice, else the card is played and the result is playCard's.
+   Returns -1 without changing the state if the card cannot be played */
+
+int playResume(struct playFrame *frame, int answer, struct gameState *state);
+/* Answer frame->request; returns as playBegin.  An answer that is not
+   legal returns -1 and leaves the state and the request as they were */
+
+int decisionLegal(const struct decisionRequest *request, int answer,
+                  struct gameState *state);
+
+int decisionOptions(const struct decisionRequest *request, struct gameState *state,
+                    int options[], int max);
+/* Store up to max legal answers in options; returns how many there are */
+
+#endif
@@ -1,9 +1,11 @@
 #include "dominion.h"
 #include "dominion_helpers.h"
 #include "rngs.h"
+#include "prof.h"
 #include <stdio.h>
 #include <math.h>
 #include <stdlib.h>
+#include <string.h>
 
 int compare(const void* a, const void* b) {
     if (*(int*)a > *(int*)b)
@@ -13,6 +15,74 @@ int compare(const void* a, const void* b) {
     return 0;
 }
 
+//Zobrist keys: a fixed pseudo-random 64-bit value per (pile, player,
+//position, card), made by mixing the four together (splitmix64's
+//finalizer).  Piles are hashed as the sum of the keys of their cards, so
+//that moving one card adds one key and takes away another, and the order
+//of cards only counts where the position is part of the key.  The keys
+//of real cards without a position are looked up in a table filled at
+//startup.
+enum HASH_PILE
+{   HASH_HAND = 1,
+    HASH_DECK,
+    HASH_DECK_AT, /* deck card with its position, with hashDeckOrder */
+    HASH_DISCARD,
+    HASH_PLAYED,
+    HASH_TRASH,
+    HASH_SUPPLY,
+    HASH_EMBARGO,
+    HASH_TURN,
+    HASH_MONEY
+};
+
+static unsigned long long zobrist(int pile, int player, int position, int card) {
+    unsigned long long x = (unsigned long long)pile << 58 ^ (unsigned long long)(player & 0x3ff) << 48 ^
+                           (unsigned long long)(position & 0xffff) << 32 ^ (unsigned int)card;
+
+    x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+    return x ^ (x >> 31);
+}
+
+static unsigned long long cardKeys[HASH_EMBARGO + 1][MAX_PLAYERS][treasure_map + 1];
+
+__attribute__((constructor)) static void fillCardKeys(void) {
+    int pile, player, card;
+
+    for (pile = 0; pile <= HASH_EMBARGO; pile++)
+        for (player = 0; player < MAX_PLAYERS; player++)
+            for (card = 0; card <= treasure_map; card++)
+                cardKeys[pile][player][card] = zobrist(pile, player, 0, card);
+}
+
+//macros rather than functions: they sit on every card move and the
+//engine is built without optimization
+#define cardKey(pile, player, card) \
+    ((unsigned)(card) <= treasure_map && (unsigned)(player) < MAX_PLAYERS ? \
+     cardKeys[pile][player][card] : zobrist(pile, player, 0, card))
+
+#define hashDeckCard(state, player, position, card) \
+    ((state)->hashDeckOrder ? zobrist(HASH_DECK_AT, player, position, card) : \
+     cardKey(HASH_DECK, player, card))
+
+static unsigned long long hashPile(int pile, int player, int *cards, int count) {
+    unsigned long long h = 0;
+    int i;
+
+    for (i = 0; i < count; i++)
+        h += cardKey(pile, player, cards[i]);
+    return h;
+}
+
+static unsigned long long hashDeck(struct gameState *state, int player) {
+    unsigned long long h = 0;
+    int i;
+
+    for (i = 0; i < state->deckCount[player]; i++)
+        h += hashDeckCard(state, player, i, state->deck[player][i]);
+    return h;
+}
+
 struct gameState* newGame() {
     struct gameState* g = malloc(sizeof(struct gameState));
     return g;
@@ -34,12 +104,28 @@ int* kingdomCards(int k1, int k2, int k3, int k4, int k5, int k6, int k7,
     return k;
 }
 
+void fillKingdomCards(int k[10], int k1, int k2, int k3, int k4, int k5,
+                      int k6, int k7, int k8, int k9, int k10) {
+    k[0] = k1;
+    k[1] = k2;
+    k[2] = k3;
+    k[3] = k4;
+    k[4] = k5;
+    k[5] = k6;
+    k[6] = k7;
+    k[7] = k8;
+    k[8] = k9;
+    k[9] = k10;
+}
+
 int initializeGame(int numPlayers, int kingdomCards[10], int randomSeed,
                    struct gameState *state) {
     int i;
     int j;
     int it;
 
+    PROF_ZONE(PROF_INITIALIZE_GAME);
+
     //set up random number generator
     SelectStream(1);
     PutSeed((long)randomSeed);
@@ -52,6 +138,9 @@ int initializeGame(int numPlayers, int kingdomCards[10], int randomSeed,
 
     //set number of players
     state->numPlayers = numPlayers;
+    state->playerStreams = 0;
+    state->hashDeckOrder = 0;
+    state->hash = 0;
 
     //check selected kingdom cards are different
     for (i = 0; i < 10; i++)
@@ -185,6 +274,7 @@ int initializeGame(int numPlayers, int kingdomCards[10], int randomSeed,
     state->phase = 0;
     state->numActions = 1;
     state->numBuys = 1;
+    state->playedCardCount = 0;
     state->trashedCardCount = 0;
     state->whoseTurn = 0;
     state->handCount[state->whoseTurn] = 0;
@@ -196,6 +286,128 @@ int initializeGame(int numPlayers, int kingdomCards[10], int randomSeed,
     }
 
     updateCoins(state->whoseTurn, state, 0);
+    stateHashReset(state);
+
+    return 0;
+}
+
+int initializeGameTemplate(int numPlayers, int kingdomCards[10],
+                           struct gameTemplate *tmpl) {
+    int i;
+    int j;
+    int card;
+
+    if (numPlayers > MAX_PLAYERS || numPlayers < 2)
+    {
+        return -1;
+    }
+
+    //check selected kingdom cards are different
+    for (i = 0; i < 10; i++)
+    {
+        for (j = i + 1; j < 10; j++)
+        {
+            if (kingdomCards[j] == kingdomCards[i])
+            {
+                return -1;
+            }
+        }
+    }
+
+    tmpl->numPlayers = numPlayers;
+    tmpl->playerStreams = 0;
+
+    //base supply, same counts as initializeGame
+    tmpl->supplyCount[curse] = numPlayers == 2 ? 10 : (numPlayers == 3 ? 20 : 30);
+    tmpl->supplyCount[estate] = numPlayers == 2 ? 8 : 12;
+    tmpl->supplyCount[duchy] = tmpl->supplyCount[estate];
+    tmpl->supplyCount[province] = tmpl->supplyCount[estate];
+    tmpl->supplyCount[copper] = 60 - (7 * numPlayers);
+    tmpl->supplyCount[silver] = 40;
+    tmpl->supplyCount[gold] = 30;
+
+    //kingdom cards not in the game stay at -1
+    for (card = adventurer; card <= treasure_map; card++)
+    {
+        tmpl->supplyCount[card] = -1;
+    }
+    for (j = 0; j < 10; j++)
+    {
+        card = kingdomCards[j];
+        if (card < adventurer || card > treasure_map)
+        {
+            continue;
+        }
+        if (card == great_hall || card == gardens)
+        {
+            tmpl->supplyCount[card] = numPlayers == 2 ? 8 : 12;
+        }
+        else
+        {
+            tmpl->supplyCount[card] = 10;
+        }
+    }
+
+    return 0;
+}
+
+int initializeGameFromTemplate(struct gameTemplate *tmpl, int randomSeed,
+                               struct gameState *state) {
+    int i;
+    int it;
+
+    PROF_ZONE(PROF_INITIALIZE_FROM_TEMPLATE);
+
+    //set up random number generator
+    SelectStream(1);
+    PutSeed((long)randomSeed);
+    if (tmpl->playerStreams)
+    {
+        PlantSeeds((long)randomSeed);
+    }
+
+    state->numPlayers = tmpl->numPlayers;
+    state->playerStreams = tmpl->playerStreams;
+    state->hashDeckOrder = 0;
+    state->hash = 0;
+    memcpy(state->supplyCount, tmpl->supplyCount, sizeof(tmpl->supplyCount));
+    memset(state->embargoTokens, 0, sizeof(state->embargoTokens));
+
+    //starting decks are already in shuffle's sorted order
+    for (i = 0; i < tmpl->numPlayers; i++)
+    {
+        state->deck[i][0] = estate;
+        state->deck[i][1] = estate;
+        state->deck[i][2] = estate;
+        for (it = 3; it < 10; it++)
+        {
+            state->deck[i][it] = copper;
+        }
+        state->deckCount[i] = 10;
+        state->handCount[i] = 0;
+        state->discardCount[i] = 0;
+
+        if ( shuffle(i, state) < 0 )
+        {
+            return -1;
+        }
+    }
+
+    //initialize first player's turn
+    state->outpostPlayed = 0;
+    state->phase = 0;
+    state->numActions = 1;
+    state->numBuys = 1;
+    state->playedCardCount = 0;
+    state->trashedCardCount = 0;
+    state->whoseTurn = 0;
+
+    for (it = 0; it < 5; it++) {
+        drawCard(state->whoseTurn, state);
+    }
+
+    updateCoins(state->whoseTurn, state, 0);
+    stateHashReset(state);
 
     return 0;
 }
@@ -208,11 +420,18 @@ int shuffle(int player, struct gameState *state) {
     int card;
     int i;
 
+    PROF_ZONE(PROF_SHUFFLE);
+
     if (state->deckCount[player] < 1)
         return -1;
+    if (state->hashDeckOrder)
+        state->hash -= hashDeck(state, player);
     qsort ((void*)(state->deck[player]), state->deckCount[player], sizeof(int), compare);
     /* SORT CARDS IN DECK TO ENSURE DETERMINISM! */
 
+    if (state->playerStreams)
+        SelectStream(PLAYER_STREAM_BASE + player);
+
     while (state->deckCount[player] > 0) {
         card = floor(Random() * state->deckCount[player]);
         newDeck[newDeckPos] = state->deck[player][card];
@@ -226,6 +445,11 @@ int shuffle(int player, struct gameState *state) {
         state->deck[player][i] = newDeck[i];
         state->deckCount[player]++;
     }
+    if (state->hashDeckOrder)
+        state->hash += hashDeck(state, player);
+
+    if (state->playerStreams)
+        SelectStream(1);
 
     return 0;
 }
@@ -235,6 +459,8 @@ int playCard(int handPos, int choice1, int choice2, int choice3, struct gameStat
     int card;
     int coin_bonus = 0; 		//tracks coins gain from actions
 
+    PROF_ZONE(PROF_PLAY_CARD);
+
     //check if it is the right phase
     if (state->phase != 0)
     {
@@ -276,6 +502,9 @@ int playCard(int handPos, int choice1, int choice2, int choice3, struct gameStat
 
 int buyCard(int supplyPos, struct gameState *state) {
     int who;
+
+    PROF_ZONE(PROF_BUY_CARD);
+
     if (DEBUG) {
         printf("Entering buyCard...\n");
     }
@@ -330,6 +559,8 @@ int fullDeckCount(int player, int card, struct gameState *state) {
     int i;
     int count = 0;
 
+    PROF_ZONE(PROF_FULL_DECK_COUNT);
+
     for (i = 0; i < state->deckCount[player]; i++)
     {
         if (state->deck[player][i] == card) count++;
@@ -357,8 +588,12 @@ int endTurn(struct gameState *state) {
     int i;
     int currentPlayer = whoseTurn(state);
 
+    PROF_ZONE(PROF_END_TURN);
+
     //Discard hand
     for (i = 0; i < state->handCount[currentPlayer]; i++) {
+        state->hash += cardKey(HASH_DISCARD, currentPlayer, state->hand[currentPlayer][i]) -
+                       cardKey(HASH_HAND, currentPlayer, state->hand[currentPlayer][i]);
         state->discard[currentPlayer][state->discardCount[currentPlayer]++] = state->hand[currentPlayer][i];//Discard
         state->hand[currentPlayer][i] = -1;//Set card to -1
     }
@@ -377,7 +612,9 @@ int endTurn(struct gameState *state) {
     state->numActions = 1;
     state->coins = 0;
     state->numBuys = 1;
+    state->hash -= hashPile(HASH_TRASH, 0, state->trash, state->trashedCardCount);
     state->trashedCardCount = 0;
+    state->hash -= hashPile(HASH_HAND, state->whoseTurn, state->hand[state->whoseTurn], state->handCount[state->whoseTurn]);
     state->handCount[state->whoseTurn] = 0;
 
     //int k; move to top
@@ -396,6 +633,8 @@ int isGameOver(struct gameState *state) {
     int i;
     int j;
 
+    PROF_ZONE(PROF_IS_GAME_OVER);
+
     //if stack of Province cards is empty, the game ends
     if (state->supplyCount[province] == 0)
     {
@@ -423,6 +662,9 @@ int scoreFor (int player, struct gameState *state) {
 
     int i;
     int score = 0;
+
+    PROF_ZONE(PROF_SCORE_FOR);
+
     //score from hand
     for (i = 0; i < state->handCount[player]; i++)
     {
@@ -501,6 +743,8 @@ int getWinners(int players[MAX_PLAYERS], struct gameState *state) {
     int highScore;
     int currentPlayer;
 
+    PROF_ZONE(PROF_GET_WINNERS);
+
     //get score for each player
     for (i = 0; i < MAX_PLAYERS; i++)
     {
@@ -566,10 +810,14 @@ int getWinners(int players[MAX_PLAYERS], struct gameState *state) {
 int drawCard(int player, struct gameState *state)
 {   int count;
     int deckCounter;
+
+    PROF_ZONE(PROF_DRAW_CARD);
+
     if (state->deckCount[player] <= 0) { //Deck is empty
 
         //Step 1 Shuffle the discard pile back into a deck
         int i;
+        state->hash -= hashPile(HASH_DISCARD, player, state->discard[player], state->discardCount[player]);
         //Move discard to deck
         for (i = 0; i < state->discardCount[player]; i++) {
             state->deck[player][i] = state->discard[player][i];
@@ -578,6 +826,7 @@ int drawCard(int player, struct gameState *state)
 
         state->deckCount[player] = state->discardCount[player];
         state->discardCount[player] = 0;//Reset discard
+        state->hash += hashDeck(state, player);
 
         //Shufffle the deck
         shuffle(player, state);//Shuffle the deck up and make it so that we can draw
@@ -600,6 +849,8 @@ int drawCard(int player, struct gameState *state)
         if (deckCounter == 0)
             return -1;
 
+        state->hash += cardKey(HASH_HAND, player, state->deck[player][deckCounter - 1]) -
+                       hashDeckCard(state, player, deckCounter - 1, state->deck[player][deckCounter - 1]);
         state->hand[player][count] = state->deck[player][deckCounter - 1];//Add card to hand
         state->deckCount[player]--;
         state->handCount[player]++;//Increment hand count
@@ -613,6 +864,8 @@ int drawCard(int player, struct gameState *state)
         }
 
         deckCounter = state->deckCount[player];//Create holder for the deck count
+        state->hash += cardKey(HASH_HAND, player, state->deck[player][deckCounter - 1]) -
+                       hashDeckCard(state, player, deckCounter - 1, state->deck[player][deckCounter - 1]);
         state->hand[player][count] = state->deck[player][deckCounter - 1];//Add card to the hand
         state->deckCount[player]--;
         state->handCount[player]++;//Increment hand count
@@ -698,6 +951,10 @@ int cardEffect(int card, int choice1, int choice2, int choice3, struct gameState
     int drawntreasure=0;
     int cardDrawn;
     int z = 0;// this is the counter for the temp hand
+
+    PROF_ZONE(PROF_CARD_EFFECT);
+    PROF_ZONE(PROF_CARD_BASE + card);
+
     if (nextPlayer > (state->numPlayers - 1)) {
         nextPlayer = 0;
     }
@@ -718,11 +975,13 @@ int cardEffect(int card, int choice1, int choice2, int choice3, struct gameState
             else {
                 temphand[z]=cardDrawn;
                 state->handCount[currentPlayer]--; //this should just remove the top card (the most recently drawn one).
+                state->hash -= cardKey(HASH_HAND, currentPlayer, cardDrawn);
                 z++;
             }
         }
         while(z-1>=0) {
             state->discard[currentPlayer][state->discardCount[currentPlayer]++]=temphand[z-1]; // discard all cards in play that have been drawn
+            state->hash += cardKey(HASH_DISCARD, currentPlayer, temphand[z-1]);
             z=z-1;
         }
         return 0;
@@ -903,10 +1162,14 @@ int cardEffect(int card, int choice1, int choice2, int choice3, struct gameState
 
     case tribute:
 		tributeAction(currentPlayer, nextPlayer, state);
+		//moves the next player's cards by hand
+		stateHashReset(state);
 		return 0;
 
     case ambassador:
 		ambassadorAction(choice1, choice2, currentPlayer, state);
+		//returns cards to the supply by hand
+		stateHashReset(state);
 		return 0;
 
     case cutpurse:
@@ -956,6 +1219,7 @@ int cardEffect(int card, int choice1, int choice2, int choice3, struct gameState
 
         //add embargo token to selected supply pile
         state->embargoTokens[choice1]++;
+        state->hash += cardKey(HASH_EMBARGO, 0, choice1);
 
         //trash card
         discardCard(handPos, currentPlayer, state, 1);
@@ -994,6 +1258,8 @@ int cardEffect(int card, int choice1, int choice2, int choice3, struct gameState
                 state->deck[i][state->deckCount[i]--] = curse;//Top card now a curse
             }
         }
+        //moves the other players' cards by hand
+        stateHashReset(state);
         return 0;
 
     case treasure_map:
@@ -1278,6 +1544,9 @@ int mineAction(int choice1, int choice2, int player, struct gameState *state)
 
 int discardCard(int handPos, int currentPlayer, struct gameState *state, int trashFlag)
 {
+    PROF_ZONE(PROF_DISCARD_CARD);
+
+    state->hash -= cardKey(HASH_HAND, currentPlayer, state->hand[currentPlayer][handPos]);
 
 	//if trash flag is set to positive, add to trash pile
 	if (trashFlag > 0)
@@ -1285,6 +1554,7 @@ int discardCard(int handPos, int currentPlayer, struct gameState *state, int tra
 		//add card to trash pile
 		state->trash[state->trashedCardCount] = state->hand[currentPlayer][handPos];
 		state->trashedCardCount++;
+		state->hash += cardKey(HASH_TRASH, 0, state->hand[currentPlayer][handPos]);
 	}
 
 	//if trash flag is set to negative, don't add to any pile
@@ -1298,6 +1568,7 @@ int discardCard(int handPos, int currentPlayer, struct gameState *state, int tra
 	{
 		state->discard[currentPlayer][state->discardCount[currentPlayer]] = state->hand[currentPlayer][handPos];
 		state->discardCount[currentPlayer]++;
+		state->hash += cardKey(HASH_DISCARD, currentPlayer, state->hand[currentPlayer][handPos]);
 	}
 
 
@@ -1319,11 +1590,17 @@ int discardCard(int handPos, int currentPlayer, struct gameState *state, int tra
 	//reduce number of cards in hand
 	state->handCount[currentPlayer]--;
 
+    //a position past the hand takes away a card other than the one hashed
+    if (handPos < 0 || handPos > state->handCount[currentPlayer])
+        stateHashReset(state);
+
     return 0;
 }
 
 int gainCard(int supplyPos, struct gameState *state, int toFlag, int player)
 {
+    PROF_ZONE(PROF_GAIN_CARD);
+
     //Note: supplyPos is enum of choosen card
 
     //check if supply pile is empty (0) or card is not used in game (-1)
@@ -1339,22 +1616,26 @@ int gainCard(int supplyPos, struct gameState *state, int toFlag, int player)
 
     if (toFlag == 1)
     {
+        state->hash += hashDeckCard(state, player, state->deckCount[player], supplyPos);
         state->deck[ player ][ state->deckCount[player] ] = supplyPos;
         state->deckCount[player]++;
     }
     else if (toFlag == 2)
     {
+        state->hash += cardKey(HASH_HAND, player, supplyPos);
         state->hand[ player ][ state->handCount[player] ] = supplyPos;
         state->handCount[player]++;
     }
     else
     {
+        state->hash += cardKey(HASH_DISCARD, player, supplyPos);
         state->discard[player][ state->discardCount[player] ] = supplyPos;
         state->discardCount[player]++;
     }
 
     //decrease number in supply pile
     state->supplyCount[supplyPos]--;
+    state->hash -= cardKey(HASH_SUPPLY, 0, supplyPos);
 
 	//check if game is over
 	isGameOver(state);
@@ -1366,6 +1647,8 @@ int updateCoins(int player, struct gameState *state, int bonus)
 {
     int i;
 
+    PROF_ZONE(PROF_UPDATE_COINS);
+
     //reset coin count
     state->coins = 0;
 
@@ -1392,6 +1675,48 @@ int updateCoins(int player, struct gameState *state, int bonus)
     return 0;
 }
 
+//the card part of the hash, which the engine keeps in state->hash
+static unsigned long long hashCards(struct gameState *state) {
+    unsigned long long h = 0;
+    int p, c;
+
+    for (p = 0; p < state->numPlayers && p < MAX_PLAYERS; p++) {
+        h += hashPile(HASH_HAND, p, state->hand[p], state->handCount[p]);
+        h += hashDeck(state, p);
+        h += hashPile(HASH_DISCARD, p, state->discard[p], state->discardCount[p]);
+    }
+    h += hashPile(HASH_PLAYED, 0, state->playedCards, state->playedCardCount);
+    h += hashPile(HASH_TRASH, 0, state->trash, state->trashedCardCount);
+    for (c = curse; c <= treasure_map; c++) {
+        h += state->supplyCount[c] * cardKey(HASH_SUPPLY, 0, c);
+        h += state->embargoTokens[c] * cardKey(HASH_EMBARGO, 0, c);
+    }
+    return h;
+}
+
+//the counters change all over cardEffect, so they are hashed when asked
+static unsigned long long hashTurn(struct gameState *state) {
+    return zobrist(HASH_TURN, state->whoseTurn, state->phase, state->numActions) +
+           zobrist(HASH_MONEY, state->numBuys, state->outpostPlayed, state->coins);
+}
+
+unsigned long long stateHash(struct gameState *state) {
+    return state->hash + hashTurn(state);
+}
+
+unsigned long long stateHashRecompute(struct gameState *state) {
+    return hashCards(state) + hashTurn(state);
+}
+
+void stateHashReset(struct gameState *state) {
+    state->hash = hashCards(state);
+}
+
+void stateHashDeckOrder(struct gameState *state, int ordered) {
+    state->hashDeckOrder = ordered != 0;
+    stateHashReset(state);
+}
+
 
 //end of dominion.c
 
@@ -71,15 +71,25 @@ struct gameState {
     int discardCount[MAX_PLAYERS];
     int playedCards[MAX_DECK];
     int playedCardCount;
+    int trash[MAX_DECK];
+    int trashedCardCount;
+    int playerStreams; /* nonzero: each player shuffles from their own stream, see gameTemplate */
+    int hashDeckOrder; /* nonzero: stateHash tells decks in another order apart */
+    unsigned long long hash; /* card part of stateHash, kept up to date by the engine */
 };
 
 /* All functions return -1 on failure, and DO NOT CHANGE GAME STATE;
    unless specified for other return, return 0 on success */
 
 struct gameState* newGame();
+/* Caller must free(); use poolAcquire() (pool.h) in simulation loops */
 
 int* kingdomCards(int k1, int k2, int k3, int k4, int k5, int k6, int k7,
                   int k8, int k9, int k10);
+/* Caller must free(); fillKingdomCards() does not allocate */
+
+void fillKingdomCards(int k[10], int k1, int k2, int k3, int k4, int k5,
+                      int k6, int k7, int k8, int k9, int k10);
 
 int initializeGame(int numPlayers, int kingdomCards[10], int randomSeed,
                    struct gameState *state);
@@ -89,6 +99,32 @@ int initializeGame(int numPlayers, int kingdomCards[10], int randomSeed,
 
 Cards not in game should initialize supply position to -1 */
 
+#define PLAYER_STREAM_BASE 2 /* rngs.c stream of player 0's shuffles */
+
+struct gameTemplate {
+    int numPlayers;
+    int supplyCount[treasure_map+1];
+    int playerStreams;
+};
+/* With playerStreams set (initializeGameTemplate clears it), games from
+   the template plant every rngs.c stream from the seed and player p
+   shuffles from stream PLAYER_STREAM_BASE + p alone, so a seat's deck
+   order does not depend on what the other players did.  Replaying a seed
+   with the bots in other seats then deals every seat the same luck
+   (common random numbers). */
+
+int initializeGameTemplate(int numPlayers, int kingdomCards[10],
+                           struct gameTemplate *tmpl);
+/* Does the seed-independent part of initializeGame once per (player
+   count, kingdom): the same checks, and the initial supply.  Returns -1
+   on the same inputs initializeGame rejects */
+
+int initializeGameFromTemplate(struct gameTemplate *tmpl, int randomSeed,
+                               struct gameState *state);
+/* Same result as initializeGame with the template's arguments and this
+   seed, but only builds the starting decks, shuffles them and draws the
+   opening hand */
+
 int shuffle(int player, struct gameState *state);
 /* Assumes all cards are now in deck array (or hand/played):  discard is
  empty */
@@ -128,4 +164,20 @@ int getWinners(int players[MAX_PLAYERS], struct gameState *state);
 /* Set array position of each player who won (remember ties!) to
    1, others to 0 */
 
+unsigned long long stateHash(struct gameState *state);
+/* 64-bit Zobrist hash of the position: every card in every pile, supply
+   and embargo counts, whose turn, phase, actions, buys and coins.  Hands
+   and discard piles count as unordered; decks too unless hashDeckOrder is
+   set.  The card part is updated as cards move (drawCard, gainCard,
+   discardCard, shuffle, endTurn), so this costs a few instructions */
+
+unsigned long long stateHashRecompute(struct gameState *state);
+/* The same hash computed from scratch, for checking */
+
+void stateHashReset(struct gameState *state);
+/* Recompute the kept hash after changing the state directly */
+
+void stateHashDeckOrder(struct gameState *state, int ordered);
+/* Set hashDeckOrder (games start with it clear) and recompute the hash */
+
 #endif
@@ -0,0 +1,543 @@
+/* Genetic optimizer for rule bots (see rules.h).
+
+   Evolves a population of buy-rule priority lists against a fixed
+   opponent pool.  Every candidate plays -games seeds against each
+   opponent, both seatings per seed with per-player shuffle streams, and
+   the seeds are the same for every candidate in every generation, so
+   candidates are compared on the same deals.  The games are run in
+   batches by worker processes.
+
+   Evaluations are deterministic, so a candidate seen before (an elite
+   carried over, or anything found in the -cache result cache) is not
+   played again.  The population is checkpointed after every generation
+   and a rerun with the same arguments continues from there.  The best
+   bot so far is written to -out after every generation, in the rule
+   file format the drivers load ("-bots best.rules").
+
+   Usage: evolve [-opponents a,b,...] [-population n] [-generations n]
+                 [-games n] [-batch n] [-seed n] [-workers n]
+                 [-kingdom k1,..,k10] [-checkpoint file] [-cache file]
+                 [-out file] */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include "dominion.h"
+#include "dominion_helpers.h"
+#include "cache.h"
+#include "checkpoint.h"
+#include "rules.h"
+#include "runner.h"
+#include "sim.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define MAX_POPULATION 256
+#define MAX_OPPONENTS 8
+#define ELITES 2
+#define SELECTION 3         //tournament selection size
+
+struct individual {
+    struct ruleBot rules;
+    long points;            //half points over all games played
+    long games;
+    int evaluated;
+};
+
+//everything a resumed run needs
+struct evolveProgress {
+    char config[1024];
+    int generation;         //next generation to evaluate
+    unsigned long long rng;
+    struct individual population[MAX_POPULATION];
+    struct individual best;
+};
+
+struct evalResult {
+    long points;
+    long games;
+};
+
+struct evolve {
+    struct evolveProgress progress;
+    struct simBot *opponents[MAX_OPPONENTS];
+    long opponentId[MAX_OPPONENTS];
+    int numOpponents;
+    int kingdom[10];
+    int cards[treasure_map + 1];    //cards rules may buy
+    int numCards;
+    struct gameTemplate tmpl;
+    int populationSize;
+    int generations;
+    int games;
+    int batch;
+    int seed;
+    long blocks;            //units per candidate and opponent
+    long units;
+    long cursor;
+    struct resultCache *cache;
+    long fromCache;
+};
+
+//xorshift64*; the optimizer's own generator, rngs.c belongs to the games
+static unsigned long long nextRandom(unsigned long long *state) {
+    *state ^= *state >> 12;
+    *state ^= *state << 25;
+    *state ^= *state >> 27;
+    return *state * 0x2545F4914F6CDD1DULL;
+}
+
+static int randomInt(struct evolve *e, int n) {
+    return (int)(nextRandom(&e->progress.rng) % (unsigned long long)n);
+}
+
+static double fitness(struct individual *ind) {
+    return ind->games > 0 ? ind->points / (2.0 * ind->games) : 0;
+}
+
+//units are candidate-major: unit = (candidate * opponents + opponent) * blocks + block
+static void unitParts(struct evolve *e, long unit, int *candidate, int *opponent, long *block) {
+    *block = unit % e->blocks;
+    *opponent = (int)(unit / e->blocks % e->numOpponents);
+    *candidate = (int)(unit / e->blocks / e->numOpponents);
+}
+
+static int playUnit(long unit, void *out, void *ctx) {
+    struct evolve *e = ctx;
+    struct evalResult *r = out;
+    struct simBot candidate, *seats[2];
+    struct simResult game;
+    int c, o, g, first, last, seat;
+    long block;
+
+    unitParts(e, unit, &c, &o, &block);
+    ruleBotSimBot(&e->progress.population[c].rules, &candidate);
+    first = (int)(block * e->batch);
+    last = first + e->batch < e->games ? first + e->batch : e->games;
+
+    for (g = first; g < last; g++) {
+        for (seat = 0; seat < 2; seat++) {
+            seats[seat] = &candidate;
+            seats[1 - seat] = e->opponents[o];
+            if (simPlayGame(&e->tmpl, simSeed(e->seed, e->opponentId[o], g), seats, &game) < 0) {
+                return -1;
+            }
+            if (game.winner[seat])
+                r->points += game.winner[1 - seat] ? 1 : 2;
+            r->games++;
+        }
+    }
+    return 0;
+}
+
+//everything a unit's result depends on
+static void unitKey(struct evolve *e, long unit, struct cacheKey *key) {
+    char rules[RULE_TEXT_MAX];
+    struct simBot *opponent;
+    int c, o, first;
+    long block;
+
+    unitParts(e, unit, &c, &o, &block);
+    opponent = e->opponents[o];
+    first = (int)(block * e->batch);
+    ruleBotFormat(&e->progress.population[c].rules, rules, sizeof(rules));
+
+    cacheKeyInit(key, "evolve");
+    cacheKeyAddString(key, rules);
+    cacheKeyAddString(key, opponent->name);
+    cacheKeyAddString(key, opponent->definition != NULL ? opponent->definition : "");
+    cacheKeyAdd(key, e->kingdom, sizeof(e->kingdom));
+    cacheKeyAddInt(key, e->seed);
+    cacheKeyAddInt(key, first);
+    cacheKeyAddInt(key, first + e->batch < e->games ? first + e->batch : e->games);
+}
+
+static int addResult(long unit, void *result, void *ctx) {
+    struct evolve *e = ctx;
+    struct evalResult *r = result;
+    struct individual *ind;
+    int c, o;
+    long block;
+
+    unitParts(e, unit, &c, &o, &block);
+    ind = &e->progress.population[c];
+    ind->points += r->points;
+    ind->games += r->games;
+    return 0;
+}
+
+static long nextUnit(void *ctx) {
+    struct evolve *e = ctx;
+    struct evalResult r;
+    struct cacheKey key;
+    long unit;
+    int c, o;
+    long block;
+
+    while (e->cursor < e->units) {
+        unit = e->cursor++;
+        unitParts(e, unit, &c, &o, &block);
+        if (e->progress.population[c].evaluated)
+            continue;
+        if (e->cache != NULL) {
+            unitKey(e, unit, &key);
+            if (cacheGet(e->cache, &key, &r)) {
+                addResult(unit, &r, e);
+                e->fromCache++;
+                continue;
+            }
+        }
+        return unit;
+    }
+    return -1;
+}
+
+static int collectResult(long unit, void *result, void *ctx) {
+    struct evolve *e = ctx;
+    struct cacheKey key;
+
+    if (e->cache != NULL) {
+        unitKey(e, unit, &key);
+        cachePut(e->cache, &key, result);
+    }
+    return addResult(unit, result, e);
+}
+
+static void randomRule(struct evolve *e, struct buyRule *r) {
+    int card = e->cards[randomInt(e, e->numCards)];
+
+    ruleInit(r, card, getCost(card) + randomInt(e, 3));
+    if (randomInt(e, 2)) {
+        r->count[0] = (struct ruleCount) {card, 0, randomInt(e, 4)};
+        r->numCounts = 1;
+    }
+    if (randomInt(e, 2))
+        r->maxProvinces = randomInt(e, 8);
+}
+
+static void mutate(struct evolve *e, struct ruleBot *rb) {
+    struct buyRule *r, tmp;
+    int i = randomInt(e, rb->numRules);
+
+    r = &rb->rule[i];
+    switch (randomInt(e, 6)) {
+    case 0:
+        r->minCoins += randomInt(e, 2) ? 1 : -1;
+        if (r->minCoins < 0)
+            r->minCoins = 0;
+        if (r->minCoins > RULE_COIN_CAP)
+            r->minCoins = RULE_COIN_CAP;
+        break;
+    case 1:
+        //at most some copies of the card it buys
+        if (r->numCounts == 0) {
+            r->count[0] = (struct ruleCount) {r->card, 0, randomInt(e, 4)};
+            r->numCounts = 1;
+        } else if (randomInt(e, 4) == 0)
+            r->numCounts = 0;
+        else if ((r->count[0].max += randomInt(e, 2) ? 1 : -1) < 0)
+            r->count[0].max = 0;
+        else if (r->count[0].max >= RULE_COUNT_CAP)
+            r->count[0].max = RULE_COUNT_CAP - 1;
+        break;
+    case 2:
+        if (r->maxProvinces == RULE_ANY)
+            r->maxProvinces = randomInt(e, 8);
+        else if (randomInt(e, 4) == 0)
+            r->maxProvinces = RULE_ANY;
+        else if ((r->maxProvinces += randomInt(e, 2) ? 1 : -1) < 0)
+            r->maxProvinces = 0;
+        break;
+    case 3:
+        if (i + 1 < rb->numRules) {
+            tmp = rb->rule[i];
+            rb->rule[i] = rb->rule[i + 1];
+            rb->rule[i + 1] = tmp;
+        }
+        break;
+    case 4:
+        if (rb->numRules < RULE_MAX) {
+            memmove(&rb->rule[i + 1], &rb->rule[i], (rb->numRules - i) * sizeof(struct buyRule));
+            randomRule(e, &rb->rule[i]);
+            rb->numRules++;
+        }
+        break;
+    default:
+        if (rb->numRules > 1) {
+            memmove(&rb->rule[i], &rb->rule[i + 1], (rb->numRules - i - 1) * sizeof(struct buyRule));
+            rb->numRules--;
+        }
+        break;
+    }
+}
+
+//one-point crossover: a's rules up to a cut, then b's from another
+static void crossover(struct evolve *e, struct ruleBot *a, struct ruleBot *b, struct ruleBot *child) {
+    int cutA = 1 + randomInt(e, a->numRules);
+    int cutB = randomInt(e, b->numRules);
+    int i;
+
+    memset(child, 0, sizeof(struct ruleBot));
+    for (i = 0; i < cutA; i++) {
+        child->rule[child->numRules++] = a->rule[i];
+    }
+    for (i = cutB; i < b->numRules && child->numRules < RULE_MAX; i++) {
+        child->rule[child->numRules++] = b->rule[i];
+    }
+}
+
+static struct individual* pickParent(struct evolve *e) {
+    struct individual *best = NULL, *ind;
+    int i;
+
+    for (i = 0; i < SELECTION; i++) {
+        ind = &e->progress.population[randomInt(e, e->populationSize)];
+        if (best == NULL || fitness(ind) > fitness(best))
+            best = ind;
+    }
+    return best;
+}
+
+static int byFitness(const void *a, const void *b) {
+    double fa = fitness((struct individual*)a);
+    double fb = fitness((struct individual*)b);
+    return fa < fb ? 1 : (fa > fb ? -1 : 0);
+}
+
+static void breed(struct evolve *e) {
+    static struct individual next[MAX_POPULATION];
+    struct individual *child;
+    int i, m;
+
+    //sorted best first; qsort is not stable, but ties are broken the
+    //same way on every run with the same input
+    qsort(e->progress.population, e->populationSize, sizeof(struct individual), byFitness);
+    for (i = 0; i < e->populationSize; i++) {
+        child = &next[i];
+        if (i < ELITES) {
+            *child = e->progress.population[i];
+            continue;
+        }
+        memset(child, 0, sizeof(struct individual));
+        crossover(e, &pickParent(e)->rules, &pickParent(e)->rules, &child->rules);
+        for (m = 1 + randomInt(e, 3); m > 0; m--) {
+            mutate(e, &child->rules);
+        }
+    }
+    memcpy(e->progress.population, next, e->populationSize * sizeof(struct individual));
+    for (i = 0; i < e->populationSize; i++) {
+        snprintf(e->progress.population[i].rules.name, sizeof(e->progress.population[i].rules.name),
+                 "gen%d-%d", e->progress.generation, i);
+    }
+}
+
+static void seedPopulation(struct evolve *e) {
+    struct ruleBot *rb;
+    int i, m;
+
+    //Big Money, and variations of it; random rule lists from scratch
+    //nearly all lose every game and teach the search nothing
+    for (i = 0; i < e->populationSize; i++) {
+        rb = &e->progress.population[i].rules;
+        ruleInit(&rb->rule[0], province, 8);
+        ruleInit(&rb->rule[1], gold, 6);
+        ruleInit(&rb->rule[2], silver, 3);
+        rb->numRules = 3;
+        for (m = i == 0 ? 0 : 1 + randomInt(e, 4); m > 0; m--) {
+            mutate(e, rb);
+        }
+        snprintf(rb->name, sizeof(rb->name), "gen0-%d", i);
+    }
+}
+
+static int parseKingdom(const char *arg, int k[10]) {
+    char copy[256];
+    char *tok;
+    int n = 0;
+
+    snprintf(copy, sizeof(copy), "%s", arg);
+    for (tok = strtok(copy, ","); tok != NULL; tok = strtok(NULL, ",")) {
+        if (n == 10)
+            return -1;
+        k[n++] = atoi(tok);
+    }
+    return n == 10 ? 0 : -1;
+}
+
+//FNV-1a of a name, the opponent's seed stream
+static long nameId(const char *name) {
+    unsigned long long h = 14695981039346656037ULL;
+    int i;
+
+    for (i = 0; name[i] != '\0'; i++) {
+        h = (h ^ (unsigned char)name[i]) * 1099511628211ULL;
+    }
+    return (long)(h >> 1);
+}
+
+int main(int argc, char** argv) {
+    static struct evolve e;
+    struct evolveProgress *pr = &e.progress;
+    struct runner r;
+    const char *opponentList = "bigmoney,smithy";
+    const char *ckptPath = "evolve.ckpt";
+    const char *cachePath = NULL;
+    const char *outPath = "best.rules";
+    int defaultKingdom[10] = {adventurer, gardens, embargo, village, minion, mine,
+                              cutpurse, sea_hag, tribute, smithy
+                             };
+    int base[] = {estate, duchy, province, silver, gold};
+    char list[256], rules[RULE_TEXT_MAX];
+    char *name;
+    struct individual *ind;
+    double mean;
+    int i, loaded;
+
+    memset(&r, 0, sizeof(r));
+    r.workers = runnerDefaultWorkers();
+    memcpy(e.kingdom, defaultKingdom, sizeof(defaultKingdom));
+    e.populationSize = 24;
+    e.generations = 10;
+    e.games = 200;
+    e.batch = 50;
+    e.seed = 1;
+
+    for (i = 1; i + 1 < argc; i += 2) {
+        if (strcmp(argv[i], "-opponents") == 0)
+            opponentList = argv[i + 1];
+        else if (strcmp(argv[i], "-population") == 0)
+            e.populationSize = atoi(argv[i + 1]);
+        else if (strcmp(argv[i], "-generations") == 0)
+            e.generations = atoi(argv[i + 1]);
+        else if (strcmp(argv[i], "-games") == 0)
+            e.games = atoi(argv[i + 1]);
+        else if (strcmp(argv[i], "-batch") == 0)
+            e.batch = atoi(argv[i + 1]);
+        else if (strcmp(argv[i], "-seed") == 0)
+            e.seed = atoi(argv[i + 1]);
+        else if (strcmp(argv[i], "-workers") == 0)
+            r.workers = atoi(argv[i + 1]);
+        else if (strcmp(argv[i], "-kingdom") == 0 && parseKingdom(argv[i + 1], e.kingdom) == 0)
+            ;
+        else if (strcmp(argv[i], "-checkpoint") == 0)
+            ckptPath = argv[i + 1];
+        else if (strcmp(argv[i], "-cache") == 0)
+            cachePath = argv[i + 1];
+        else if (strcmp(argv[i], "-out") == 0)
+            outPath = argv[i + 1];
+        else
+            break;
+    }
+    if (i < argc || e.populationSize <= ELITES || e.populationSize > MAX_POPULATION ||
+            e.generations < 1 || e.games < 1 || e.batch < 1 ||
+            initializeGameTemplate(2, e.kingdom, &e.tmpl) < 0) {
+        printf("Usage: evolve [-opponents a,b,...] [-population n] [-generations n]\n"
+               "              [-games n] [-batch n] [-seed n] [-workers n]\n"
+               "              [-kingdom k1,..,k10] [-checkpoint file] [-cache file]\n"
+               "              [-out file]\n"
+               "opponents: %s\n", simBotNames());
+        return 1;
+    }
+    e.tmpl.playerStreams = 1;
+
+    snprintf(list, sizeof(list), "%s", opponentList);
+    for (name = strtok(list, ","); name != NULL; name = strtok(NULL, ",")) {
+        if (e.numOpponents == MAX_OPPONENTS ||
+                (e.opponents[e.numOpponents] = simFindBot(name)) == NULL) {
+            printf("unknown bot or too many opponents: %s (bots: %s)\n", name, simBotNames());
+            return 1;
+        }
+        e.opponentId[e.numOpponents] = nameId(e.opponents[e.numOpponents]->name);
+        e.numOpponents++;
+    }
+    if (e.numOpponents == 0) {
+        printf("need at least 1 opponent\n");
+        return 1;
+    }
+
+    //rules may buy treasure, victory cards and the kingdom
+    for (i = 0; i < (int)(sizeof(base) / sizeof(base[0])); i++) {
+        e.cards[e.numCards++] = base[i];
+    }
+    for (i = 0; i < 10; i++) {
+        e.cards[e.numCards++] = e.kingdom[i];
+    }
+
+    e.blocks = (e.games + e.batch - 1) / e.batch;
+    e.units = e.blocks * e.numOpponents * e.populationSize;
+
+    //a checkpoint only resumes the run it was written by
+    snprintf(pr->config, sizeof(pr->config),
+             "opponents=%s population=%d games=%d batch=%d seed=%d "
+             "kingdom=%d,%d,%d,%d,%d,%d,%d,%d,%d,%d", opponentList, e.populationSize,
+             e.games, e.batch, e.seed, e.kingdom[0], e.kingdom[1], e.kingdom[2], e.kingdom[3],
+             e.kingdom[4], e.kingdom[5], e.kingdom[6], e.kingdom[7], e.kingdom[8], e.kingdom[9]);
+    {
+        static struct evolveProgress saved;
+        loaded = checkpointLoad(ckptPath, &saved, sizeof(saved));
+        if (loaded < 0 || (loaded == 1 && strcmp(saved.config, pr->config) != 0)) {
+            fprintf(stderr, "%s does not belong to this run\n", ckptPath);
+            return 1;
+        }
+        if (loaded == 1) {
+            *pr = saved;
+            printf("resuming at generation %d\n", pr->generation);
+        } else {
+            pr->rng = 0x9E3779B97F4A7C15ULL ^ ((unsigned long long)e.seed << 17);
+            seedPopulation(&e);
+        }
+    }
+
+    if (cachePath != NULL) {
+        e.cache = cacheOpen(cachePath, sizeof(struct evalResult), 1 << 18);
+        if (e.cache == NULL) {
+            return 1;
+        }
+    }
+
+    r.inflight = 2;
+    r.resultSize = sizeof(struct evalResult);
+    r.next = nextUnit;
+    r.work = playUnit;
+    r.collect = collectResult;
+    r.ctx = &e;
+
+    while (pr->generation < e.generations) {
+        //workers are forked per generation and see this population
+        e.cursor = 0;
+        e.fromCache = 0;
+        if (runnerRun(&r) < 0) {
+            printf("evolve failed in generation %d; rerun to resume\n", pr->generation);
+            return 1;
+        }
+
+        mean = 0;
+        for (i = 0; i < e.populationSize; i++) {
+            ind = &pr->population[i];
+            ind->evaluated = 1;
+            mean += fitness(ind) / e.populationSize;
+            if (pr->best.games == 0 || fitness(ind) > fitness(&pr->best))
+                pr->best = *ind;
+        }
+        ruleBotFormat(&pr->best.rules, rules, sizeof(rules));
+        printf("generation %d: best %.3f, mean %.3f, %ld units cached: %s\n", pr->generation,
+               fitness(&pr->best), mean, e.fromCache, rules);
+        fflush(stdout);
+
+        strcpy(pr->best.rules.name, "evolved");
+        if (ruleBotSave(outPath, &pr->best.rules) < 0) {
+            return 1;
+        }
+
+        pr->generation++;
+        breed(&e);
+        if (checkpointSave(ckptPath, pr, sizeof(*pr)) < 0) {
+            fprintf(stderr, "cannot write %s\n", ckptPath);
+        }
+    }
+
+    cacheClose(e.cache);
+    printf("best rules (%.3f against %s) written to %s\n", fitness(&pr->best), opponentList,
+           outPath);
+    return 0;
+}
@@ -0,0 +1,440 @@
+/* Multi-session game server.
+
+   Serves many interactive games at once over a Unix domain socket: one
+   game per connection, driven by the same commands as player.c and
+   answered with the same text, each answer ending in the "$ " prompt.
+   One thread runs an epoll loop over all sessions; game states come from
+   the state pool, and each session keeps its own random number stream
+   position, so its game depends only on its seed and its commands, not
+   on how sessions interleave.  Bot seats are played by a sim bot (see
+   sim.h) rather than player.c's executeBotTurn.
+
+   The engine does not check its arguments, so commands are checked here
+   before they reach it.
+
+   Usage: gameserver [-socket path] [-bot name] [-max sessions]
+   then e.g. ./loadgen, or nc -U dominion.sock and "init 2 1" */
+
+#define _GNU_SOURCE
+
+#include "dominion.h"
+#include "dominion_helpers.h"
+#include "hist.h"
+#include "interface.h"
+#include "pool.h"
+#include "rngs.h"
+#include "sim.h"
+#include <errno.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#define SESSION_LINE 256
+#define SESSION_MAX_OUTPUT (1 << 20)    //unread output before a session is dropped
+#define SCRATCH_SIZE (1 << 16)          //output of one command
+#define EVENTS 256
+
+struct session {
+    int fd;
+    int id;
+    struct gameState *game;
+    int started;
+    int turnNum;
+    int isBot[MAX_PLAYERS];
+    long rngSeed;               //stream 1 position between commands
+    char in[SESSION_LINE];
+    int inLen;
+    char *out;
+    size_t outLen;
+    size_t outSent;
+    size_t outCap;
+    int writing;                //registered for EPOLLOUT
+    int closing;                //close once output is sent
+};
+
+static const char greeting[] = "Please enter a command or \"help\" for commands\n$ ";
+
+static int kCards[10] = {adventurer, gardens, embargo, village, minion, mine, cutpurse, sea_hag, tribute, smithy};
+
+static struct simBot *botPlayer;
+static struct latencyHist commandHist;
+static int epollFd;
+static int numSessions;
+static long long totalSessions;
+static volatile sig_atomic_t stopping;
+
+static void onSignal(int sig) {
+    (void)sig;
+    stopping = 1;
+}
+
+static int append(struct session *s, const char *data, size_t n) {
+    char *grown;
+    size_t cap;
+
+    if (s->outLen + n > s->outCap) {
+        if (s->outLen - s->outSent + n > SESSION_MAX_OUTPUT)
+            return -1;
+        //drop what was sent before growing
+        memmove(s->out, s->out + s->outSent, s->outLen - s->outSent);
+        s->outLen -= s->outSent;
+        s->outSent = 0;
+        for (cap = s->outCap ? s->outCap : 4096; cap < s->outLen + n; cap *= 2)
+            ;
+        if (cap != s->outCap) {
+            grown = realloc(s->out, cap);
+            if (grown == NULL)
+                return -1;
+            s->out = grown;
+            s->outCap = cap;
+        }
+    }
+    memcpy(s->out + s->outLen, data, n);
+    s->outLen += n;
+    return 0;
+}
+
+static void runBots(struct session *s, FILE *out) {
+    struct gameState *game = s->game;
+    int players[MAX_PLAYERS];
+    int player, playerNum;
+
+    while (s->started && !isGameOver(game) && s->isBot[whoseTurn(game)] &&
+            s->turnNum < SIM_MAX_TURNS) {
+        player = whoseTurn(game);
+        fprintf(out, "*****************Executing Bot Player %d Turn Number %d*****************\n",
+                player, s->turnNum);
+        if (player == game->numPlayers - 1)
+            s->turnNum++;
+        simPlayTurn(game, botPlayer);
+        if (!isGameOver(game))
+            fprintf(out, "Player %d's turn number %d\n\n", whoseTurn(game), s->turnNum);
+    }
+
+    if (s->started && (isGameOver(game) || s->turnNum >= SIM_MAX_TURNS)) {
+        fprintScores(out, game);
+        getWinners(players, game);
+        fprintf(out, "After %d turns, the winner(s) are:\n", s->turnNum);
+        for (playerNum = 0; playerNum < game->numPlayers; playerNum++) {
+            if (players[playerNum] == WINNER)
+                fprintf(out, "Player %d\n", playerNum);
+        }
+        fprintf(out, "Game over; init starts another\n\n");
+        s->started = FALSE;
+    }
+}
+
+//one line of input, as player.c's main loop
+static void handleCommand(struct session *s, const char *line, FILE *out) {
+    char command[MAX_STRING_LENGTH] = "";
+    char cardName[MAX_STRING_LENGTH] = "";
+    struct gameState *game = s->game;
+    int arg0 = UNUSED, arg1 = UNUSED, arg2 = UNUSED, arg3 = UNUSED;
+    int currentPlayer, outcome, playerNum, card;
+
+    sscanf(line, "%31s %d %d %d %d", command, &arg0, &arg1, &arg2, &arg3);
+    if (command[0] == '\0')
+        return;
+
+    if (COMPARE(command, "exit") == 0) {
+        s->closing = TRUE;
+        return;
+    } else if (COMPARE(command, "help") == 0) {
+        fprintHelp(out);
+        return;
+    } else if (COMPARE(command, "lat") == 0) {
+        fprintf(out, "command n=%llu p50=%.1fus p99=%.1fus p99.9=%.1fus (all sessions)\n\n",
+                commandHist.count, histPercentile(&commandHist, 50.0) / 1000.0,
+                histPercentile(&commandHist, 99.0) / 1000.0, histPercentile(&commandHist, 99.9) / 1000.0);
+        return;
+    } else if (COMPARE(command, "init") == 0) {
+        //an optional third number is the seed; sessions differ by default
+        if (arg0 < 2 || arg0 > MAX_PLAYERS || arg1 < 0 || arg1 > arg0) {
+            fprintf(out, "Usage: init [Number of Players] [Number of Bots] [Seed]\n\n");
+            return;
+        }
+        memset(s->isBot, 0, sizeof(s->isBot));
+        for (playerNum = arg0 - arg1; playerNum < arg0; playerNum++) {
+            s->isBot[playerNum] = TRUE;
+        }
+        memset(game, 0, sizeof(struct gameState));
+        s->turnNum = 0;
+        outcome = initializeGame(arg0, kCards, arg2 > 0 ? arg2 : s->id, game);
+        fprintf(out, "\n");
+        if (outcome == SUCCESS) {
+            s->started = TRUE;
+            fprintf(out, "Player %d's turn number %d\n\n", whoseTurn(game), s->turnNum);
+        }
+        return;
+    } else if (!s->started) {
+        fprintf(out, "No game in progress; use init\n\n");
+        return;
+    }
+
+    currentPlayer = whoseTurn(game);
+    if (COMPARE(command, "add") == 0) {
+        outcome = game->handCount[currentPlayer] < MAX_HAND ? addCardToHand(currentPlayer, arg0, game) : FAILURE;
+        cardNumToName(arg0, cardName);
+        if (outcome == SUCCESS)
+            fprintf(out, "Player %d adds %s to their hand\n\n", currentPlayer, cardName);
+        else
+            fprintf(out, "Player %d cannot add card %d\n\n", currentPlayer, arg0);
+    } else if (COMPARE(command, "buy") == 0) {
+        outcome = arg0 >= curse && arg0 <= treasure_map ? buyCard(arg0, game) : FAILURE;
+        cardNumToName(arg0, cardName);
+        if (outcome == SUCCESS)
+            fprintf(out, "Player %d buys card %d, %s\n\n", currentPlayer, arg0, cardName);
+        else
+            fprintf(out, "Player %d cannot buy card %d, %s\n\n", currentPlayer, arg0, cardName);
+    } else if (COMPARE(command, "end") == 0) {
+        if (currentPlayer == game->numPlayers - 1)
+            s->turnNum++;
+        endTurn(game);
+        fprintf(out, "Player %d's turn number %d\n\n", whoseTurn(game), s->turnNum);
+    } else if (COMPARE(command, "num") == 0) {
+        fprintf(out, "There are %d cards in your hand.\n", numHandCards(game));
+    } else if (COMPARE(command, "play") == 0) {
+        if (canPlayCard(arg0, arg1, arg2, arg3, game)) {
+            card = handCard(arg0, game);
+            outcome = playCard(arg0, arg1, arg2, arg3, game);
+        } else {
+            card = -1;
+            outcome = FAILURE;
+        }
+        cardNumToName(card, cardName);
+        if (outcome == SUCCESS)
+            fprintf(out, "Player %d plays %s\n\n", currentPlayer, cardName);
+        else
+            fprintf(out, "Player %d cannot play card %d\n\n", currentPlayer, arg0);
+    } else if (COMPARE(command, "resi") == 0) {
+        endTurn(game);
+        fprintScores(out, game);
+        fprintf(out, "Game over; init starts another\n\n");
+        s->started = FALSE;
+    } else if (COMPARE(command, "show") == 0) {
+        fprintHand(out, currentPlayer, game);
+        fprintPlayed(out, currentPlayer, game);
+    } else if (COMPARE(command, "stat") == 0) {
+        fprintState(out, game);
+    } else if (COMPARE(command, "supp") == 0) {
+        fprintSupply(out, game);
+    } else if (COMPARE(command, "whos") == 0) {
+        fprintf(out, "Player %d's turn\n", currentPlayer);
+    }
+}
+
+static void closeSession(struct session *s) {
+    epoll_ctl(epollFd, EPOLL_CTL_DEL, s->fd, NULL);
+    close(s->fd);
+    poolRelease(s->game);
+    free(s->out);
+    free(s);
+    numSessions--;
+}
+
+//send what we can; keep EPOLLOUT on only while output is left
+static int flush(struct session *s) {
+    struct epoll_event ev;
+    ssize_t n;
+    int want;
+
+    while (s->outSent < s->outLen) {
+        n = send(s->fd, s->out + s->outSent, s->outLen - s->outSent, MSG_NOSIGNAL);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n < 0 && errno == EAGAIN)
+            break;
+        if (n <= 0)
+            return -1;
+        s->outSent += n;
+    }
+    if (s->outSent == s->outLen) {
+        s->outSent = s->outLen = 0;
+        if (s->closing)
+            return -1;
+    }
+
+    want = s->outLen > 0;
+    if (want != s->writing) {
+        ev.events = EPOLLIN | (want ? EPOLLOUT : 0);
+        ev.data.ptr = s;
+        epoll_ctl(epollFd, EPOLL_CTL_MOD, s->fd, &ev);
+        s->writing = want;
+    }
+    return 0;
+}
+
+static int runLine(struct session *s, const char *line) {
+    static char scratch[SCRATCH_SIZE];
+    unsigned long long started = histNow();
+    FILE *out = fmemopen(scratch, sizeof(scratch), "w");
+    long n;
+
+    if (out == NULL)
+        return -1;
+    //the engine's generator is global; give it this session's position
+    if (s->started) {
+        SelectStream(1);
+        PutSeed(s->rngSeed);
+    }
+    handleCommand(s, line, out);
+    runBots(s, out);
+    if (s->started) {
+        SelectStream(1);
+        GetSeed(&s->rngSeed);
+    }
+    if (!s->closing)
+        fprintf(out, "$ ");
+    n = ftell(out);
+    fclose(out);
+    histRecord(&commandHist, histNow() - started);
+    return append(s, scratch, n < (long)sizeof(scratch) ? n : (long)sizeof(scratch) - 1);
+}
+
+static int readInput(struct session *s) {
+    char *newline;
+    ssize_t n;
+    int used;
+
+    for (;;) {
+        n = recv(s->fd, s->in + s->inLen, sizeof(s->in) - 1 - s->inLen, 0);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n < 0 && errno == EAGAIN)
+            return 0;
+        if (n <= 0)
+            return -1;
+        s->inLen += n;
+        s->in[s->inLen] = '\0';
+
+        used = 0;
+        while (!s->closing && (newline = strchr(s->in + used, '\n')) != NULL) {
+            *newline = '\0';
+            if (runLine(s, s->in + used) < 0)
+                return -1;
+            used = newline + 1 - s->in;
+        }
+        //a line longer than the buffer is taken as it is
+        if (used == 0 && s->inLen == (int)sizeof(s->in) - 1) {
+            if (runLine(s, s->in) < 0)
+                return -1;
+            used = s->inLen;
+        }
+        memmove(s->in, s->in + used, s->inLen - used);
+        s->inLen -= used;
+        if (s->closing)
+            return 0;
+    }
+}
+
+static void acceptSessions(int listenFd, int maxSessions) {
+    struct epoll_event ev;
+    struct session *s;
+    int fd;
+
+    while ((fd = accept4(listenFd, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC)) >= 0) {
+        s = numSessions < maxSessions ? calloc(1, sizeof(struct session)) : NULL;
+        if (s == NULL || (s->game = poolAcquire()) == NULL) {
+            free(s);
+            close(fd);
+            continue;
+        }
+        memset(s->game, 0, sizeof(struct gameState));
+        s->fd = fd;
+        s->id = (int)(++totalSessions % 2000000000);
+        ev.events = EPOLLIN;
+        ev.data.ptr = s;
+        epoll_ctl(epollFd, EPOLL_CTL_ADD, fd, &ev);
+        numSessions++;
+        if (append(s, greeting, sizeof(greeting) - 1) < 0 || flush(s) < 0)
+            closeSession(s);
+    }
+}
+
+int main(int argc, char** argv) {
+    const char *socketPath = "dominion.sock";
+    const char *botName = "bigmoney";
+    struct sockaddr_un addr;
+    struct epoll_event ev, events[EVENTS];
+    struct sigaction sa;
+    struct rlimit files;
+    struct session *s;
+    int maxSessions = 10000;
+    int listenFd, i, n;
+
+    for (i = 1; i + 1 < argc; i += 2) {
+        if (strcmp(argv[i], "-socket") == 0)
+            socketPath = argv[i + 1];
+        else if (strcmp(argv[i], "-bot") == 0)
+            botName = argv[i + 1];
+        else if (strcmp(argv[i], "-max") == 0)
+            maxSessions = atoi(argv[i + 1]);
+        else
+            break;
+    }
+    if (i < argc || maxSessions < 1 || strlen(socketPath) >= sizeof(addr.sun_path)) {
+        printf("Usage: gameserver [-socket path] [-bot name] [-max sessions]\nbots: %s\n", simBotNames());
+        return 1;
+    }
+    botPlayer = simFindBot(botName);
+    if (botPlayer == NULL) {
+        printf("unknown bot: %s (bots: %s)\n", botName, simBotNames());
+        return 1;
+    }
+
+    //a descriptor per session
+    if (getrlimit(RLIMIT_NOFILE, &files) == 0 && files.rlim_cur < files.rlim_max) {
+        files.rlim_cur = files.rlim_max;
+        setrlimit(RLIMIT_NOFILE, &files);
+    }
+
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strcpy(addr.sun_path, socketPath);
+    unlink(socketPath);
+    listenFd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (listenFd < 0 || bind(listenFd, (struct sockaddr*)&addr, sizeof(addr)) < 0 ||
+            listen(listenFd, SOMAXCONN) < 0) {
+        perror(socketPath);
+        return 1;
+    }
+
+    epollFd = epoll_create1(EPOLL_CLOEXEC);
+    ev.events = EPOLLIN;
+    ev.data.ptr = NULL;
+    epoll_ctl(epollFd, EPOLL_CTL_ADD, listenFd, &ev);
+
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = onSignal;
+    sigaction(SIGINT, &sa, NULL);
+    sigaction(SIGTERM, &sa, NULL);
+    histInit(&commandHist);
+    printf("serving on %s, bot seats played by %s\n", socketPath, botPlayer->name);
+    fflush(stdout);
+
+    while (!stopping) {
+        n = epoll_wait(epollFd, events, EVENTS, -1);
+        for (i = 0; i < n; i++) {
+            s = events[i].data.ptr;
+            if (s == NULL) {
+                acceptSessions(listenFd, maxSessions);
+                continue;
+            }
+            if (((events[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR)) && readInput(s) < 0) ||
+                    flush(s) < 0)
+                closeSession(s);
+        }
+    }
+
+    printf("%lld sessions served\n", totalSessions);
+    histPrint("command", &commandHist);
+    close(listenFd);
+    unlink(socketPath);
+    return 0;
+}
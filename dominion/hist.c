@@ -0,0 +1,80 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include "hist.h"
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+unsigned long long histNow(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (unsigned long long)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+void histInit(struct latencyHist *h) {
+    memset(h, 0, sizeof(struct latencyHist));
+    h->min = ~0ULL;
+}
+
+void histMerge(struct latencyHist *into, const struct latencyHist *from) {
+    int i;
+
+    for (i = 0; i < HIST_BUCKETS; i++) {
+        into->bucket[i] += from->bucket[i];
+    }
+    into->count += from->count;
+    into->sum += from->sum;
+    if (from->max > into->max)
+        into->max = from->max;
+    if (from->min < into->min)
+        into->min = from->min;
+}
+
+//largest value that falls in the bucket
+static unsigned long long bucketHigh(int index) {
+    int shift;
+    unsigned long long sub;
+
+    if (index < HIST_SUB_COUNT) {
+        return (unsigned long long)index;
+    }
+    shift = index / HIST_HALF_COUNT - 1;
+    sub = (unsigned long long)(index - shift * HIST_HALF_COUNT);
+    return ((sub + 1) << shift) - 1;
+}
+
+unsigned long long histPercentile(const struct latencyHist *h, double percent) {
+    unsigned long long rank, seen = 0;
+    int i;
+
+    if (h->count == 0) {
+        return 0;
+    }
+
+    rank = (unsigned long long)(percent / 100.0 * h->count + 0.5);
+    if (rank < 1)
+        rank = 1;
+    if (rank > h->count)
+        rank = h->count;
+
+    for (i = 0; i < HIST_BUCKETS; i++) {
+        seen += h->bucket[i];
+        if (seen >= rank) {
+            //never report more than was actually seen
+            unsigned long long high = bucketHigh(i);
+            return high < h->max ? high : h->max;
+        }
+    }
+    return h->max;
+}
+
+void histPrint(const char *label, const struct latencyHist *h) {
+    if (h->count == 0) {
+        printf("%-10s n=0\n", label);
+        return;
+    }
+    printf("%-10s n=%llu mean=%.1fus p50=%.1fus p99=%.1fus p99.9=%.1fus max=%.1fus\n",
+           label, h->count, (double)h->sum / h->count / 1000.0,
+           histPercentile(h, 50.0) / 1000.0, histPercentile(h, 99.0) / 1000.0,
+           histPercentile(h, 99.9) / 1000.0, h->max / 1000.0);
+}
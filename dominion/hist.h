@@ -0,0 +1,54 @@
+#ifndef _HIST_H
+#define _HIST_H
+
+/* Latency histograms with HDR-style log buckets: values below 32 get a
+   bucket each, above that every power of two is split into 16 linear
+   sub-buckets, so any recorded value is known to within ~6%.  Recording
+   is a count-leading-zeros, a shift and an increment. */
+
+#define HIST_SUB_BITS 5
+#define HIST_SUB_COUNT (1 << HIST_SUB_BITS)
+#define HIST_HALF_COUNT (HIST_SUB_COUNT / 2)
+#define HIST_BUCKETS ((64 - HIST_SUB_BITS + 1) * HIST_HALF_COUNT + HIST_HALF_COUNT)
+
+struct latencyHist {
+    unsigned long long count;
+    unsigned long long min;
+    unsigned long long max;
+    unsigned long long sum;
+    unsigned long long bucket[HIST_BUCKETS];
+};
+
+void histInit(struct latencyHist *h);
+
+void histMerge(struct latencyHist *into, const struct latencyHist *from);
+
+unsigned long long histPercentile(const struct latencyHist *h, double percent);
+/* Highest value equivalent to the given percentile (0-100), 0 if empty */
+
+void histPrint(const char *label, const struct latencyHist *h);
+/* One line: count, mean, p50, p99, p99.9 and max in microseconds */
+
+unsigned long long histNow(void);
+/* Monotonic clock in nanoseconds */
+
+static inline int histBucket(unsigned long long value) {
+    int shift;
+    if (value < HIST_SUB_COUNT) {
+        return (int)value;
+    }
+    shift = 63 - __builtin_clzll(value) - HIST_SUB_BITS + 1;
+    return shift * HIST_HALF_COUNT + (int)(value >> shift);
+}
+
+static inline void histRecord(struct latencyHist *h, unsigned long long value) {
+    h->bucket[histBucket(value)]++;
+    h->count++;
+    h->sum += value;
+    if (value > h->max)
+        h->max = value;
+    if (value < h->min)
+        h->min = value;
+}
+
+#endif
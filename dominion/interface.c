@@ -11,6 +11,7 @@ Sam Heinith CS362
 #include "rngs.h"
 #include "interface.h"
 #include "dominion.h"
+#include "buyplan.h"
 
 
 void cardNumToName(int card, char *name) {
@@ -200,18 +201,22 @@ int getCardCost(int card) {
 
 
 
-void printHand(int player, struct gameState *game) {
+void fprintHand(FILE *out, int player, struct gameState *game) {
     int handCount = game->handCount[player];
     int handIndex;
-    printf("Player %d's hand:\n", player);
-    if(handCount > 0) printf("#  Card\n");
+    fprintf(out, "Player %d's hand:\n", player);
+    if(handCount > 0) fprintf(out, "#  Card\n");
     for(handIndex = 0; handIndex < handCount; handIndex++) {
         int card = game->hand[player][handIndex];
         char name[MAX_STRING_LENGTH];
         cardNumToName(card, name);
-        printf("%-2d %-13s\n", handIndex, name);
+        fprintf(out, "%-2d %-13s\n", handIndex, name);
     }
-    printf("\n");
+    fprintf(out, "\n");
+}
+
+void printHand(int player, struct gameState *game) {
+    fprintHand(stdout, player, game);
 }
 
 
@@ -230,18 +235,22 @@ void printDeck(int player, struct gameState *game) {
     printf("\n");
 }
 
-void printPlayed(int player, struct gameState *game) {
+void fprintPlayed(FILE *out, int player, struct gameState *game) {
     int playedCount = game->playedCardCount;
     int playedIndex;
-    printf("Player %d's played cards: \n", player);
-    if(playedCount > 0) printf("#  Card\n");
+    fprintf(out, "Player %d's played cards: \n", player);
+    if(playedCount > 0) fprintf(out, "#  Card\n");
     for(playedIndex = 0; playedIndex < playedCount; playedIndex++) {
         int card = game->playedCards[playedIndex];
         char name[MAX_STRING_LENGTH];
         cardNumToName(card, name);
-        printf("%-2d %-13s \n", playedIndex, name);
+        fprintf(out, "%-2d %-13s \n", playedIndex, name);
     }
-    printf("\n");
+    fprintf(out, "\n");
+}
+
+void printPlayed(int player, struct gameState *game) {
+    fprintPlayed(stdout, player, game);
 }
 
 
@@ -263,23 +272,27 @@ void printDiscard(int player, struct gameState *game) {
 
 
 
-void printSupply(struct gameState *game) {
+void fprintSupply(FILE *out, struct gameState *game) {
     int cardNum, cardCost, cardCount;
     char name[MAX_STRING_LENGTH];
-    printf("#   Card          Cost   Copies\n");
+    fprintf(out, "#   Card          Cost   Copies\n");
     for(cardNum = 0; cardNum < NUM_TOTAL_K_CARDS; cardNum++) {
         cardCount = game->supplyCount[cardNum];
         if(cardCount == -1) continue;
         cardNumToName(cardNum, name);
         cardCost = getCardCost(cardNum);
-        printf("%-2d  %-13s %-5d  %-5d", cardNum, name, cardCost, cardCount);
-        printf("\n");
+        fprintf(out, "%-2d  %-13s %-5d  %-5d", cardNum, name, cardCost, cardCount);
+        fprintf(out, "\n");
     }
-    printf("\n");
+    fprintf(out, "\n");
 }
 
+void printSupply(struct gameState *game) {
+    fprintSupply(stdout, game);
+}
 
-void printState(struct gameState *game) {
+
+void fprintState(FILE *out, struct gameState *game) {
     int numActions = game->numActions;
     int numCoins = game->coins;
     int numBuys = game->numBuys;
@@ -287,25 +300,34 @@ void printState(struct gameState *game) {
     int phase = game->phase;
     char phaseName[MAX_STRING_LENGTH];
     phaseNumToName(phase,phaseName);
-    printf("Player %d:\n%s phase\n%d actions\n%d coins\n%d buys\n\n", currentPlayer, phaseName, numActions, numCoins, numBuys);
+    fprintf(out, "Player %d:\n%s phase\n%d actions\n%d coins\n%d buys\n\n", currentPlayer, phaseName, numActions, numCoins, numBuys);
 }
 
-void printScores(struct gameState *game) {
+void printState(struct gameState *game) {
+    fprintState(stdout, game);
+}
+
+void fprintScores(FILE *out, struct gameState *game) {
     int playerNum, score[MAX_PLAYERS];
     int numPlayers = game->numPlayers;
     for(playerNum = 0; playerNum < numPlayers; playerNum++) {
         score[playerNum] = scoreFor(playerNum,game);
-        printf("Player %d has a score of %d\n", playerNum, score[playerNum]);
+        fprintf(out, "Player %d has a score of %d\n", playerNum, score[playerNum]);
     }
 }
 
+void printScores(struct gameState *game) {
+    fprintScores(stdout, game);
+}
 
-void printHelp(void) {
-    printf("Commands are: \n\
+
+void fprintHelp(FILE *out) {
+    fprintf(out, "Commands are: \n\
   add [Supply Card Number] 			- add any card to your hand (teh hacks)\n\
   buy [Supply Card Number] 			- buy a card at supply position\n\
   end 			      			- end your turn\n\
   init [Number of Players] [Number of Bots] 	- initialize the game\n\
+  lat 						- show turn latency percentiles\n\
   num 			      			- print number of cards in your hand\n\
   play [Hand Index] [Choice] [Choice] [Choice]	- play a card from your hand\n\
   resign					- end the game showing the current scores\n\
@@ -314,8 +336,12 @@ void printHelp(void) {
   supp 						- show the supply\n\
   whos 			      			- whos turn\n\
   exit 			      			- exit the interface");
-    printf("\n\n");
+    fprintf(out, "\n\n");
+
+}
 
+void printHelp(void) {
+    fprintHelp(stdout);
 }
 
 
@@ -339,6 +365,7 @@ int addCardToHand(int player, int card, struct gameState *game) {
         int handTop = game->handCount[player];
         game->hand[player][handTop] = card;
         game->handCount[player]++;
+        stateHashReset(game);
         return SUCCESS;
     } else {
         return FAILURE;
@@ -390,36 +417,65 @@ int countHandCoins(int player, struct gameState *game) {
 }
 
 
-void executeBotTurn(int player, int *turnNum, struct gameState *game) {
-    int coins = countHandCoins(player, game);
+//what the bot buys: provinces, then gold, then silver
+static int botBuyValue(int card, void *ctx) {
+    (void)ctx;
+    switch(card) {
+    case province:
+        return 100;
+    case gold:
+        return 30;
+    case silver:
+        return 10;
+    }
+    return 0;
+}
 
-    printf("*****************Executing Bot Player %d Turn Number %d*****************\n", player, *turnNum);
-    printSupply(game);
-    //sleep(1); //Thinking...
+//out may be NULL for a bot turn with no output
+void fexecuteBotTurn(FILE *out, int player, int *turnNum, struct gameState *game) {
+    const struct buyTable *table = buyTableFor(game, botBuyValue, NULL);
+    struct buyPlan plan;
+    char name[MAX_STRING_LENGTH];
+    int i;
 
-    if(coins >= PROVINCE_COST && supplyCount(province,game) > 0) {
-        buyCard(province,game);
-        printf("Player %d buys card Province\n\n", player);
-    }
-    else if(supplyCount(province,game) == 0 && coins >= DUCHY_COST ) {
-        buyCard(duchy,game);
-        printf("Player %d buys card Duchy\n\n", player);
+    if(out != NULL) {
+        fprintf(out, "*****************Executing Bot Player %d Turn Number %d*****************\n", player, *turnNum);
+        fprintSupply(out, game);
     }
-    else if(coins >= GOLD_COST && supplyCount(gold,game) > 0) {
-        buyCard(gold,game);
-        printf("Player %d buys card Gold\n\n", player);
-    }
-    else if(coins >= SILVER_COST && supplyCount(silver,game) > 0) {
-        buyCard(silver,game);
-        printf("Player %d buys card Silver\n\n", player);
+    //sleep(1); //Thinking...
 
+    //the best cards the coins and buys get together, from the kingdom's
+    //table (buyplan.h)
+    plan.count = 0;
+    if(table != NULL) buyTablePlan(table, game, countHandCoins(player, game), game->numBuys, &plan);
+    for(i = 0; i < plan.count; i++) {
+        buyCard(plan.cards[i],game);
+        cardNumToName(plan.cards[i], name);
+        if(out != NULL) fprintf(out, "Player %d buys card %s\n\n", player, name);
     }
 
-
     if(player == (game->numPlayers -1)) (*turnNum)++;
     endTurn(game);
-    if(! isGameOver(game)) {
+    if(out != NULL && ! isGameOver(game)) {
         int currentPlayer = whoseTurn(game);
-        printf("Player %d's turn number %d\n\n", currentPlayer, (*turnNum));
+        fprintf(out, "Player %d's turn number %d\n\n", currentPlayer, (*turnNum));
     }
 }
+
+void executeBotTurn(int player, int *turnNum, struct gameState *game) {
+    fexecuteBotTurn(stdout, player, turnNum, game);
+}
+
+int canPlayCard(int handPos, int choice1, int choice2, int choice3, struct gameState *game) {
+    int player = whoseTurn(game);
+    int limit = game->handCount[player] > NUM_TOTAL_K_CARDS ? game->handCount[player] : NUM_TOTAL_K_CARDS;
+
+    if(handPos < 0 || handPos >= game->handCount[player]) return FALSE;
+    //each choice is a hand position or a card number, depending on the card
+    if(choice1 < -1 || choice1 >= limit || choice2 < -1 || choice2 >= limit ||
+            choice3 < -1 || choice3 >= limit) return FALSE;
+    //feast asks for its card until it gets one it can have
+    if(handCard(handPos, game) == feast &&
+            (choice1 < 0 || supplyCount(choice1, game) <= 0 || getCardCost(choice1) > 5)) return FALSE;
+    return TRUE;
+}
@@ -12,6 +12,7 @@
 
 
 #include "dominion.h"
+#include <stdio.h>
 
 //Last card enum (Treasure map) card number plus one for the 0th card.
 #define NUM_TOTAL_K_CARDS (treasure_map + 1)
@@ -91,6 +92,10 @@ int countHandCoins(int player, struct gameState *game);
 
 
 void executeBotTurn(int player, int *turnNum, struct gameState *game);
+void fexecuteBotTurn(FILE *out, int player, int *turnNum, struct gameState *game);
+
+int canPlayCard(int handPos, int choice1, int choice2, int choice3, struct gameState *game);
+//FALSE for a play the engine would read out of bounds or loop forever on
 
 void phaseNumToName(int phase, char *name);
 void cardNumToName(int card, char *name);
@@ -98,22 +103,28 @@ void cardNumToName(int card, char *name);
 int getCardCost(int card);
 
 void printHelp(void);
+void fprintHelp(FILE *out);
 
 void printHand(int player, struct gameState *game);
+void fprintHand(FILE *out, int player, struct gameState *game);
 
 void printDeck(int player, struct gameState *game);
 
 void printDiscard(int player, struct gameState *game);
 
 void printPlayed(int player, struct gameState *game);
+void fprintPlayed(FILE *out, int player, struct gameState *game);
 
 void printState(struct gameState *game);
+void fprintState(FILE *out, struct gameState *game);
 
 void printSupply(struct gameState *game);
+void fprintSupply(FILE *out, struct gameState *game);
 
 void printGameState(struct gameState *game);
 
 void printScores(struct gameState *game);
+void fprintScores(FILE *out, struct gameState *game);
 
 void selectKingdomCards(int randomSeed, int kingdomCards[NUM_K_CARDS]);
 
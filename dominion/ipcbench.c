@@ -0,0 +1,94 @@
+/* Decision latency of out-of-process bots.
+
+   Plays the same seeded games with one bot in-process, as a pipe: bot
+   and as an ipc: bot (see ipcbot.h) and reports the time per decision as
+   the driver sees it, round trip included.  The three must agree on
+   every game.
+
+   Usage: ipcbench [games] [bot] */
+
+#include "hist.h"
+#include "ipcbot.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+struct timedBot {
+    struct simBot *inner;
+    struct latencyHist hist;
+};
+
+static int timedAction(struct gameState *state, int choices[3], void *ctx) {
+    struct timedBot *t = ctx;
+    unsigned long long started = histNow();
+    int pos = t->inner->action(state, choices, t->inner->ctx);
+
+    histRecord(&t->hist, histNow() - started);
+    return pos;
+}
+
+static int timedBuy(struct gameState *state, void *ctx) {
+    struct timedBot *t = ctx;
+    unsigned long long started = histNow();
+    int card = t->inner->buy(state, t->inner->ctx);
+
+    histRecord(&t->hist, histNow() - started);
+    return card;
+}
+
+//plays the games with bot in both seats; returns a checksum of the scores
+static long long run(const char *label, const char *name, int games, struct gameTemplate *tmpl) {
+    static struct timedBot timed;
+    struct simBot bot, *seats[2];
+    struct simResult result;
+    unsigned long long started;
+    long long check = 0;
+    int g;
+
+    timed.inner = simFindBot(name);
+    if (timed.inner == NULL) {
+        printf("cannot start %s\n", name);
+        exit(1);
+    }
+    histInit(&timed.hist);
+    bot = *timed.inner;
+    bot.action = timedAction;
+    bot.buy = timedBuy;
+    bot.ctx = &timed;
+    seats[0] = seats[1] = &bot;
+
+    started = histNow();
+    for (g = 0; g < games; g++) {
+        simPlayGame(tmpl, simSeed(1, 0, g), seats, &result);
+        check = check * 31 + result.score[0] * 1000 + result.score[1];
+    }
+    printf("%-10s %8.0f games/s  ", label, games / ((histNow() - started) / 1e9));
+    histPrint("decision", &timed.hist);
+    return check;
+}
+
+int main(int argc, char** argv) {
+    int k[10] = {adventurer, gardens, embargo, village, minion, mine, cutpurse, sea_hag, tribute, smithy};
+    const char *botName = argc > 2 ? argv[2] : "smithy";
+    char pipeName[256], ipcName[256];
+    struct gameTemplate tmpl;
+    long long inProcess, piped, shared;
+    int games = argc > 1 ? atoi(argv[1]) : 2000;
+
+    if (games < 1 || initializeGameTemplate(2, k, &tmpl) < 0) {
+        printf("Usage: ipcbench [games] [bot]\n");
+        return 1;
+    }
+    snprintf(pipeName, sizeof(pipeName), "pipe:./botserver -pipe %s", botName);
+    snprintf(ipcName, sizeof(ipcName), "ipc:./botserver %s", botName);
+
+    inProcess = run("in-process", botName, games, &tmpl);
+    piped = run("pipe", pipeName, games, &tmpl);
+    shared = run("ring", ipcName, games, &tmpl);
+
+    if (piped != inProcess || shared != inProcess) {
+        printf("results differ between transports\n");
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,391 @@
+#define _GNU_SOURCE
+
+#include "ipcbot.h"
+#include "cache.h"
+#include "ring.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/prctl.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+
+#define IPC_MAGIC "DOMBOT1"
+#define IPC_SLOTS 4
+#define IPC_WAIT_MS 100         //between checks that the bot process lives
+#define IPC_START_MS 10000
+
+#define IPC_RING 0
+#define IPC_PIPE 1
+
+struct ipcClient {
+    char command[256];
+    int transport;
+    pid_t owner;                //process the bot process was started for
+    pid_t server;
+    struct ipcHeader *header;   //IPC_RING: the shared file
+    size_t mapSize;
+    struct ring *requests;
+    struct ring *replies;
+    int toServer;               //IPC_PIPE
+    int fromServer;
+    struct ipcRequest *message;
+    int seq;
+    char name[64];
+    char definition[48];
+    struct simBot bot;
+    struct ipcClient *next;
+};
+
+static struct ipcClient *clients;
+
+static size_t channelSize(void) {
+    return sizeof(struct ipcHeader) + ringSize(IPC_SLOTS, sizeof(struct ipcRequest)) +
+           ringSize(IPC_SLOTS, sizeof(struct ipcReply));
+}
+
+static void channelRings(struct ipcHeader *h, struct ring **requests, struct ring **replies) {
+    *requests = (struct ring*)(h + 1);
+    *replies = (struct ring*)((char*)*requests + ringSize(IPC_SLOTS, sizeof(struct ipcRequest)));
+}
+
+static int readAll(int fd, void *data, size_t size) {
+    char *p = data;
+    ssize_t n;
+
+    while (size > 0) {
+        n = read(fd, p, size);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+            return -1;
+        p += n;
+        size -= n;
+    }
+    return 0;
+}
+
+static int writeAll(int fd, const void *data, size_t size) {
+    const char *p = data;
+    ssize_t n;
+
+    while (size > 0) {
+        n = write(fd, p, size);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+            return -1;
+        p += n;
+        size -= n;
+    }
+    return 0;
+}
+
+static int serverAlive(struct ipcClient *c) {
+    return waitpid(c->server, NULL, WNOHANG) == 0;
+}
+
+static void serverLost(struct ipcClient *c) {
+    fprintf(stderr, "%s: bot process exited\n", c->command);
+    exit(1);
+}
+
+//fork and run the command; the child's end of the channel is fd (ring)
+//or stdin and stdout (pipes)
+static pid_t spawn(struct ipcClient *c, int fd, int in, int out) {
+    pid_t parent = getpid();
+    pid_t pid;
+    char number[16], script[sizeof(c->command) + 8];
+
+    //exec, so the shell does not stay between us and the bot process
+    snprintf(script, sizeof(script), "exec %s", c->command + strcspn(c->command, ":") + 1);
+    pid = fork();
+
+    if (pid != 0)
+        return pid;
+    prctl(PR_SET_PDEATHSIG, SIGTERM);
+    if (getppid() != parent)
+        _exit(1);
+    if (fd >= 0) {
+        snprintf(number, sizeof(number), "%d", fd);
+        setenv(IPC_BOT_FD_ENV, number, 1);
+    } else if (dup2(in, 0) < 0 || dup2(out, 1) < 0) {
+        _exit(127);
+    }
+    execl("/bin/sh", "sh", "-c", script, (char*)NULL);
+    _exit(127);
+}
+
+static int startRing(struct ipcClient *c) {
+    char path[] = "/dev/shm/dominion-bot-XXXXXX";
+    struct timespec pause = {0, 1000000};
+    void *map;
+    int fd, waited;
+
+    //the file only needs to exist until both sides have it open
+    fd = mkstemp(path);
+    if (fd < 0) {
+        strcpy(path, "/tmp/dominion-bot-XXXXXX");
+        fd = mkstemp(path);
+    }
+    if (fd < 0) {
+        perror("mkstemp");
+        return -1;
+    }
+    unlink(path);
+    c->mapSize = channelSize();
+    if (ftruncate(fd, c->mapSize) < 0 ||
+            (map = mmap(NULL, c->mapSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0)) == MAP_FAILED) {
+        perror("bot channel");
+        close(fd);
+        return -1;
+    }
+
+    c->header = map;
+    memcpy(c->header->magic, IPC_MAGIC, sizeof(c->header->magic));
+    c->header->version = IPC_BOT_VERSION;
+    c->header->stateSize = sizeof(struct gameState);
+    channelRings(c->header, &c->requests, &c->replies);
+    ringInit(c->requests, IPC_SLOTS, sizeof(struct ipcRequest));
+    ringInit(c->replies, IPC_SLOTS, sizeof(struct ipcReply));
+
+    c->server = spawn(c, fd, -1, -1);
+    close(fd);
+    if (c->server < 0)
+        return -1;
+    for (waited = 0; !__atomic_load_n(&c->header->ready, __ATOMIC_ACQUIRE); waited++) {
+        if (waited > IPC_START_MS || !serverAlive(c)) {
+            fprintf(stderr, "%s: bot process did not start\n", c->command);
+            return -1;
+        }
+        nanosleep(&pause, NULL);
+    }
+    snprintf(c->name, sizeof(c->name), "%.48s-ipc", c->header->name);
+    snprintf(c->definition, sizeof(c->definition), "%.47s", c->header->definition);
+    return 0;
+}
+
+static int startPipe(struct ipcClient *c) {
+    struct ipcHeader h;
+    int down[2], up[2];
+
+    if (c->message == NULL && (c->message = malloc(sizeof(struct ipcRequest))) == NULL)
+        return -1;
+    //close-on-exec, or the bot process would hold its own stdin open
+    if (pipe2(down, O_CLOEXEC) < 0 || pipe2(up, O_CLOEXEC) < 0) {
+        perror("pipe");
+        return -1;
+    }
+    c->server = spawn(c, -1, down[0], up[1]);
+    close(down[0]);
+    close(up[1]);
+    c->toServer = down[1];
+    c->fromServer = up[0];
+
+    //the bot process says hello with a header, as in the shared file
+    if (c->server < 0 || readAll(c->fromServer, &h, sizeof(h)) < 0 ||
+            memcmp(h.magic, IPC_MAGIC, sizeof(h.magic)) != 0 || h.version != IPC_BOT_VERSION ||
+            h.stateSize != (int)sizeof(struct gameState)) {
+        fprintf(stderr, "%s: bot process did not start or is for another engine version\n", c->command);
+        return -1;
+    }
+    h.name[sizeof(h.name) - 1] = '\0';
+    h.definition[sizeof(h.definition) - 1] = '\0';
+    snprintf(c->name, sizeof(c->name), "%.48s-pipe", h.name);
+    snprintf(c->definition, sizeof(c->definition), "%s", h.definition);
+    return 0;
+}
+
+//start this process's bot process, dropping any inherited from a parent
+static int startServer(struct ipcClient *c) {
+    if (c->header != NULL)
+        munmap(c->header, c->mapSize);
+    if (c->transport == IPC_PIPE && c->owner != 0) {
+        close(c->toServer);
+        close(c->fromServer);
+    }
+    c->header = NULL;
+    c->owner = getpid();
+    return c->transport == IPC_RING ? startRing(c) : startPipe(c);
+}
+
+static void call(struct ipcClient *c, int kind, struct gameState *state, struct ipcReply *reply) {
+    struct ipcRequest *request;
+    struct ipcReply *answer;
+
+    if (c->owner != getpid() && startServer(c) < 0)
+        exit(1);
+    c->seq++;
+
+    if (c->transport == IPC_PIPE) {
+        c->message->kind = kind;
+        c->message->seq = c->seq;
+        memcpy(&c->message->state, state, sizeof(struct gameState));
+        if (writeAll(c->toServer, c->message, sizeof(struct ipcRequest)) < 0 ||
+                readAll(c->fromServer, reply, sizeof(struct ipcReply)) < 0)
+            serverLost(c);
+        return;
+    }
+
+    while ((request = ringReserve(c->requests, IPC_WAIT_MS)) == NULL) {
+        if (!serverAlive(c))
+            serverLost(c);
+    }
+    request->kind = kind;
+    request->seq = c->seq;
+    memcpy(&request->state, state, sizeof(struct gameState));
+    ringPublish(c->requests);
+
+    while ((answer = ringPeek(c->replies, IPC_WAIT_MS)) == NULL) {
+        if (!serverAlive(c))
+            serverLost(c);
+    }
+    *reply = *answer;
+    ringRelease(c->replies);
+}
+
+static int ipcAction(struct gameState *state, int choices[3], void *ctx) {
+    struct ipcReply reply;
+
+    call(ctx, IPC_BOT_ACTION, state, &reply);
+    memcpy(choices, reply.choices, sizeof(reply.choices));
+    return reply.result;
+}
+
+static int ipcBuy(struct gameState *state, void *ctx) {
+    struct ipcReply reply;
+
+    call(ctx, IPC_BOT_BUY, state, &reply);
+    return reply.result;
+}
+
+struct simBot* ipcBotFind(const char *name) {
+    struct ipcClient *c;
+    int transport;
+
+    if (strncmp(name, "ipc:", 4) == 0)
+        transport = IPC_RING;
+    else if (strncmp(name, "pipe:", 5) == 0)
+        transport = IPC_PIPE;
+    else
+        return NULL;
+
+    for (c = clients; c != NULL; c = c->next) {
+        if (strcmp(c->command, name) == 0)
+            return &c->bot;
+    }
+
+    //started now, to learn the bot's name and fail early
+    c = calloc(1, sizeof(struct ipcClient));
+    if (c == NULL)
+        return NULL;
+    snprintf(c->command, sizeof(c->command), "%s", name);
+    c->transport = transport;
+    if (startServer(c) < 0) {
+        free(c->message);
+        free(c);
+        return NULL;
+    }
+    c->bot.name = c->name;
+    c->bot.action = ipcAction;
+    c->bot.buy = ipcBuy;
+    c->bot.ctx = c;
+    c->bot.definition = c->definition;
+    c->next = clients;
+    clients = c;
+    return &c->bot;
+}
+
+//what the bot process tells the driver about its bot: the command line
+//alone would not change when the bot it serves does
+static void describe(struct simBot *bot, struct ipcHeader *h) {
+    struct cacheKey key;
+
+    cacheKeyInit(&key, "ipc-bot");
+    cacheKeyAddString(&key, bot->name);
+    cacheKeyAddString(&key, bot->definition != NULL ? bot->definition : "");
+    snprintf(h->name, sizeof(h->name), "%s", bot->name);
+    snprintf(h->definition, sizeof(h->definition), "ipc %016llx%016llx", key.h1, key.h2);
+}
+
+static void answer(struct simBot *bot, struct ipcRequest *request, struct ipcReply *reply) {
+    reply->seq = request->seq;
+    reply->choices[0] = reply->choices[1] = reply->choices[2] = -1;
+    if (request->kind == IPC_BOT_ACTION)
+        reply->result = bot->action(&request->state, reply->choices, bot->ctx);
+    else
+        reply->result = bot->buy(&request->state, bot->ctx);
+}
+
+int ipcBotServe(struct simBot *bot) {
+    const char *fdText = getenv(IPC_BOT_FD_ENV);
+    struct ipcHeader *h;
+    struct ring *requests, *replies;
+    struct ipcRequest *request;
+    struct ipcReply *reply;
+    struct stat st;
+    pid_t driver = getppid();
+    int fd = fdText != NULL ? atoi(fdText) : -1;
+
+    if (fd < 0 || fstat(fd, &st) < 0 || (size_t)st.st_size != channelSize() ||
+            (h = mmap(NULL, st.st_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0)) == MAP_FAILED) {
+        fprintf(stderr, "no bot channel in $%s\n", IPC_BOT_FD_ENV);
+        return -1;
+    }
+    close(fd);
+    if (memcmp(h->magic, IPC_MAGIC, sizeof(h->magic)) != 0 || h->version != IPC_BOT_VERSION ||
+            h->stateSize != (int)sizeof(struct gameState)) {
+        fprintf(stderr, "bot channel is for another engine version\n");
+        return -1;
+    }
+
+    channelRings(h, &requests, &replies);
+    describe(bot, h);
+    __atomic_store_n(&h->ready, 1, __ATOMIC_RELEASE);
+
+    for (;;) {
+        request = ringPeek(requests, 1000);
+        if (request == NULL) {
+            if (getppid() != driver)
+                break;
+            continue;
+        }
+        reply = ringReserve(replies, -1);
+        answer(bot, request, reply);
+        ringRelease(requests);
+        ringPublish(replies);
+    }
+    munmap(h, st.st_size);
+    return 0;
+}
+
+int ipcBotServePipe(struct simBot *bot, int in, int out) {
+    struct ipcRequest *request = malloc(sizeof(struct ipcRequest));
+    struct ipcReply reply;
+    struct ipcHeader h;
+
+    if (request == NULL)
+        return -1;
+    memset(&h, 0, sizeof(h));
+    memcpy(h.magic, IPC_MAGIC, sizeof(h.magic));
+    h.version = IPC_BOT_VERSION;
+    h.stateSize = sizeof(struct gameState);
+    h.ready = 1;
+    describe(bot, &h);
+
+    if (writeAll(out, &h, sizeof(h)) == 0) {
+        while (readAll(in, request, sizeof(struct ipcRequest)) == 0) {
+            answer(bot, request, &reply);
+            if (writeAll(out, &reply, sizeof(reply)) < 0)
+                break;
+        }
+    }
+    free(request);
+    return 0;
+}
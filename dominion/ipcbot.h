@@ -0,0 +1,69 @@
+#ifndef _IPCBOT_H
+#define _IPCBOT_H
+
+#include "sim.h"
+
+/* Bots in their own process.
+
+   A bot named "ipc:<command>" runs <command> with /bin/sh and asks it for
+   every decision over two rings (see ring.h) in a shared memory file: the
+   driver publishes a request holding a copy of the game state, the bot
+   process answers on the other ring.  Nothing is serialized and no
+   system call is made while both sides are busy.  The bot process finds
+   the file as the descriptor in $DOMINION_BOT_FD and serves it with
+   ipcBotServe (./botserver <bot> serves any bot simFindBot knows).
+
+   "pipe:<command>" is the same exchange of binary messages over a pair of
+   pipes, for comparison.
+
+   The bot process is started on the first decision in each process, so
+   forked runner workers get their own, and gets SIGTERM when the process
+   that started it exits.
+
+   On starting, the bot process also publishes a checksum of the bot it
+   serves (its name, definition and engine build, see cache.h), which
+   the driver uses as the bot's definition for result cache keys, so
+   editing what the command serves does not reuse old results. */
+
+#define IPC_BOT_VERSION 2
+#define IPC_BOT_FD_ENV "DOMINION_BOT_FD"
+
+#define IPC_BOT_ACTION 1
+#define IPC_BOT_BUY 2
+
+struct ipcRequest {
+    int kind;                   //IPC_BOT_ACTION or IPC_BOT_BUY
+    int seq;
+    struct gameState state;
+};
+
+struct ipcReply {
+    int seq;
+    int result;                 //hand position or card, -1 for none
+    int choices[3];             //for IPC_BOT_ACTION
+};
+
+//start of the shared file; the request ring and then the reply ring
+//follow at 64 byte boundaries
+struct ipcHeader {
+    char magic[8];
+    int version;                //IPC_BOT_VERSION
+    int stateSize;              //sizeof(struct gameState)
+    unsigned int ready;         //set by the bot process once it serves
+    char name[48];              //the bot it serves
+    char definition[48];        //its checksum, set with name
+    char pad[12];
+};
+
+struct simBot* ipcBotFind(const char *name);
+/* Bot for an "ipc:" or "pipe:" name, or NULL (with a message on stderr)
+   if the name is neither or its process does not start */
+
+int ipcBotServe(struct simBot *bot);
+/* Answer requests for bot on the channel in $DOMINION_BOT_FD until the
+   driver goes away; -1 if there is no usable channel */
+
+int ipcBotServePipe(struct simBot *bot, int in, int out);
+/* The same over pipes: requests read from in, replies written to out */
+
+#endif
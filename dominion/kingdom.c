@@ -0,0 +1,62 @@
+#include "kingdom.h"
+
+static long binom(int n, int k) {
+    long r = 1;
+    int i;
+
+    if (k < 0 || n < k) {
+        return 0;
+    }
+    for (i = 1; i <= k; i++) {
+        r = r * (n - k + i) / i;
+    }
+    return r;
+}
+
+long kingdomCount(void) {
+    return binom(NUM_KINGDOM_CARDS, 10);
+}
+
+int kingdomFromIndex(long index, int k[10]) {
+    int i;
+    int c = NUM_KINGDOM_CARDS - 1;
+
+    if (index < 0 || index >= kingdomCount()) {
+        return -1;
+    }
+
+    //greedy: largest c with C(c, i) <= what is left, for i = 10 .. 1
+    for (i = 10; i >= 1; i--) {
+        while (binom(c, i) > index) {
+            c--;
+        }
+        index -= binom(c, i);
+        k[i - 1] = adventurer + c;
+        c--;
+    }
+    return 0;
+}
+
+long kingdomToIndex(int k[10]) {
+    int present[NUM_KINGDOM_CARDS] = {0};
+    long index = 0;
+    int i, c;
+
+    for (i = 0; i < 10; i++) {
+        c = k[i] - adventurer;
+        if (c < 0 || c >= NUM_KINGDOM_CARDS || present[c]) {
+            return -1;
+        }
+        present[c] = 1;
+    }
+
+    //the i-th smallest card c contributes C(c, i)
+    i = 1;
+    for (c = 0; c < NUM_KINGDOM_CARDS; c++) {
+        if (present[c]) {
+            index += binom(c, i);
+            i++;
+        }
+    }
+    return index;
+}
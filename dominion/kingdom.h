@@ -0,0 +1,25 @@
+#ifndef _KINGDOM_H
+#define _KINGDOM_H
+
+#include "dominion.h"
+
+/* Kingdom enumeration with the combinatorial number system.
+
+   Every set of 10 of the 20 kingdom cards (adventurer .. treasure_map) has
+   an index in [0, kingdomCount()); index order is colexicographic, so
+   consecutive indexes share most of their cards. */
+
+#define NUM_KINGDOM_CARDS (treasure_map - adventurer + 1)
+
+long kingdomCount(void);
+/* C(20,10) = 184756 */
+
+int kingdomFromIndex(long index, int k[10]);
+/* Fill k with the kingdom at index, cards in increasing order; -1 if the
+   index is out of range */
+
+long kingdomToIndex(int k[10]);
+/* Index of a kingdom given in any order; -1 if k is not 10 different
+   kingdom cards */
+
+#endif
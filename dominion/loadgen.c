@@ -0,0 +1,215 @@
+/* Load generator for gameserver.
+
+   Keeps a number of sessions open at once, each playing one game against
+   a bot seat with a fixed script per turn (show, stat, a buy, end) until
+   the game ends or a turn limit, then exiting.  Every command is timed
+   from sending it to reading back the "$ " prompt that ends its answer.
+
+   Usage: loadgen [-socket path] [-sessions n] [-concurrency n] [-turns n] */
+
+#define _GNU_SOURCE
+
+#include "hist.h"
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#define EVENTS 256
+#define ANSWER_TAIL 64
+
+//commands of one human turn; the buy cycles through silver, gold, province
+static const char *turnScript[] = {"show", "stat", "buy", "end"};
+#define TURN_STEPS ((int)(sizeof(turnScript) / sizeof(turnScript[0])))
+
+struct client {
+    int fd;
+    int turn;
+    int step;                   //-1: waiting for the greeting
+    int over;                   //the game has ended
+    unsigned long long sent;
+    char tail[ANSWER_TAIL];     //end of the answer so far
+    int tailLen;
+};
+
+static struct sockaddr_un addr;
+static struct latencyHist commandHist;
+static int epollFd;
+static int turns = 30;
+static long long started, finished, failed, commands;
+
+static int openClient(struct client *c) {
+    struct epoll_event ev;
+
+    memset(c, 0, sizeof(struct client));
+    c->step = -1;
+    c->fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (c->fd < 0 || connect(c->fd, (struct sockaddr*)&addr, sizeof(addr)) < 0) {
+        if (c->fd >= 0)
+            close(c->fd);
+        return -1;
+    }
+    ev.events = EPOLLIN;
+    ev.data.ptr = c;
+    epoll_ctl(epollFd, EPOLL_CTL_ADD, c->fd, &ev);
+    started++;
+    return 0;
+}
+
+static int sendLine(struct client *c, const char *line) {
+    size_t len = strlen(line);
+
+    c->sent = histNow();
+    c->tailLen = 0;
+    commands++;
+    return send(c->fd, line, len, MSG_NOSIGNAL) == (ssize_t)len ? 0 : -1;
+}
+
+//the next command after an answer, or -1 once the session is done
+static int nextCommand(struct client *c) {
+    static const int buys[] = {5, 6, 3};
+    char line[32];
+
+    if (c->step >= 0) {
+        histRecord(&commandHist, histNow() - c->sent);
+    }
+    if (c->step == -1) {
+        c->step = -2;
+        return sendLine(c, "init 2 1\n");
+    }
+    if (c->over || c->turn >= turns) {
+        sendLine(c, "exit\n");
+        return -1;
+    }
+    if (c->step < 0)
+        c->step = 0;
+
+    if (strcmp(turnScript[c->step], "buy") == 0)
+        snprintf(line, sizeof(line), "buy %d\n", buys[c->turn % 3]);
+    else
+        snprintf(line, sizeof(line), "%s\n", turnScript[c->step]);
+    if (++c->step == TURN_STEPS) {
+        c->step = 0;
+        c->turn++;
+    }
+    return sendLine(c, line);
+}
+
+//read what is there; returns 1 when an answer is complete, -1 on errors
+static int readAnswer(struct client *c) {
+    char buf[4096];
+    ssize_t n;
+    int complete = 0, keep;
+
+    while ((n = recv(c->fd, buf, sizeof(buf), MSG_DONTWAIT)) > 0) {
+        //keep the last bytes, enough to see the prompt and "Game over"
+        keep = n < ANSWER_TAIL ? (int)n : ANSWER_TAIL;
+        if (c->tailLen + keep > ANSWER_TAIL) {
+            memmove(c->tail, c->tail + c->tailLen + keep - ANSWER_TAIL, ANSWER_TAIL - keep);
+            c->tailLen = ANSWER_TAIL - keep;
+        }
+        memcpy(c->tail + c->tailLen, buf + n - keep, keep);
+        c->tailLen += keep;
+        if (memmem(buf, n, "Game over", 9) != NULL)
+            c->over = 1;
+        complete = c->tailLen >= 2 && memcmp(c->tail + c->tailLen - 2, "$ ", 2) == 0;
+    }
+    if (n == 0 || (n < 0 && errno != EAGAIN && errno != EINTR))
+        return -1;
+    return complete;
+}
+
+static void closeClient(struct client *c, int ok) {
+    epoll_ctl(epollFd, EPOLL_CTL_DEL, c->fd, NULL);
+    close(c->fd);
+    if (ok)
+        finished++;
+    else
+        failed++;
+}
+
+int main(int argc, char** argv) {
+    const char *socketPath = "dominion.sock";
+    struct epoll_event events[EVENTS];
+    struct client *clients, *c;
+    struct rlimit files;
+    long long sessions = 10000;
+    int concurrency = 1000;
+    unsigned long long t0;
+    double seconds;
+    int i, n, r, active = 0;
+
+    for (i = 1; i + 1 < argc; i += 2) {
+        if (strcmp(argv[i], "-socket") == 0)
+            socketPath = argv[i + 1];
+        else if (strcmp(argv[i], "-sessions") == 0)
+            sessions = atoll(argv[i + 1]);
+        else if (strcmp(argv[i], "-concurrency") == 0)
+            concurrency = atoi(argv[i + 1]);
+        else if (strcmp(argv[i], "-turns") == 0)
+            turns = atoi(argv[i + 1]);
+        else
+            break;
+    }
+    if (i < argc || sessions < 1 || concurrency < 1 || turns < 0 ||
+            strlen(socketPath) >= sizeof(addr.sun_path)) {
+        printf("Usage: loadgen [-socket path] [-sessions n] [-concurrency n] [-turns n]\n");
+        return 1;
+    }
+    if (concurrency > sessions)
+        concurrency = (int)sessions;
+
+    if (getrlimit(RLIMIT_NOFILE, &files) == 0 && files.rlim_cur < files.rlim_max) {
+        files.rlim_cur = files.rlim_max;
+        setrlimit(RLIMIT_NOFILE, &files);
+    }
+
+    addr.sun_family = AF_UNIX;
+    strcpy(addr.sun_path, socketPath);
+    epollFd = epoll_create1(EPOLL_CLOEXEC);
+    clients = calloc(concurrency, sizeof(struct client));
+    histInit(&commandHist);
+
+    t0 = histNow();
+    for (i = 0; i < concurrency; i++) {
+        if (openClient(&clients[i]) < 0) {
+            perror(socketPath);
+            return 1;
+        }
+        active++;
+    }
+
+    while (active > 0) {
+        n = epoll_wait(epollFd, events, EVENTS, 10000);
+        if (n == 0) {
+            printf("no answer for 10s; %d sessions stuck\n", active);
+            return 1;
+        }
+        for (i = 0; i < n; i++) {
+            c = events[i].data.ptr;
+            r = readAnswer(c);
+            if (r == 0)
+                continue;
+            if (r > 0 && nextCommand(c) == 0)
+                continue;
+
+            //done (or broken): replace it while sessions are left
+            closeClient(c, r > 0);
+            active--;
+            if (started < sessions && openClient(c) == 0)
+                active++;
+        }
+    }
+    seconds = (histNow() - t0) / 1e9;
+
+    printf("%lld sessions (%lld failed), %d at a time, %lld commands in %.2fs\n",
+           finished + failed, failed, concurrency, commands, seconds);
+    printf("%.0f sessions/s, %.0f commands/s\n", (finished + failed) / seconds, commands / seconds);
+    histPrint("command", &commandHist);
+    return failed > 0;
+}
@@ -0,0 +1,149 @@
+#define _GNU_SOURCE
+
+#include "perfctr.h"
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#ifdef __linux__
+#include <linux/perf_event.h>
+#endif
+
+static const char *counterNames[PERF_NUM_COUNTERS] = {
+    "cycles", "instructions", "L1D-misses", "LLC-misses", "branch-misses"
+};
+
+static long long nowNs(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+#ifdef __linux__
+
+static int openCounter(int counter) {
+    struct perf_event_attr attr;
+
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.disabled = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+    switch (counter)
+    {
+    case PERF_CYCLES:
+        attr.type = PERF_TYPE_HARDWARE;
+        attr.config = PERF_COUNT_HW_CPU_CYCLES;
+        break;
+    case PERF_INSTRUCTIONS:
+        attr.type = PERF_TYPE_HARDWARE;
+        attr.config = PERF_COUNT_HW_INSTRUCTIONS;
+        break;
+    case PERF_L1D_MISSES:
+        attr.type = PERF_TYPE_HW_CACHE;
+        attr.config = PERF_COUNT_HW_CACHE_L1D |
+                      (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+                      (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+        break;
+    case PERF_LLC_MISSES:
+        attr.type = PERF_TYPE_HARDWARE;
+        attr.config = PERF_COUNT_HW_CACHE_MISSES;
+        break;
+    case PERF_BRANCH_MISSES:
+        attr.type = PERF_TYPE_HARDWARE;
+        attr.config = PERF_COUNT_HW_BRANCH_MISSES;
+        break;
+    default:
+        return -1;
+    }
+
+    //this thread, any cpu, no group so each counter fails on its own
+    return (int)syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0);
+}
+
+#else
+
+static int openCounter(int counter) {
+    (void)counter;
+    return -1;
+}
+
+#endif
+
+int perfOpen(struct perfCounters *pc) {
+    int i;
+    int count = 0;
+
+    memset(pc, 0, sizeof(struct perfCounters));
+    for (i = 0; i < PERF_NUM_COUNTERS; i++) {
+        pc->fd[i] = openCounter(i);
+        pc->available[i] = pc->fd[i] >= 0;
+        count += pc->available[i];
+    }
+    return count;
+}
+
+void perfStart(struct perfCounters *pc) {
+    int i;
+
+#ifdef __linux__
+    for (i = 0; i < PERF_NUM_COUNTERS; i++) {
+        if (pc->available[i]) {
+            ioctl(pc->fd[i], PERF_EVENT_IOC_RESET, 0);
+            ioctl(pc->fd[i], PERF_EVENT_IOC_ENABLE, 0);
+        }
+    }
+#else
+    (void)i;
+#endif
+    pc->startNs = nowNs();
+}
+
+void perfStop(struct perfCounters *pc) {
+    unsigned long long data[3]; //value, time enabled, time running
+    int i;
+
+    pc->nanoseconds = (double)(nowNs() - pc->startNs);
+
+    for (i = 0; i < PERF_NUM_COUNTERS; i++) {
+        pc->value[i] = 0;
+        pc->measured[i] = 0;
+        if (!pc->available[i]) {
+            continue;
+        }
+#ifdef __linux__
+        ioctl(pc->fd[i], PERF_EVENT_IOC_DISABLE, 0);
+#endif
+        if (read(pc->fd[i], data, sizeof(data)) != sizeof(data) || data[2] == 0) {
+            continue;
+        }
+        //counter was multiplexed off the PMU for part of the run
+        if (data[2] < data[1]) {
+            data[0] = (unsigned long long)((double)data[0] * data[1] / data[2]);
+        }
+        pc->value[i] = data[0];
+        pc->measured[i] = 1;
+    }
+}
+
+void perfClose(struct perfCounters *pc) {
+    int i;
+
+    for (i = 0; i < PERF_NUM_COUNTERS; i++) {
+        if (pc->available[i]) {
+            close(pc->fd[i]);
+        }
+        pc->fd[i] = -1;
+        pc->available[i] = 0;
+    }
+}
+
+const char* perfCounterName(int counter) {
+    if (counter < 0 || counter >= PERF_NUM_COUNTERS) {
+        return "?";
+    }
+    return counterNames[counter];
+}
@@ -0,0 +1,43 @@
+#ifndef _PERFCTR_H
+#define _PERFCTR_H
+
+/* Hardware performance counters (Linux perf_event_open) for the
+   benchmark harness.  Counters that cannot be opened, e.g. inside a
+   container without perf access or on a kernel without the event, are
+   marked unavailable and simply left out of the report. */
+
+enum PERF_COUNTER
+{   PERF_CYCLES = 0,
+    PERF_INSTRUCTIONS,
+    PERF_L1D_MISSES,
+    PERF_LLC_MISSES,
+    PERF_BRANCH_MISSES,
+    PERF_NUM_COUNTERS
+};
+
+struct perfCounters {
+    int fd[PERF_NUM_COUNTERS];
+    int available[PERF_NUM_COUNTERS];
+    int measured[PERF_NUM_COUNTERS];    //value[] holds a count for the last run
+    unsigned long long value[PERF_NUM_COUNTERS];
+    double nanoseconds; //wall time, always available
+    long long startNs;
+};
+
+int perfOpen(struct perfCounters *pc);
+/* Open all counters for the calling thread; returns how many are
+   available (0 is not an error, only wall time is measured then) */
+
+void perfStart(struct perfCounters *pc);
+/* Reset and enable the counters */
+
+void perfStop(struct perfCounters *pc);
+/* Disable the counters and read them into pc->value, scaled for
+   multiplexing; a counter that could not be read or was never scheduled
+   during the run is not measured */
+
+void perfClose(struct perfCounters *pc);
+
+const char* perfCounterName(int counter);
+
+#endif
@@ -1,6 +1,7 @@
 #include "dominion.h"
 #include <stdio.h>
 #include "rngs.h"
+#include "hist.h"
 #include <stdlib.h>
 
 int main (int argc, char** argv) {
@@ -21,7 +22,12 @@ int main (int argc, char** argv) {
     int numSmithies = 0;
     int numAdventurers = 0;
 
+    struct latencyHist turnHist;
+    unsigned long long started;
+    histInit(&turnHist);
+
     while (!isGameOver(&G)) {
+        started = histNow();
         money = 0;
         smithyPos = -1;
         adventurerPos = -1;
@@ -126,10 +132,12 @@ int main (int argc, char** argv) {
 
             endTurn(&G);
         }
+        histRecord(&turnHist, histNow() - started);
     } // end of While
 
     printf ("Finished game.\n");
     printf ("Player 0: %d\nPlayer 1: %d\n", scoreFor(0, &G), scoreFor(1, &G));
+    histPrint("turn", &turnHist);
 
     return 0;
 }
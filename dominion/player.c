@@ -18,8 +18,253 @@
 #include "dominion.h"
 #include "interface.h"
 #include "rngs.h"
+#include "hist.h"
+#include "sim.h"
 
 
+//Engine latency per human command, per bot turn and per whole turn
+static struct latencyHist commandHist;
+static struct latencyHist botHist;
+static struct latencyHist turnHist;
+
+static void printLatency(void) {
+    histPrint("command", &commandHist);
+    histPrint("bot turn", &botHist);
+    histPrint("turn", &turnHist);
+}
+
+
+//A turn for a bot named on the command line, printed as executeBotTurn does
+static void executeLoadedBotTurn(int player, int *turnNum, struct simBot *bot, struct gameState *game) {
+    printf("*****************Executing Bot %s Player %d Turn Number %d*****************\n", bot->name, player, *turnNum);
+    if(player == (game->numPlayers -1)) (*turnNum)++;
+    simPlayTurn(game, bot);
+    if(! isGameOver(game)) {
+        printf("Player %d's turn number %d\n\n", whoseTurn(game), (*turnNum));
+    }
+}
+
+/* Batch mode: player -batch [script] [bot ...]
+
+   Replays a command script (stdin if none or "-") with no prompts and no
+   state printing and writes one line per game.  A game starts at each
+   "init <players> <bots> [seed]" (the seed defaults to the game number)
+   and ends when it is over, at "resign", at the next init or at the end
+   of the script.  add, buy, end and play are carried out, commands that
+   only show things are skipped, and anything the engine refuses or does
+   not know is counted as rejected. */
+
+#define KEYWORD(a, b, c, d) ((unsigned)(a) | (unsigned)(b) << 8 | (unsigned)(c) << 16 | (unsigned)(d) << 24)
+
+struct batchGame {
+    int number;
+    int seed;
+    int started;
+    int turnNum;
+    int commands;
+    int rejected;
+    int isBot[MAX_PLAYERS];
+};
+
+static char* readInput(FILE *f, size_t *size) {
+    size_t cap = 1 << 20, n;
+    char *data = malloc(cap + 1), *grown;
+
+    *size = 0;
+    while (data != NULL && (n = fread(data + *size, 1, cap - *size, f)) > 0) {
+        *size += n;
+        if (*size == cap) {
+            grown = realloc(data, cap * 2 + 1);
+            if (grown == NULL) {
+                free(data);
+                return NULL;
+            }
+            data = grown;
+            cap *= 2;
+        }
+    }
+    if (data != NULL)
+        data[*size] = '\n';
+    return data;
+}
+
+//next integer on the line, as sscanf's %d; leaves *value alone if none
+static const char* scanNumber(const char *p, int *value) {
+    int sign = 1, n = 0;
+
+    while (*p == ' ' || *p == '\t' || *p == '\r')
+        p++;
+    if ((*p == '-' || *p == '+') && p[1] >= '0' && p[1] <= '9')
+        sign = *p++ == '-' ? -1 : 1;
+    if (*p < '0' || *p > '9')
+        return p;
+    while (*p >= '0' && *p <= '9')
+        n = n * 10 + (*p++ - '0');
+    *value = sign * n;
+    return p;
+}
+
+static void finishGame(struct batchGame *b, struct gameState *game, const char *how) {
+    int players[MAX_PLAYERS];
+    int p;
+
+    if (!b->started)
+        return;
+    printf("game %d seed %d players %d turns %d commands %d rejected %d %s scores",
+           b->number, b->seed, game->numPlayers, b->turnNum, b->commands, b->rejected, how);
+    for (p = 0; p < game->numPlayers; p++) {
+        printf(" %d", scoreFor(p, game));
+    }
+    getWinners(players, game);
+    printf(" winners");
+    for (p = 0; p < game->numPlayers; p++) {
+        if (players[p] == WINNER)
+            printf(" %d", p);
+    }
+    printf("\n");
+    b->started = FALSE;
+}
+
+static void runBatchBots(struct batchGame *b, struct simBot *seatBot[], struct gameState *game) {
+    int player;
+
+    while (b->started && !isGameOver(game) && b->isBot[player = whoseTurn(game)] &&
+            b->turnNum < SIM_MAX_TURNS) {
+        if (seatBot[player] != NULL) {
+            if (player == game->numPlayers - 1)
+                b->turnNum++;
+            simPlayTurn(game, seatBot[player]);
+        } else {
+            fexecuteBotTurn(NULL, player, &b->turnNum, game);
+        }
+    }
+    if (b->started && isGameOver(game))
+        finishGame(b, game, "over");
+    else if (b->started && b->turnNum >= SIM_MAX_TURNS)
+        finishGame(b, game, "cutoff");
+}
+
+static int runBatch(int argc, char *argv[]) {
+    int kCards[10] = {adventurer, gardens, embargo, village, minion, mine, cutpurse, sea_hag, tribute, smithy};
+    struct simBot *namedBot[MAX_PLAYERS] = { NULL, NULL, NULL, NULL};
+    struct simBot *seatBot[MAX_PLAYERS];
+    struct batchGame b;
+    struct gameState g;
+    struct gameState *game = &g;
+    const char *p, *word;
+    unsigned long long started = histNow();
+    unsigned key;
+    long long lines = 0;
+    FILE *in = stdin;
+    char *script;
+    size_t size;
+    int numNamed, player, outcome, len;
+    int arg[4];
+
+    if (argc > 0 && strcmp(argv[0], "-") != 0 && (in = fopen(argv[0], "r")) == NULL) {
+        perror(argv[0]);
+        return EXIT_FAILURE;
+    }
+    for (numNamed = 0; numNamed + 1 < argc; numNamed++) {
+        if (numNamed == MAX_PLAYERS || (namedBot[numNamed] = simFindBot(argv[numNamed + 1])) == NULL) {
+            fprintf(stderr, "Unknown bot or too many bots: %s (bots: %s)\n", argv[numNamed + 1], simBotNames());
+            return EXIT_FAILURE;
+        }
+    }
+    script = readInput(in, &size);
+    if (in != stdin)
+        fclose(in);
+    if (script == NULL) {
+        fprintf(stderr, "Cannot read the script\n");
+        return EXIT_FAILURE;
+    }
+
+    memset(&b, 0, sizeof(b));
+    memset(game, 0, sizeof(struct gameState));
+    for (p = script; p < script + size; p++) {
+        //one line: a word, compared on its first four letters as COMPARE
+        //does, then up to four numbers
+        while (*p == ' ' || *p == '\t' || *p == '\r')
+            p++;
+        word = p;
+        while (*p > ' ')
+            p++;
+        len = p - word;
+        lines++;
+        key = 0;
+        for (player = 0; player < len && player < 4; player++) {
+            key |= (unsigned)(unsigned char)word[player] << (8 * player);
+        }
+        arg[0] = arg[1] = arg[2] = arg[3] = UNUSED;
+        for (player = 0; player < 4; player++) {
+            p = scanNumber(p, &arg[player]);
+        }
+        while (*p != '\n')
+            p++;
+
+        if (len == 0 || word[0] == '#')
+            continue;
+        if (key == KEYWORD('e', 'x', 'i', 't'))
+            break;
+        if (key == KEYWORD('i', 'n', 'i', 't')) {
+            finishGame(&b, game, "unfinished");
+            b.number++;
+            b.seed = arg[2] > 0 ? arg[2] : b.number;
+            b.turnNum = b.commands = b.rejected = 0;
+            memset(b.isBot, 0, sizeof(b.isBot));
+            memset(seatBot, 0, sizeof(seatBot));
+            for (player = arg[0] - arg[1]; player >= 0 && player < arg[0] && player < MAX_PLAYERS; player++) {
+                b.isBot[player] = TRUE;
+                seatBot[player] = player - (arg[0] - arg[1]) < numNamed ? namedBot[player - (arg[0] - arg[1])] : NULL;
+            }
+            memset(game, 0, sizeof(struct gameState));
+            if (arg[1] < 0 || arg[1] > arg[0] || initializeGame(arg[0], kCards, b.seed, game) != SUCCESS) {
+                printf("game %d seed %d init failed\n", b.number, b.seed);
+                continue;
+            }
+            b.started = TRUE;
+            runBatchBots(&b, seatBot, game);
+            continue;
+        }
+        if (key == KEYWORD('s', 'h', 'o', 'w') || key == KEYWORD('s', 't', 'a', 't') ||
+                key == KEYWORD('s', 'u', 'p', 'p') || key == KEYWORD('n', 'u', 'm', 0) ||
+                key == KEYWORD('w', 'h', 'o', 's') || key == KEYWORD('h', 'e', 'l', 'p') ||
+                key == KEYWORD('l', 'a', 't', 0))
+            continue;
+        if (!b.started)
+            continue;
+
+        b.commands++;
+        player = whoseTurn(game);
+        if (key == KEYWORD('a', 'd', 'd', 0)) {
+            outcome = game->handCount[player] < MAX_HAND ? addCardToHand(player, arg[0], game) : FAILURE;
+        } else if (key == KEYWORD('b', 'u', 'y', 0)) {
+            outcome = arg[0] >= curse && arg[0] <= treasure_map ? buyCard(arg[0], game) : FAILURE;
+        } else if (key == KEYWORD('e', 'n', 'd', 0)) {
+            if (player == game->numPlayers - 1)
+                b.turnNum++;
+            outcome = endTurn(game);
+        } else if (key == KEYWORD('p', 'l', 'a', 'y')) {
+            outcome = canPlayCard(arg[0], arg[1], arg[2], arg[3], game) ?
+                      playCard(arg[0], arg[1], arg[2], arg[3], game) : FAILURE;
+        } else if (key == KEYWORD('r', 'e', 's', 'i')) {
+            endTurn(game);
+            finishGame(&b, game, "resigned");
+            continue;
+        } else {
+            outcome = FAILURE;
+        }
+        if (outcome != SUCCESS)
+            b.rejected++;
+        runBatchBots(&b, seatBot, game);
+    }
+    finishGame(&b, game, "unfinished");
+    free(script);
+
+    fprintf(stderr, "%d games, %lld lines in %.3fs\n", b.number, lines, (histNow() - started) / 1e9);
+    return EXIT_SUCCESS;
+}
+
 int main2(int argc, char *argv[]) {
     //Default cards, as defined in playDom
     int k[10] = {adventurer, gardens, embargo, village, minion, mine, cutpurse, sea_hag, tribute, smithy};
@@ -37,6 +282,7 @@ int main(int argc, char* argv[]) {
     char *exit = "exit";
     char *help = "help";
     char *init = "init";
+    char *lat  = "lat";
     char *numH = "num";
     char *play = "play";
     char *resign  = "resi";
@@ -52,6 +298,12 @@ int main(int argc, char* argv[]) {
     //Array to hold bot presence
     int isBot[MAX_PLAYERS] = { 0, 0, 0, 0};
 
+    //Bots named on the command line, for the bot seats in order; seats
+    //past them use executeBotTurn
+    struct simBot *namedBot[MAX_PLAYERS] = { NULL, NULL, NULL, NULL};
+    struct simBot *seatBot[MAX_PLAYERS] = { NULL, NULL, NULL, NULL};
+    int numNamed = 0;
+
     int players[MAX_PLAYERS];
     int playerNum;
     int outcome;
@@ -59,6 +311,10 @@ int main(int argc, char* argv[]) {
     int gameOver = FALSE;
     int gameStarted = FALSE;
     int turnNum = 0;
+    unsigned long long started;
+    unsigned long long elapsed;
+    unsigned long long turnNs = 0;
+    int timed;
 
     int randomSeed = atoi(argv[1]);
 
@@ -70,11 +326,28 @@ int main(int argc, char* argv[]) {
 
     memset(game,0,sizeof(struct gameState));
 
-    if(argc != 2) {
-        printf("Usage: player [integer random number seed]\n");
+    if(argc >= 2 && strcmp(argv[1], "-batch") == 0) {
+        return runBatch(argc - 2, argv + 2);
+    }
+
+    histInit(&commandHist);
+    histInit(&botHist);
+    histInit(&turnHist);
+
+    if(argc < 2 || argc > 2 + MAX_PLAYERS) {
+        printf("Usage: player [integer random number seed] [bot ...]\n"
+               "       player -batch [script] [bot ...]\nbots: %s\n", simBotNames());
         return EXIT_SUCCESS;
     }
 
+    for(numNamed = 0; numNamed + 2 < argc; numNamed++) {
+        namedBot[numNamed] = simFindBot(argv[numNamed + 2]);
+        if(namedBot[numNamed] == NULL) {
+            printf("Unknown bot %s (bots: %s)\n", argv[numNamed + 2], simBotNames());
+            return EXIT_SUCCESS;
+        }
+    }
+
     if(randomSeed <= 0) {
         printf("Usage: player [integer random number seed]\n");
         return EXIT_SUCCESS;
@@ -113,13 +386,22 @@ int main(int argc, char* argv[]) {
                 printDiscard(playerNum, game);
                 printDeck(playerNum, game);
             }
+            printLatency();
 
             break; //Exit out of the game/while loop
         }
 
 
         if(isBot[currentPlayer] == TRUE) {
-            executeBotTurn(currentPlayer, &turnNum, game);
+            started = histNow();
+            if(seatBot[currentPlayer] != NULL) {
+                executeLoadedBotTurn(currentPlayer, &turnNum, seatBot[currentPlayer], game);
+            } else {
+                executeBotTurn(currentPlayer, &turnNum, game);
+            }
+            elapsed = histNow() - started;
+            histRecord(&botHist, elapsed);
+            histRecord(&turnHist, elapsed);
             continue;
         }
 
@@ -127,6 +409,10 @@ int main(int argc, char* argv[]) {
         fgets(line, MAX_STRING_LENGTH, stdin);
         sscanf(line, "%s %d %d %d %d", command, &arg0, &arg1, &arg2, &arg3);
 
+        //time only commands that go through the engine, not the prompt
+        timed = COMPARE(command, add) == 0 || COMPARE(command, buyC) == 0 ||
+                COMPARE(command, endT) == 0 || COMPARE(command, play) == 0;
+        started = histNow();
 
         if(COMPARE(command, add) == 0) {
             outcome = addCardToHand(currentPlayer, arg0, game);
@@ -156,6 +442,9 @@ int main(int argc, char* argv[]) {
             int numHuman = arg0 - arg1;
             for(playerNum = numHuman; playerNum < arg0; playerNum++) {
                 isBot[playerNum] = TRUE;
+                if(playerNum >= 0 && playerNum < MAX_PLAYERS && playerNum - numHuman < numNamed) {
+                    seatBot[playerNum] = namedBot[playerNum - numHuman];
+                }
             }
             //		selectKingdomCards(randomSeed, kCards);  //Comment this out to use the default card set defined in playDom.
             outcome = initializeGame(arg0, kCards, randomSeed, game);
@@ -166,6 +455,8 @@ int main(int argc, char* argv[]) {
                 printf("Player %d's turn number %d\n\n", currentPlayer, turnNum);
             }
 
+        } else if(COMPARE(command, lat) == 0) {
+            printLatency();
         } else if(COMPARE(command, numH) == 0) {
             int numCards = numHandCards(game);
             printf("There are %d cards in your hand.\n", numCards);
@@ -198,6 +489,16 @@ int main(int argc, char* argv[]) {
             int playerNum =	whoseTurn(game);
             printf("Player %d's turn\n", playerNum);
         }
+
+        if(timed == TRUE) {
+            elapsed = histNow() - started;
+            histRecord(&commandHist, elapsed);
+            turnNs += elapsed;
+            if(COMPARE(command, endT) == 0) {
+                histRecord(&turnHist, turnNs);
+                turnNs = 0;
+            }
+        }
     }
 
     return EXIT_SUCCESS;
@@ -0,0 +1,408 @@
+#include "playout.h"
+#include "dominion_helpers.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define NUM_CARDS (treasure_map + 1)
+
+//what the fast path needs to know about cards, filled from getCost
+struct playoutCards {
+    int cost[NUM_CARDS];
+    int money[NUM_CARDS];       //coins as a treasure
+};
+
+struct playoutGame {
+    struct gameState *state;
+    struct playoutRng *rng;
+    struct playoutCards *cards;
+#ifdef PLAYOUT_CHECK
+    int total[NUM_CARDS];
+#endif
+};
+
+void playoutSeed(struct playoutRng *rng, unsigned long long seed) {
+    //splitmix64 of the seed, so that small seeds give unrelated streams
+    seed += 0x9e3779b97f4a7c15ULL;
+    seed = (seed ^ (seed >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    seed = (seed ^ (seed >> 27)) * 0x94d049bb133111ebULL;
+    rng->s = (seed ^ (seed >> 31)) | 1;
+}
+
+unsigned playoutRandom(struct playoutRng *rng, unsigned n) {
+    //xorshift64*, scaled to [0, n) by a multiply instead of a division
+    unsigned long long x = rng->s;
+
+    x ^= x >> 12;
+    x ^= x << 25;
+    x ^= x >> 27;
+    rng->s = x;
+    return (unsigned)(((x * 0x2545f4914f6cdd1dULL) >> 32) * n >> 32);
+}
+
+int playoutCanPlay(int card) {
+    switch (card) {
+    case adventurer:
+    case council_room:
+    case smithy:
+    case village:
+    case great_hall:
+    case tribute:
+    case cutpurse:
+    case sea_hag:
+        return 1;
+    }
+    return 0;
+}
+
+static void fillCards(struct playoutCards *cards) {
+    int c;
+
+    for (c = 0; c < NUM_CARDS; c++) {
+        cards->cost[c] = getCost(c);
+        cards->money[c] = 0;
+    }
+    cards->money[copper] = 1;
+    cards->money[silver] = 2;
+    cards->money[gold] = 3;
+}
+
+static void shuffleDiscard(struct playoutGame *g, int player) {
+    struct gameState *s = g->state;
+    int *deck = s->deck[player];
+    int i, j, t;
+
+    memcpy(deck, s->discard[player], s->discardCount[player] * sizeof(int));
+    s->deckCount[player] = s->discardCount[player];
+    s->discardCount[player] = 0;
+    for (i = s->deckCount[player] - 1; i > 0; i--) {
+        j = playoutRandom(g->rng, i + 1);
+        t = deck[i];
+        deck[i] = deck[j];
+        deck[j] = t;
+    }
+}
+
+//top card of the deck, shuffling the discard pile in when it runs out;
+//-1 if there is nothing left
+static int topCard(struct playoutGame *g, int player) {
+    struct gameState *s = g->state;
+
+    if (s->deckCount[player] == 0) {
+        if (s->discardCount[player] == 0)
+            return -1;
+        shuffleDiscard(g, player);
+    }
+    return s->deck[player][--s->deckCount[player]];
+}
+
+static void draw(struct playoutGame *g, int player, int n) {
+    struct gameState *s = g->state;
+    int card;
+
+    while (n-- > 0 && (card = topCard(g, player)) >= 0) {
+        s->hand[player][s->handCount[player]++] = card;
+        if (player == s->whoseTurn)
+            s->coins += g->cards->money[card];
+    }
+}
+
+static void gain(struct playoutGame *g, int player, int card) {
+    struct gameState *s = g->state;
+
+    if (s->supplyCount[card] > 0) {
+        s->supplyCount[card]--;
+        s->discard[player][s->discardCount[player]++] = card;
+    }
+}
+
+static int isVictory(int card) {
+    return card == estate || card == duchy || card == province || card == gardens || card == great_hall;
+}
+
+static int isAction(int card) {
+    return card >= adventurer && card <= treasure_map && card != gardens;
+}
+
+static void playAction(struct playoutGame *g, int card) {
+    struct gameState *s = g->state;
+    int player = s->whoseTurn;
+    int setAside[MAX_DECK];
+    int revealed[2];
+    int i, j, n, found, other;
+
+    switch (card) {
+    case adventurer:
+        for (found = 0, n = 0; found < 2 && (i = topCard(g, player)) >= 0; ) {
+            if (g->cards->money[i] > 0) {
+                s->hand[player][s->handCount[player]++] = i;
+                s->coins += g->cards->money[i];
+                found++;
+            } else {
+                setAside[n++] = i;
+            }
+        }
+        memcpy(&s->discard[player][s->discardCount[player]], setAside, n * sizeof(int));
+        s->discardCount[player] += n;
+        break;
+
+    case council_room:
+        draw(g, player, 4);
+        s->numBuys++;
+        for (i = 0; i < s->numPlayers; i++) {
+            if (i != player)
+                draw(g, i, 1);
+        }
+        break;
+
+    case smithy:
+        draw(g, player, 3);
+        break;
+
+    case village:
+        draw(g, player, 1);
+        s->numActions += 2;
+        break;
+
+    case great_hall:
+        draw(g, player, 1);
+        s->numActions++;
+        break;
+
+    case tribute:
+        other = (player + 1) % s->numPlayers;
+        revealed[0] = topCard(g, other);
+        revealed[1] = topCard(g, other);
+        for (i = 0; i < 2 && revealed[i] >= 0; i++) {
+            s->discard[other][s->discardCount[other]++] = revealed[i];
+            if (i == 1 && revealed[1] == revealed[0])
+                break;
+            if (isAction(revealed[i]))
+                s->numActions += 2;
+            if (g->cards->money[revealed[i]] > 0)
+                s->coins += 2;
+            if (isVictory(revealed[i]))
+                draw(g, player, 2);
+        }
+        break;
+
+    case cutpurse:
+        s->coins += 2;
+        for (i = 0; i < s->numPlayers; i++) {
+            if (i == player)
+                continue;
+            for (j = 0; j < s->handCount[i] && s->hand[i][j] != copper; j++);
+            if (j < s->handCount[i]) {
+                s->hand[i][j] = s->hand[i][--s->handCount[i]];
+                s->discard[i][s->discardCount[i]++] = copper;
+            }
+        }
+        break;
+
+    case sea_hag:
+        for (i = 0; i < s->numPlayers; i++) {
+            if (i == player)
+                continue;
+            if ((j = topCard(g, i)) >= 0)
+                s->discard[i][s->discardCount[i]++] = j;
+            if (s->supplyCount[curse] > 0) {
+                s->supplyCount[curse]--;
+                s->deck[i][s->deckCount[i]++] = curse;
+            }
+        }
+        break;
+    }
+}
+
+static int gameOver(struct gameState *s) {
+    int c, empty = 0;
+
+    if (s->supplyCount[province] == 0)
+        return 1;
+    for (c = 0; c < NUM_CARDS; c++) {
+        if (s->supplyCount[c] == 0)
+            empty++;
+    }
+    return empty >= 3;
+}
+
+#ifdef PLAYOUT_CHECK
+
+static void fail(struct gameState *s, const char *what, int value) {
+    fprintf(stderr, "playout: player %d %s (%d)\n", s->whoseTurn, what, value);
+    abort();
+}
+
+//how many of each card there are, in the supply and everywhere else
+static void countCards(struct gameState *s, int count[NUM_CARDS]) {
+    int p, i;
+
+    for (i = 0; i < NUM_CARDS; i++) {
+        count[i] = s->supplyCount[i] > 0 ? s->supplyCount[i] : 0;
+    }
+    for (p = 0; p < s->numPlayers; p++) {
+        if (s->handCount[p] < 0 || s->handCount[p] > MAX_HAND ||
+                s->deckCount[p] < 0 || s->deckCount[p] > MAX_DECK ||
+                s->discardCount[p] < 0 || s->discardCount[p] > MAX_DECK)
+            fail(s, "has a pile out of range", p);
+        for (i = 0; i < s->handCount[p]; i++)
+            count[s->hand[p][i]]++;
+        for (i = 0; i < s->deckCount[p]; i++)
+            count[s->deck[p][i]]++;
+        for (i = 0; i < s->discardCount[p]; i++)
+            count[s->discard[p][i]]++;
+    }
+    for (i = 0; i < s->playedCardCount; i++)
+        count[s->playedCards[i]]++;
+    for (i = 0; i < s->trashedCardCount; i++)
+        count[s->trash[i]]++;
+}
+
+static void checkCards(struct playoutGame *g) {
+    int count[NUM_CARDS];
+    int c;
+
+    countCards(g->state, count);
+    for (c = 0; c < NUM_CARDS; c++) {
+        if (count[c] != g->total[c])
+            fail(g->state, "changed the number of cards of kind", c);
+    }
+}
+
+static void checkAction(struct gameState *s, int pos) {
+    if (pos >= s->handCount[s->whoseTurn])
+        fail(s, "played past the end of the hand", pos);
+    if (!playoutCanPlay(s->hand[s->whoseTurn][pos]))
+        fail(s, "played a card the playouts cannot play", s->hand[s->whoseTurn][pos]);
+}
+
+static void checkBuy(struct playoutGame *g, int card) {
+    if (card > treasure_map || g->state->supplyCount[card] <= 0)
+        fail(g->state, "bought a card not in the supply", card);
+    if (g->cards->cost[card] > g->state->coins)
+        fail(g->state, "bought a card it cannot afford", card);
+}
+
+#else
+
+#define checkCards(g)
+#define checkAction(s, pos)
+#define checkBuy(g, card)
+
+#endif
+
+static void playTurn(struct playoutGame *g, struct playoutPolicy *policy) {
+    struct gameState *s = g->state;
+    int player = s->whoseTurn;
+    int *hand = s->hand[player];
+    int pos, card;
+
+    if (s->phase == 0) {
+        while (s->numActions > 0 && (pos = policy->action(s, g->rng, policy->ctx)) >= 0) {
+            checkAction(s, pos);
+            card = hand[pos];
+            hand[pos] = hand[--s->handCount[player]];
+            s->playedCards[s->playedCardCount++] = card;
+            s->numActions--;
+            playAction(g, card);
+        }
+        s->phase = 1;
+    }
+
+    while (s->numBuys > 0 && (card = policy->buy(s, g->rng, policy->ctx)) >= 0) {
+        checkBuy(g, card);
+        s->coins -= g->cards->cost[card];
+        s->numBuys--;
+        gain(g, player, card);
+        for (pos = 0; pos < s->embargoTokens[card]; pos++)
+            gain(g, player, curse);
+    }
+
+    //clean up and draw the next hand
+    memcpy(&s->discard[player][s->discardCount[player]], hand, s->handCount[player] * sizeof(int));
+    s->discardCount[player] += s->handCount[player];
+    memcpy(&s->discard[player][s->discardCount[player]], s->playedCards, s->playedCardCount * sizeof(int));
+    s->discardCount[player] += s->playedCardCount;
+    s->handCount[player] = 0;
+    s->playedCardCount = 0;
+    s->whoseTurn = (player + 1) % s->numPlayers;
+    s->outpostPlayed = 0;
+    s->phase = 0;
+    s->numActions = 1;
+    s->numBuys = 1;
+    s->coins = 0;
+    draw(g, s->whoseTurn, 5);
+}
+
+int playoutToEnd(struct gameState *state, struct playoutPolicy *policy,
+                 struct playoutRng *rng) {
+    static __thread struct playoutCards cards;
+    struct playoutGame g;
+    int turns;
+
+    if (cards.money[copper] == 0)
+        fillCards(&cards);
+    g.state = state;
+    g.rng = rng;
+    g.cards = &cards;
+    //the engine discards played cards at once and never fills this
+    state->playedCardCount = 0;
+#ifdef PLAYOUT_CHECK
+    countCards(state, g.total);
+#endif
+
+    for (turns = 0; turns < PLAYOUT_MAX_TURNS && !gameOver(state); turns++) {
+        playTurn(&g, policy);
+        checkCards(&g);
+    }
+    stateHashReset(state);
+    return turns;
+}
+
+static int randomAction(struct gameState *state, struct playoutRng *rng, void *ctx) {
+    int player = state->whoseTurn;
+    int playable[MAX_HAND];
+    int i, n = 0;
+
+    for (i = 0; i < state->handCount[player]; i++) {
+        if (playoutCanPlay(state->hand[player][i]))
+            playable[n++] = i;
+    }
+    return n > 0 ? playable[playoutRandom(rng, n)] : -1;
+}
+
+static int randomBuy(struct gameState *state, struct playoutRng *rng, void *ctx) {
+    int affordable[NUM_CARDS];
+    int c, n = 0;
+
+    for (c = estate; c < NUM_CARDS; c++) {
+        if (state->supplyCount[c] > 0 && getCost(c) <= state->coins)
+            affordable[n++] = c;
+    }
+    c = playoutRandom(rng, n + 1);
+    return c < n ? affordable[c] : -1;
+}
+
+static int firstAction(struct gameState *state, struct playoutRng *rng, void *ctx) {
+    int player = state->whoseTurn;
+    int i;
+
+    for (i = 0; i < state->handCount[player]; i++) {
+        if (playoutCanPlay(state->hand[player][i]))
+            return i;
+    }
+    return -1;
+}
+
+static int bigMoneyBuy(struct gameState *state, struct playoutRng *rng, void *ctx) {
+    if (state->coins >= 8 && state->supplyCount[province] > 0)
+        return province;
+    if (state->coins >= 6 && state->supplyCount[gold] > 0)
+        return gold;
+    if (state->coins >= 3 && state->supplyCount[silver] > 0)
+        return silver;
+    return -1;
+}
+
+struct playoutPolicy playoutRandomPolicy = {randomAction, randomBuy, NULL};
+struct playoutPolicy playoutBigMoneyPolicy = {firstAction, bigMoneyBuy, NULL};
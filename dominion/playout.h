@@ -0,0 +1,61 @@
+#ifndef _PLAYOUT_H
+#define _PLAYOUT_H
+
+#include "dominion.h"
+
+/* Fast random playouts.
+
+   playoutToEnd plays a game on from any state to its end without going
+   through playCard and buyCard: no argument checks, no return codes, no
+   printing, treasure counted as cards move and shuffles drawn from a
+   small generator owned by the caller instead of rngs.c.  The rules are
+   the card texts, not the engine's: played cards stay out until cleanup,
+   embargo tokens cost curses, adventurer sets its cards aside.  Only the
+   action cards that need no choices can be played (playoutCanPlay).
+
+   "make CHECK=1" (adds -DPLAYOUT_CHECK) checks every policy decision and
+   that no card is lost or made after every turn, and aborts with a
+   message if anything is wrong. */
+
+#define PLAYOUT_MAX_TURNS 400 /* all players together; the game is cut off */
+
+struct playoutRng {
+    unsigned long long s;
+};
+
+void playoutSeed(struct playoutRng *rng, unsigned long long seed);
+
+unsigned playoutRandom(struct playoutRng *rng, unsigned n);
+/* Uniform in [0, n), n > 0 */
+
+struct playoutPolicy {
+    int (*action)(struct gameState *state, struct playoutRng *rng, void *ctx);
+    /* Hand position of an action card playoutCanPlay accepts, or -1 to end
+       the action phase; only asked while there are actions left */
+
+    int (*buy)(struct gameState *state, struct playoutRng *rng, void *ctx);
+    /* Card to buy with state->coins, or -1 to end the buy phase; only
+       asked while there are buys left */
+
+    void *ctx;
+};
+/* Policies must not change the state they are shown */
+
+extern struct playoutPolicy playoutRandomPolicy;
+/* Plays a random playable action, buys a random affordable card other
+   than curse or nothing */
+
+extern struct playoutPolicy playoutBigMoneyPolicy;
+/* Plays the first playable action, buys province, gold or silver */
+
+int playoutCanPlay(int card);
+
+int playoutToEnd(struct gameState *state, struct playoutPolicy *policy,
+                 struct playoutRng *rng);
+/* Play from the current player's turn, in whatever phase it is, until
+   the game is over or PLAYOUT_MAX_TURNS turns were played; returns the
+   number of turns.  Scores are then scoreFor's and getWinners'.  The
+   state's hash (stateHash) is recomputed at the end, not kept up turn by
+   turn */
+
+#endif
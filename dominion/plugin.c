@@ -0,0 +1,95 @@
+#define _DEFAULT_SOURCE
+
+#include "plugin.h"
+#include "botplugin.h"
+#include <dlfcn.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+//plugins loaded so far; they stay loaded until the program exits
+struct loadedPlugin {
+    char path[256];
+    void *handle;
+    const struct dominionBot *entry;
+    struct simBot bot;
+    char definition[64];
+    struct loadedPlugin *next;
+};
+
+static struct loadedPlugin *loadedPlugins;
+
+//simBot callbacks take a writable state; the plugin's promise not to
+//write is what its const says
+static int pluginAction(struct gameState *state, int choices[3], void *ctx) {
+    const struct dominionBot *entry = ctx;
+    return entry->action(state, choices, entry->ctx);
+}
+
+static int pluginBuy(struct gameState *state, void *ctx) {
+    const struct dominionBot *entry = ctx;
+    return entry->buy(state, entry->ctx);
+}
+
+//the plugin's code decides its results, so cache keys use its bytes
+static int fileChecksum(const char *path, unsigned long long *sum) {
+    FILE *f = fopen(path, "rb");
+    int c;
+
+    if (f == NULL)
+        return -1;
+    *sum = 14695981039346656037ULL;
+    while ((c = getc(f)) != EOF) {
+        *sum = (*sum ^ (unsigned char)c) * 1099511628211ULL;
+    }
+    fclose(f);
+    return 0;
+}
+
+struct simBot* pluginLoad(const char *path) {
+    const struct dominionBot* (*entryPoint)(void);
+    struct loadedPlugin *l;
+    char file[260];
+    unsigned long long sum;
+
+    for (l = loadedPlugins; l != NULL; l = l->next) {
+        if (strcmp(l->path, path) == 0)
+            return &l->bot;
+    }
+
+    //dlopen looks a bare name up in the library path, not here
+    snprintf(file, sizeof(file), "%s%s", strchr(path, '/') == NULL ? "./" : "", path);
+    if (fileChecksum(file, &sum) < 0) {
+        perror(path);
+        return NULL;
+    }
+    l = calloc(1, sizeof(struct loadedPlugin));
+    if (l == NULL || (l->handle = dlopen(file, RTLD_NOW | RTLD_LOCAL)) == NULL) {
+        fprintf(stderr, "%s: %s\n", path, l == NULL ? "out of memory" : dlerror());
+        free(l);
+        return NULL;
+    }
+
+    *(void**)&entryPoint = dlsym(l->handle, DOMINION_BOT_ENTRY);
+    l->entry = entryPoint != NULL ? entryPoint() : NULL;
+    if (l->entry == NULL || l->entry->abi != DOMINION_BOT_ABI ||
+            l->entry->stateSize != (int)sizeof(struct gameState) ||
+            l->entry->action == NULL || l->entry->buy == NULL) {
+        fprintf(stderr, "%s: not a bot plugin for this engine (ABI %d, state size %d)\n",
+                path, DOMINION_BOT_ABI, (int)sizeof(struct gameState));
+        dlclose(l->handle);
+        free(l);
+        return NULL;
+    }
+
+    snprintf(l->path, sizeof(l->path), "%s", path);
+    snprintf(l->definition, sizeof(l->definition), "plugin %016llx", sum);
+    l->bot.name = l->entry->name;
+    l->bot.action = pluginAction;
+    l->bot.buy = pluginBuy;
+    l->bot.ctx = (void*)l->entry;
+    l->bot.definition = l->definition;
+    l->next = loadedPlugins;
+    loadedPlugins = l;
+    return &l->bot;
+}
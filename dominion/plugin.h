@@ -0,0 +1,13 @@
+#ifndef _PLUGIN_H
+#define _PLUGIN_H
+
+#include "sim.h"
+
+/* Loading bots built against botplugin.h */
+
+struct simBot* pluginLoad(const char *path);
+/* dlopen a bot plugin and wrap it as a simBot; NULL (with a message on
+   stderr) if it cannot be loaded or was built for another ABI.  Loading
+   the same path again gives the same bot. */
+
+#endif
@@ -0,0 +1,131 @@
+#define _GNU_SOURCE
+
+#include "pool.h"
+#include <stdlib.h>
+#include <sys/mman.h>
+
+#define HUGE_PAGE_SIZE (2 * 1024 * 1024)
+
+//free states hold the link to the next free state in their first bytes
+struct poolFree {
+    struct poolFree *next;
+};
+
+static __thread struct poolFree *freeList;
+static __thread int freeCount;
+
+static int useHugePages;
+static long long slabCount;
+static long long stateCount;
+static long long hugeSlabCount;
+
+//slot size keeps every state on its own cache lines
+static size_t slotSize(void) {
+    return (sizeof(struct gameState) + POOL_ALIGN - 1) / POOL_ALIGN * POOL_ALIGN;
+}
+
+static void* allocSlab(size_t *bytes, int *huge) {
+    void *slab;
+    size_t size = slotSize() * POOL_SLAB_STATES;
+
+    *huge = 0;
+    if (__atomic_load_n(&useHugePages, __ATOMIC_RELAXED)) {
+        size = (size + HUGE_PAGE_SIZE - 1) / HUGE_PAGE_SIZE * HUGE_PAGE_SIZE;
+#ifdef MAP_HUGETLB
+        slab = mmap(NULL, size, PROT_READ | PROT_WRITE,
+                    MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        if (slab != MAP_FAILED) {
+            *huge = 1;
+            *bytes = size;
+            return slab;
+        }
+#endif
+        //no reserved huge pages: ask for transparent ones instead
+        slab = mmap(NULL, size, PROT_READ | PROT_WRITE,
+                    MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (slab != MAP_FAILED) {
+#ifdef MADV_HUGEPAGE
+            *huge = madvise(slab, size, MADV_HUGEPAGE) == 0;
+#endif
+            *bytes = size;
+            return slab;
+        }
+        return NULL;
+    }
+
+    if (posix_memalign(&slab, POOL_ALIGN, size) != 0) {
+        return NULL;
+    }
+    *bytes = size;
+    return slab;
+}
+
+static int growPool(void) {
+    size_t bytes, slot = slotSize();
+    size_t offset;
+    int huge;
+    int added = 0;
+    char *slab = allocSlab(&bytes, &huge);
+
+    if (slab == NULL) {
+        return -1;
+    }
+
+    for (offset = 0; offset + slot <= bytes; offset += slot) {
+        struct poolFree *f = (struct poolFree*)(slab + offset);
+        f->next = freeList;
+        freeList = f;
+        freeCount++;
+        added++;
+    }
+
+    __atomic_add_fetch(&stateCount, added, __ATOMIC_RELAXED);
+    __atomic_add_fetch(&slabCount, 1, __ATOMIC_RELAXED);
+    if (huge) {
+        __atomic_add_fetch(&hugeSlabCount, 1, __ATOMIC_RELAXED);
+    }
+    return 0;
+}
+
+struct gameState* poolAcquire(void) {
+    struct poolFree *f;
+
+    if (freeList == NULL && growPool() < 0) {
+        return NULL;
+    }
+
+    f = freeList;
+    freeList = f->next;
+    freeCount--;
+    return (struct gameState*)f;
+}
+
+void poolRelease(struct gameState *state) {
+    struct poolFree *f = (struct poolFree*)state;
+
+    if (state == NULL) {
+        return;
+    }
+    f->next = freeList;
+    freeList = f;
+    freeCount++;
+}
+
+int poolReserve(int count) {
+    while (freeCount < count) {
+        if (growPool() < 0) {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+void poolUseHugePages(int enable) {
+    __atomic_store_n(&useHugePages, enable, __ATOMIC_RELAXED);
+}
+
+void poolGetStats(struct poolStats *stats) {
+    stats->slabs = __atomic_load_n(&slabCount, __ATOMIC_RELAXED);
+    stats->states = __atomic_load_n(&stateCount, __ATOMIC_RELAXED);
+    stats->hugeSlabs = __atomic_load_n(&hugeSlabCount, __ATOMIC_RELAXED);
+}
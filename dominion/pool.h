@@ -0,0 +1,39 @@
+#ifndef _POOL_H
+#define _POOL_H
+
+#include "dominion.h"
+
+/* Game state pool.
+
+   States are carved out of large slabs, aligned to cache lines, and kept
+   on per-thread free lists, so acquire and release are O(1) and a
+   simulation loop that releases every state it acquires stops allocating
+   once the pool is warm.  A state may be released on any thread; it joins
+   that thread's free list.  Slabs are never returned to the system. */
+
+#define POOL_ALIGN 64
+#define POOL_SLAB_STATES 64
+
+struct gameState* poolAcquire(void);
+/* Uninitialized state from the calling thread's free list (a new slab is
+   allocated when it is empty); NULL if out of memory */
+
+void poolRelease(struct gameState *state);
+
+int poolReserve(int count);
+/* Make sure at least count states are free on the calling thread; returns
+   0, or -1 if memory ran out */
+
+void poolUseHugePages(int enable);
+/* Back slabs allocated from now on with huge pages when the system has
+   them (MAP_HUGETLB, else transparent huge pages); off by default */
+
+struct poolStats {
+    long long slabs;        //slabs allocated by all threads
+    long long states;       //states carved from them
+    long long hugeSlabs;    //slabs that got huge pages
+};
+
+void poolGetStats(struct poolStats *stats);
+
+#endif
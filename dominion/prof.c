@@ -0,0 +1,313 @@
+/* Hot-path profiling counters, see prof.h.  Everything here is compiled
+   only in PROFILE builds. */
+
+#ifdef PROFILE
+
+#define _POSIX_C_SOURCE 200809L
+
+#include "prof.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+#define PROF_MAX_NODES 2048
+#define PROF_MAX_DEPTH 64
+#define PROF_ROOT 0
+
+static const char *zoneNames[PROF_NUM_ZONES] = {
+    "initializeGame", "initializeGameFromTemplate", "shuffle", "playCard",
+    "buyCard", "endTurn", "isGameOver", "scoreFor", "getWinners", "fullDeckCount", "drawCard",
+    "discardCard", "gainCard", "updateCoins", "cardEffect",
+    "curse", "estate", "duchy", "province", "copper", "silver", "gold",
+    "adventurer", "council_room", "feast", "gardens", "mine", "remodel",
+    "smithy", "village", "baron", "great_hall", "minion", "steward",
+    "tribute", "ambassador", "cutpurse", "embargo", "outpost", "salvager",
+    "sea_hag", "treasure_map"
+};
+
+//one node per distinct call stack; node 0 is the (untimed) root
+struct profNode {
+    int zone;
+    int parent;
+    unsigned long long calls;
+    unsigned long long cycles; //inclusive
+};
+
+struct profFrame {
+    int node;
+    unsigned long long start;
+};
+
+struct profThread {
+    struct profNode node[PROF_MAX_NODES];
+    short child[PROF_MAX_NODES][PROF_NUM_ZONES];
+    int nodeCount;
+    struct profFrame stack[PROF_MAX_DEPTH];
+    int depth;
+    struct profThread *next;
+};
+
+static __thread struct profThread *self;
+static struct profThread *threads;
+static pthread_mutex_t threadsLock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_once_t exitOnce = PTHREAD_ONCE_INIT;
+
+static inline unsigned long long profTicks(void) {
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (unsigned long long)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+#endif
+}
+
+static void registerExit(void) {
+    atexit(profReport);
+}
+
+static struct profThread* attach(void) {
+    struct profThread *t = calloc(1, sizeof(struct profThread));
+    if (t == NULL) {
+        return NULL;
+    }
+    t->node[PROF_ROOT].zone = -1;
+    t->node[PROF_ROOT].parent = -1;
+    t->nodeCount = 1;
+
+    pthread_once(&exitOnce, registerExit);
+    pthread_mutex_lock(&threadsLock);
+    t->next = threads;
+    threads = t;
+    pthread_mutex_unlock(&threadsLock);
+    return t;
+}
+
+int profEnter(int zone) {
+    struct profThread *t = self;
+    int parent, n;
+
+    if (t == NULL) {
+        t = self = attach();
+        if (t == NULL) {
+            return zone;
+        }
+    }
+
+    if (t->depth >= PROF_MAX_DEPTH) {
+        t->depth++; //too deep: counted in the caller's frame
+        return zone;
+    }
+
+    parent = t->depth > 0 ? t->stack[t->depth - 1].node : PROF_ROOT;
+    n = -1;
+    if (parent >= 0 && zone >= 0 && zone < PROF_NUM_ZONES) {
+        n = t->child[parent][zone];
+        if (n == 0 && t->nodeCount < PROF_MAX_NODES) {
+            n = t->nodeCount++;
+            t->node[n].zone = zone;
+            t->node[n].parent = parent;
+            t->child[parent][zone] = n;
+        }
+        else if (n == 0) {
+            n = -1; //out of nodes: not recorded
+        }
+    }
+
+    t->stack[t->depth].node = n;
+    t->depth++;
+    t->stack[t->depth - 1].start = profTicks();
+    return zone;
+}
+
+void profLeave(int *zone) {
+    struct profThread *t = self;
+    struct profFrame *f;
+    unsigned long long end = profTicks();
+
+    (void)zone;
+    if (t == NULL || t->depth == 0) {
+        return;
+    }
+
+    t->depth--;
+    if (t->depth >= PROF_MAX_DEPTH) {
+        return;
+    }
+
+    f = &t->stack[t->depth];
+    if (f->node > 0) {
+        t->node[f->node].calls++;
+        t->node[f->node].cycles += end - f->start;
+    }
+}
+
+//merged view: same shape as a thread tree, keyed by call path
+static struct profNode merged[PROF_MAX_NODES];
+static short mergedChild[PROF_MAX_NODES][PROF_NUM_ZONES];
+static int mergedCount;
+
+static int mergeNode(int parent, int zone) {
+    int n = mergedChild[parent][zone];
+    if (n == 0) {
+        if (mergedCount >= PROF_MAX_NODES) {
+            return -1;
+        }
+        n = mergedCount++;
+        merged[n].zone = zone;
+        merged[n].parent = parent;
+        mergedChild[parent][zone] = n;
+    }
+    return n;
+}
+
+static void mergeThread(struct profThread *t) {
+    int map[PROF_MAX_NODES];
+    int i;
+
+    //parents always have lower indexes than their children
+    map[PROF_ROOT] = PROF_ROOT;
+    for (i = 1; i < t->nodeCount; i++) {
+        int p = map[t->node[i].parent];
+        map[i] = p < 0 ? -1 : mergeNode(p, t->node[i].zone);
+        if (map[i] > 0) {
+            merged[map[i]].calls += t->node[i].calls;
+            merged[map[i]].cycles += t->node[i].cycles;
+        }
+    }
+}
+
+static unsigned long long selfCycles(int n) {
+    unsigned long long children = 0;
+    int z;
+
+    for (z = 0; z < PROF_NUM_ZONES; z++) {
+        if (mergedChild[n][z] > 0) {
+            children += merged[mergedChild[n][z]].cycles;
+        }
+    }
+    return merged[n].cycles > children ? merged[n].cycles - children : 0;
+}
+
+static int onPath(int n, int zone) {
+    for (n = merged[n].parent; n > 0; n = merged[n].parent) {
+        if (merged[n].zone == zone) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+static void printFolded(FILE *f, int n) {
+    if (n <= 0) {
+        return;
+    }
+    if (merged[n].parent > 0) {
+        printFolded(f, merged[n].parent);
+        fputc(';', f);
+    }
+    fputs(zoneNames[merged[n].zone], f);
+}
+
+struct profLine {
+    int zone;
+    unsigned long long calls;
+    unsigned long long cycles;
+    unsigned long long self;
+};
+
+static int compareLines(const void *a, const void *b) {
+    const struct profLine *x = a;
+    const struct profLine *y = b;
+    if (x->cycles < y->cycles)
+        return 1;
+    if (x->cycles > y->cycles)
+        return -1;
+    return x->zone - y->zone;
+}
+
+void profReport(void) {
+    struct profLine lines[PROF_NUM_ZONES];
+    struct profThread *t;
+    unsigned long long total = 0;
+    const char *prefix = getenv("DOMINION_PROF");
+    char path[256];
+    FILE *f;
+    int i, z;
+
+    if (prefix == NULL || prefix[0] == '\0') {
+        prefix = "dominion-prof";
+    }
+
+    memset(merged, 0, sizeof(merged));
+    memset(mergedChild, 0, sizeof(mergedChild));
+    mergedCount = 1;
+
+    pthread_mutex_lock(&threadsLock);
+    for (t = threads; t != NULL; t = t->next) {
+        mergeThread(t);
+    }
+    pthread_mutex_unlock(&threadsLock);
+
+    if (mergedCount == 1) {
+        return;
+    }
+
+    //flat view; recursive activations only count once towards inclusive time
+    for (z = 0; z < PROF_NUM_ZONES; z++) {
+        lines[z].zone = z;
+        lines[z].calls = lines[z].cycles = lines[z].self = 0;
+    }
+    for (i = 1; i < mergedCount; i++) {
+        z = merged[i].zone;
+        lines[z].calls += merged[i].calls;
+        lines[z].self += selfCycles(i);
+        if (!onPath(i, z)) {
+            lines[z].cycles += merged[i].cycles;
+        }
+        if (merged[i].parent == PROF_ROOT) {
+            total += merged[i].cycles;
+        }
+    }
+    qsort(lines, PROF_NUM_ZONES, sizeof(struct profLine), compareLines);
+
+    snprintf(path, sizeof(path), "%s.%d.txt", prefix, (int)getpid());
+    f = fopen(path, "w");
+    if (f != NULL) {
+        fprintf(f, "%-16s %12s %16s %16s %10s %7s\n",
+                "zone", "calls", "cycles", "self", "cyc/call", "%total");
+        for (z = 0; z < PROF_NUM_ZONES; z++) {
+            if (lines[z].calls == 0) {
+                continue;
+            }
+            fprintf(f, "%-16s %12llu %16llu %16llu %10.1f %6.2f%%\n",
+                    zoneNames[lines[z].zone], lines[z].calls, lines[z].cycles,
+                    lines[z].self, (double)lines[z].cycles / lines[z].calls,
+                    total ? 100.0 * lines[z].cycles / total : 0.0);
+        }
+        fclose(f);
+    }
+
+    snprintf(path, sizeof(path), "%s.%d.folded", prefix, (int)getpid());
+    f = fopen(path, "w");
+    if (f != NULL) {
+        for (i = 1; i < mergedCount; i++) {
+            printFolded(f, i);
+            fprintf(f, " %llu\n", selfCycles(i));
+        }
+        fclose(f);
+    }
+}
+
+#else
+
+//keeps the translation unit non-empty in normal builds
+typedef int profDisabled;
+
+#endif
@@ -0,0 +1,62 @@
+#ifndef _PROF_H
+#define _PROF_H
+
+#include "dominion.h"
+
+/* Opt-in hot-path profiling.
+
+   Build with "make PROFILE=1" (adds -DPROFILE) to make every engine entry
+   point and every card branch of cardEffect keep per-thread call counts and
+   cycle totals.  Counters of all threads are merged when the process exits
+   and written to <prefix>.<pid>.txt (flat report sorted by cycles) and
+   <prefix>.<pid>.folded (folded stacks for flamegraph.pl).  The prefix is
+   taken from the DOMINION_PROF environment variable, "dominion-prof" if
+   unset.
+
+   In normal builds PROF_ZONE expands to nothing. */
+
+enum PROF_ZONE
+{   PROF_INITIALIZE_GAME = 0,
+    PROF_INITIALIZE_FROM_TEMPLATE,
+    PROF_SHUFFLE,
+    PROF_PLAY_CARD,
+    PROF_BUY_CARD,
+    PROF_END_TURN,
+    PROF_IS_GAME_OVER,
+    PROF_SCORE_FOR,
+    PROF_GET_WINNERS,
+    PROF_FULL_DECK_COUNT,
+    PROF_DRAW_CARD,
+    PROF_DISCARD_CARD,
+    PROF_GAIN_CARD,
+    PROF_UPDATE_COINS,
+    PROF_CARD_EFFECT,
+    PROF_CARD_BASE, /* one zone per card branch: PROF_CARD_BASE + card */
+    PROF_NUM_ZONES = PROF_CARD_BASE + treasure_map + 1
+};
+
+#ifdef PROFILE
+
+int profEnter(int zone);
+/* Open a zone on the calling thread's stack; returns the zone */
+
+void profLeave(int *zone);
+/* Close the innermost zone; used as a cleanup handler by PROF_ZONE */
+
+void profReport(void);
+/* Merge all threads' counters and write the report files now (also
+   runs automatically at exit) */
+
+/* Times the rest of the enclosing block, whichever way it is left */
+#define PROF_ZONE(zone) PROF_ZONE_AT(zone, __LINE__)
+#define PROF_ZONE_AT(zone, line) PROF_ZONE_VAR(zone, line)
+#define PROF_ZONE_VAR(zone, line) \
+    int profZone_##line __attribute__((cleanup(profLeave), unused)) = profEnter(zone)
+
+#else
+
+#define PROF_ZONE(zone)
+
+#endif
+
+#endif
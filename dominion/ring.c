@@ -0,0 +1,106 @@
+#define _GNU_SOURCE
+
+#include "ring.h"
+#include <errno.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <linux/futex.h>
+#include <sys/syscall.h>
+
+//spins before sleeping; -1 until the CPU count is known
+static int ringSpin = -1;
+
+static unsigned int roundSlots(unsigned int slots) {
+    unsigned int n = 1;
+
+    while (n < slots)
+        n <<= 1;
+    return n;
+}
+
+size_t ringSize(unsigned int slots, size_t msgSize) {
+    return sizeof(struct ring) + (size_t)roundSlots(slots) * ((msgSize + 63) & ~(size_t)63);
+}
+
+void ringInit(struct ring *r, unsigned int slots, size_t msgSize) {
+    memset(r, 0, sizeof(struct ring));
+    r->slots = roundSlots(slots);
+    r->msgSize = (unsigned int)((msgSize + 63) & ~(size_t)63);
+}
+
+static void* slotAt(struct ring *r, unsigned int i) {
+    return (char*)(r + 1) + (size_t)(i & (r->slots - 1)) * r->msgSize;
+}
+
+//shared (not FUTEX_PRIVATE) since the two sides are different processes
+static long futex(unsigned int *word, int op, unsigned int value, const struct timespec *timeout) {
+    return syscall(SYS_futex, word, op, value, timeout, NULL, 0);
+}
+
+static void wake(unsigned int *word, unsigned int *waiting) {
+    if (__atomic_load_n(waiting, __ATOMIC_SEQ_CST))
+        futex(word, FUTEX_WAKE, 1, NULL);
+}
+
+//wait until *word is no longer value; -1 on timeout
+static int waitWhile(unsigned int *word, unsigned int *waiting, unsigned int value, int timeoutMs) {
+    struct timespec ts;
+    int i;
+
+    if (ringSpin < 0)
+        ringSpin = sysconf(_SC_NPROCESSORS_ONLN) > 1 ? 4000 : 0;
+    for (i = 0; i < ringSpin; i++) {
+        if (__atomic_load_n(word, __ATOMIC_ACQUIRE) != value)
+            return 0;
+#if defined(__x86_64__) || defined(__i386__)
+        __builtin_ia32_pause();
+#endif
+    }
+
+    ts.tv_sec = timeoutMs / 1000;
+    ts.tv_nsec = (long)(timeoutMs % 1000) * 1000000;
+    //the waiting flag and the counter are both seq_cst, so either the
+    //other side sees the flag and wakes us, or we see its new count
+    __atomic_store_n(waiting, 1, __ATOMIC_SEQ_CST);
+    while (__atomic_load_n(word, __ATOMIC_SEQ_CST) == value) {
+        if (futex(word, FUTEX_WAIT, value, timeoutMs < 0 ? NULL : &ts) < 0 && errno == ETIMEDOUT &&
+                __atomic_load_n(word, __ATOMIC_SEQ_CST) == value) {
+            __atomic_store_n(waiting, 0, __ATOMIC_SEQ_CST);
+            return -1;
+        }
+    }
+    __atomic_store_n(waiting, 0, __ATOMIC_SEQ_CST);
+    return 0;
+}
+
+void* ringReserve(struct ring *r, int timeoutMs) {
+    unsigned int head = r->head;
+    unsigned int tail;
+
+    while (head - (tail = __atomic_load_n(&r->tail, __ATOMIC_ACQUIRE)) == r->slots) {
+        if (waitWhile(&r->tail, &r->tailWaiting, tail, timeoutMs) < 0)
+            return NULL;
+    }
+    return slotAt(r, head);
+}
+
+void ringPublish(struct ring *r) {
+    __atomic_store_n(&r->head, r->head + 1, __ATOMIC_SEQ_CST);
+    wake(&r->head, &r->headWaiting);
+}
+
+void* ringPeek(struct ring *r, int timeoutMs) {
+    unsigned int tail = r->tail;
+
+    while (__atomic_load_n(&r->head, __ATOMIC_ACQUIRE) == tail) {
+        if (waitWhile(&r->head, &r->headWaiting, tail, timeoutMs) < 0)
+            return NULL;
+    }
+    return slotAt(r, tail);
+}
+
+void ringRelease(struct ring *r) {
+    __atomic_store_n(&r->tail, r->tail + 1, __ATOMIC_SEQ_CST);
+    wake(&r->tail, &r->tailWaiting);
+}
@@ -0,0 +1,48 @@
+#ifndef _RING_H
+#define _RING_H
+
+#include <stddef.h>
+
+/* Single-producer, single-consumer message ring for shared memory.
+
+   The ring lives entirely in the memory it is initialized in (no
+   pointers), so two processes that map the same file can use it, one
+   writing and one reading.  Messages are fixed size slots written in
+   place: the producer reserves a slot, fills it and publishes it; the
+   consumer peeks at it and releases it when done.
+
+   A side that has to wait spins briefly on machines with more than one
+   CPU, then sleeps on a futex on the other side's counter; the other side
+   only makes the wake system call when someone is asleep. */
+
+struct ring {
+    unsigned int head;          //messages published, written by the producer
+    unsigned int headWaiting;   //consumer asleep on head
+    char pad0[56];
+    unsigned int tail;          //messages released, written by the consumer
+    unsigned int tailWaiting;   //producer asleep on tail
+    char pad1[56];
+    unsigned int slots;         //power of two
+    unsigned int msgSize;       //slot size, a multiple of 64
+    char pad2[56];
+    //slots follow
+};
+
+size_t ringSize(unsigned int slots, size_t msgSize);
+/* Bytes needed for a ring of slots (rounded up to a power of two)
+   messages of msgSize bytes */
+
+void ringInit(struct ring *r, unsigned int slots, size_t msgSize);
+/* Set up an empty ring in ringSize(slots, msgSize) bytes at r */
+
+void* ringReserve(struct ring *r, int timeoutMs);
+void ringPublish(struct ring *r);
+/* Producer: wait for a free slot and return it (NULL after waiting about
+   timeoutMs, or never if timeoutMs < 0), then publish it once written */
+
+void* ringPeek(struct ring *r, int timeoutMs);
+void ringRelease(struct ring *r);
+/* Consumer: wait for the oldest message and return it (NULL as for
+   ringReserve), then release its slot once read */
+
+#endif
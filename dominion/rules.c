@@ -0,0 +1,471 @@
+#include "rules.h"
+#include "dominion_helpers.h"
+#include <ctype.h>
+#include <stdlib.h>
+#include <string.h>
+
+static const char *cardNames[treasure_map + 1] = {
+    "curse", "estate", "duchy", "province", "copper", "silver", "gold",
+    "adventurer", "council_room", "feast", "gardens", "mine", "remodel",
+    "smithy", "village", "baron", "great_hall", "minion", "steward",
+    "tribute", "ambassador", "cutpurse", "embargo", "outpost", "salvager",
+    "sea_hag", "treasure_map"
+};
+
+int cardFromName(const char *name) {
+    int i;
+    for (i = 0; i <= treasure_map; i++) {
+        if (strcmp(cardNames[i], name) == 0)
+            return i;
+    }
+    return -1;
+}
+
+const char* cardName(int card) {
+    return card >= 0 && card <= treasure_map ? cardNames[card] : "?";
+}
+
+void ruleInit(struct buyRule *r, int card, int minCoins) {
+    memset(r, 0, sizeof(struct buyRule));
+    r->card = card;
+    r->minCoins = minCoins;
+    r->maxCoins = RULE_ANY;
+    r->minProvinces = 0;
+    r->maxProvinces = RULE_ANY;
+}
+
+//default play order: villages, then actions that need no choices
+static int defaultRank(int card) {
+    switch (card) {
+    case village:
+    case great_hall:
+        return 0;
+    case smithy:
+    case adventurer:
+    case council_room:
+    case cutpurse:
+    case sea_hag:
+        return 1;
+    default:
+        return -1;
+    }
+}
+
+static int capped(int n, int cap) {
+    return n < cap ? n : cap;
+}
+
+void ruleBotCompile(struct ruleBot *rb) {
+    struct decisionTable *t = &rb->table;
+    struct buyRule *r;
+    int coins, provinces, n, i, j, slot, allowed;
+
+    memset(t, 0, sizeof(struct decisionTable));
+
+    for (coins = 0; coins <= RULE_COIN_CAP; coins++) {
+        for (provinces = 0; provinces <= RULE_PROVINCE_CAP; provinces++) {
+            for (i = 0; i < rb->numRules; i++) {
+                r = &rb->rule[i];
+                allowed = coins >= r->minCoins && coins <= r->maxCoins &&
+                          coins >= getCost(r->card) &&
+                          provinces >= r->minProvinces && provinces <= r->maxProvinces;
+                t->byCoins[coins][provinces] |= (unsigned int)allowed << i;
+            }
+        }
+    }
+
+    //one mask row per counted card; rules without a condition on it pass
+    for (i = 0; i < rb->numRules; i++) {
+        for (j = 0; j < rb->rule[i].numCounts; j++) {
+            for (slot = 0; slot < t->numCounted && t->counted[slot] != rb->rule[i].count[j].card; slot++)
+                ;
+            if (slot == t->numCounted) {
+                t->counted[t->numCounted++] = rb->rule[i].count[j].card;
+                for (n = 0; n <= RULE_COUNT_CAP; n++) {
+                    t->byCount[slot][n] = ~0u;
+                }
+            }
+            for (n = 0; n <= RULE_COUNT_CAP; n++) {
+                if (n < rb->rule[i].count[j].min || n > rb->rule[i].count[j].max)
+                    t->byCount[slot][n] &= ~(1u << i);
+            }
+        }
+    }
+
+    for (i = 0; i < rb->numRules; i++) {
+        t->card[i] = rb->rule[i].card;
+    }
+    t->card[rb->numRules] = -1;
+
+    memset(t->playRank, 255, sizeof(t->playRank));
+    if (rb->numPlays > 0) {
+        for (i = rb->numPlays - 1; i >= 0; i--) {
+            t->playRank[rb->play[i]] = i;
+        }
+    } else {
+        for (i = 0; i <= treasure_map; i++) {
+            if (defaultRank(i) == 0)
+                t->playRank[i] = 0;
+        }
+        for (i = rb->numRules - 1; i >= 0; i--) {
+            if (defaultRank(rb->rule[i].card) == 1)
+                t->playRank[rb->rule[i].card] = 1 + i;
+        }
+    }
+}
+
+static int tableAction(struct gameState *state, int choices[3], void *ctx) {
+    struct ruleBot *rb = ctx;
+    int player = whoseTurn(state);
+    int pos, rank, best = -1, bestRank = 255;
+
+    choices[0] = choices[1] = choices[2] = -1;
+    for (pos = 0; pos < state->handCount[player]; pos++) {
+        rank = rb->table.playRank[state->hand[player][pos]];
+        if (rank < bestRank) {
+            bestRank = rank;
+            best = pos;
+        }
+    }
+    return best;
+}
+
+static int tableBuy(struct gameState *state, void *ctx) {
+    struct ruleBot *rb = ctx;
+    struct decisionTable *t = &rb->table;
+    int player = whoseTurn(state);
+    int counts[treasure_map + 1];
+    unsigned int mask;
+    int i;
+
+    mask = t->byCoins[capped(state->coins, RULE_COIN_CAP)]
+           [capped(state->supplyCount[province], RULE_PROVINCE_CAP)];
+
+    //owned copies as fullDeckCount, for every card at once
+    if (t->numCounted > 0) {
+        memset(counts, 0, sizeof(counts));
+        for (i = 0; i < state->deckCount[player]; i++)
+            counts[state->deck[player][i]]++;
+        for (i = 0; i < state->handCount[player]; i++)
+            counts[state->hand[player][i]]++;
+        for (i = 0; i < state->discardCount[player]; i++)
+            counts[state->discard[player][i]]++;
+        for (i = 0; i < t->numCounted; i++)
+            mask &= t->byCount[i][capped(counts[t->counted[i]], RULE_COUNT_CAP)];
+    }
+
+    for (i = 0; i < rb->numRules; i++) {
+        mask &= ~((unsigned int)(state->supplyCount[t->card[i]] <= 0) << i);
+    }
+    //no rule left picks the -1 after the last rule
+    return t->card[__builtin_ctz(mask | 1u << rb->numRules)];
+}
+
+void ruleBotSimBot(struct ruleBot *rb, struct simBot *bot) {
+    ruleBotCompile(rb);
+    bot->name = rb->name;
+    bot->action = tableAction;
+    bot->buy = tableBuy;
+    bot->ctx = rb;
+    bot->definition = NULL;
+}
+
+//tokenizer over one statement
+struct lexer {
+    const char *p;
+    char token[64];
+};
+
+static const char* nextToken(struct lexer *lx) {
+    int n = 0;
+
+    while (isspace((unsigned char)*lx->p))
+        lx->p++;
+    if (*lx->p == '\0')
+        return NULL;
+    if (isalnum((unsigned char)*lx->p) || *lx->p == '_' || *lx->p == '-') {
+        while ((isalnum((unsigned char)*lx->p) || *lx->p == '_' || *lx->p == '-') && n < 63)
+            lx->token[n++] = *lx->p++;
+    } else if (strchr("<>=", *lx->p) != NULL) {
+        lx->token[n++] = *lx->p++;
+        if (*lx->p == '=')
+            lx->token[n++] = *lx->p++;
+    } else {
+        lx->token[n++] = *lx->p++;
+    }
+    lx->token[n] = '\0';
+    return lx->token;
+}
+
+static int expect(struct lexer *lx, const char *token) {
+    const char *t = nextToken(lx);
+    return t != NULL && strcmp(t, token) == 0;
+}
+
+static int nextNumber(struct lexer *lx, int *n) {
+    const char *t = nextToken(lx);
+    char *end;
+
+    if (t == NULL)
+        return -1;
+    *n = (int)strtol(t, &end, 10);
+    return *end == '\0' ? 0 : -1;
+}
+
+static int nextCard(struct lexer *lx) {
+    const char *t = nextToken(lx);
+    return t == NULL ? -1 : cardFromName(t);
+}
+
+//narrow [min, max] by "op n"; -2 if the compiled tables, which see
+//values from cap on as cap, could not tell n from its neighbours
+static int narrow(const char *op, int n, int cap, int *min, int *max) {
+    int lo = *min, hi = *max;
+
+    if (strcmp(op, "<") == 0)
+        hi = n - 1;
+    else if (strcmp(op, "<=") == 0)
+        hi = n;
+    else if (strcmp(op, ">") == 0)
+        lo = n + 1;
+    else if (strcmp(op, ">=") == 0)
+        lo = n;
+    else if (strcmp(op, "==") == 0)
+        lo = hi = n;
+    else
+        return -1;
+
+    if (lo > cap || (hi != *max && hi >= cap))
+        return -2;
+    if (lo > *min)
+        *min = lo;
+    if (hi < *max)
+        *max = hi;
+    return 0;
+}
+
+static int parseCondition(struct lexer *lx, struct buyRule *r) {
+    char what[64], op[64];
+    struct ruleCount *c;
+    int card = -1, n, i;
+
+    if (nextToken(lx) == NULL)
+        return -1;
+    snprintf(what, sizeof(what), "%s", lx->token);
+    if (strcmp(what, "count") == 0) {
+        if (!expect(lx, "(") || (card = nextCard(lx)) < 0 || !expect(lx, ")"))
+            return -1;
+    }
+    if (nextToken(lx) == NULL)
+        return -1;
+    snprintf(op, sizeof(op), "%s", lx->token);
+    if (nextNumber(lx, &n) < 0)
+        return -1;
+
+    if (strcmp(what, "coins") == 0)
+        return narrow(op, n, RULE_COIN_CAP, &r->minCoins, &r->maxCoins);
+    if (strcmp(what, "provinces") == 0)
+        //there are never more than RULE_PROVINCE_CAP
+        return narrow(op, n, RULE_ANY, &r->minProvinces, &r->maxProvinces);
+    if (card < 0)
+        return -1;
+
+    for (i = 0; i < r->numCounts && r->count[i].card != card; i++)
+        ;
+    if (i == RULE_COUNTS)
+        return -1;
+    c = &r->count[i];
+    if (i == r->numCounts) {
+        c->card = card;
+        c->min = 0;
+        c->max = RULE_ANY;
+        r->numCounts++;
+    }
+    return narrow(op, n, RULE_COUNT_CAP, &c->min, &c->max);
+}
+
+static int parseStatement(const char *text, struct ruleBot *rb) {
+    struct lexer lx;
+    struct buyRule *r;
+    const char *t;
+    int card, result;
+
+    lx.p = text;
+    t = nextToken(&lx);
+    if (t == NULL)
+        return 0;
+
+    if (strcmp(t, "name") == 0) {
+        if (nextToken(&lx) == NULL)
+            return -1;
+        snprintf(rb->name, sizeof(rb->name), "%s", lx.token);
+        return nextToken(&lx) == NULL ? 0 : -1;
+    }
+
+    if (strcmp(t, "play") == 0) {
+        do {
+            if ((card = nextCard(&lx)) < 0 || rb->numPlays > treasure_map)
+                return -1;
+            rb->play[rb->numPlays++] = card;
+        } while ((t = nextToken(&lx)) != NULL && strcmp(t, ",") == 0);
+        return t == NULL ? 0 : -1;
+    }
+
+    if (strcmp(t, "buy") == 0) {
+        if (rb->numRules == RULE_MAX || (card = nextCard(&lx)) < 0)
+            return -1;
+        r = &rb->rule[rb->numRules];
+        ruleInit(r, card, 0);
+        if ((t = nextToken(&lx)) != NULL) {
+            if (strcmp(t, "if") != 0)
+                return -1;
+            do {
+                if ((result = parseCondition(&lx, r)) < 0)
+                    return result;
+            } while ((t = nextToken(&lx)) != NULL && strcmp(t, "and") == 0);
+            if (t != NULL)
+                return -1;
+        }
+        rb->numRules++;
+        return 0;
+    }
+    return -1;
+}
+
+int ruleBotParse(const char *text, struct ruleBot *rb) {
+    char line[512], *statement, *end;
+    const char *p = text;
+    int n = 0, result;
+    size_t len;
+
+    memset(rb, 0, sizeof(struct ruleBot));
+    strcpy(rb->name, "rules");
+    while (*p != '\0') {
+        len = strcspn(p, "\n");
+        snprintf(line, sizeof(line), "%.*s", (int)len, p);
+        p += len + (p[len] == '\n');
+        n++;
+
+        if ((end = strchr(line, '#')) != NULL)
+            *end = '\0';
+        //not strtok: callers may be inside a strtok loop of their own
+        for (statement = line; statement != NULL; statement = end) {
+            if ((end = strchr(statement, ';')) != NULL)
+                *end++ = '\0';
+            if ((result = parseStatement(statement, rb)) == -2) {
+                fprintf(stderr, "rules line %d: threshold out of range (coins and counts are "
+                        "only told apart up to %d and %d): %s\n", n, RULE_COIN_CAP, RULE_COUNT_CAP, statement);
+                return -1;
+            }
+            if (result < 0) {
+                fprintf(stderr, "rules line %d: cannot parse: %s\n", n, statement);
+                return -1;
+            }
+        }
+    }
+    return 0;
+}
+
+int ruleBotLoad(const char *path, struct ruleBot *rb) {
+    FILE *f = fopen(path, "r");
+    char *text;
+    long size;
+    int result = -1;
+
+    if (f == NULL) {
+        perror(path);
+        return -1;
+    }
+    fseek(f, 0, SEEK_END);
+    size = ftell(f);
+    rewind(f);
+    text = malloc(size + 1);
+    if (text != NULL && fread(text, 1, size, f) == (size_t)size) {
+        text[size] = '\0';
+        result = ruleBotParse(text, rb);
+    }
+    free(text);
+    fclose(f);
+    return result;
+}
+
+//"buy card if ..." for one rule
+static int formatRule(struct buyRule *r, char *text, size_t size) {
+    const char *join = " if ";
+    int used, i;
+
+#define COND(...) do { \
+        used += snprintf(text + used, size > (size_t)used ? size - used : 0, "%s", join); \
+        used += snprintf(text + used, size > (size_t)used ? size - used : 0, __VA_ARGS__); \
+        join = " and "; \
+    } while (0)
+
+    used = snprintf(text, size, "buy %s", cardName(r->card));
+    if (r->minCoins > 0)
+        COND("coins>=%d", r->minCoins);
+    if (r->maxCoins < RULE_ANY)
+        COND("coins<=%d", r->maxCoins);
+    if (r->minProvinces > 0)
+        COND("provinces>=%d", r->minProvinces);
+    if (r->maxProvinces < RULE_ANY)
+        COND("provinces<=%d", r->maxProvinces);
+    for (i = 0; i < r->numCounts; i++) {
+        if (r->count[i].min > 0)
+            COND("count(%s)>=%d", cardName(r->count[i].card), r->count[i].min);
+        if (r->count[i].max < RULE_ANY)
+            COND("count(%s)<%d", cardName(r->count[i].card), r->count[i].max + 1);
+    }
+#undef COND
+    return used;
+}
+
+static int formatPlays(struct ruleBot *rb, char *text, size_t size) {
+    int used = 0, i;
+
+    for (i = 0; i < rb->numPlays; i++) {
+        used += snprintf(text + used, size > (size_t)used ? size - used : 0, "%s%s",
+                         i == 0 ? "play " : ", ", cardName(rb->play[i]));
+    }
+    return used;
+}
+
+int ruleBotWrite(FILE *f, struct ruleBot *rb) {
+    char text[RULE_TEXT_MAX];
+    int i;
+
+    fprintf(f, "name %s\n", rb->name);
+    if (rb->numPlays > 0) {
+        formatPlays(rb, text, sizeof(text));
+        fprintf(f, "%s\n", text);
+    }
+    for (i = 0; i < rb->numRules; i++) {
+        formatRule(&rb->rule[i], text, sizeof(text));
+        fprintf(f, "%s\n", text);
+    }
+    return ferror(f) ? -1 : 0;
+}
+
+int ruleBotSave(const char *path, struct ruleBot *rb) {
+    FILE *f = fopen(path, "w");
+    int result;
+
+    if (f == NULL) {
+        perror(path);
+        return -1;
+    }
+    result = ruleBotWrite(f, rb);
+    return fclose(f) == 0 ? result : -1;
+}
+
+void ruleBotFormat(struct ruleBot *rb, char *text, size_t size) {
+    size_t used;
+    int i;
+
+    used = formatPlays(rb, text, size);
+    for (i = 0; i < rb->numRules && used < size; i++) {
+        if (used > 0)
+            used += snprintf(text + used, size - used, "; ");
+        if (used < size)
+            used += formatRule(&rb->rule[i], text + used, size - used);
+    }
+}
@@ -0,0 +1,107 @@
+#ifndef _RULES_H
+#define _RULES_H
+
+#include "sim.h"
+#include <stdio.h>
+
+/* Rule bots: strategies written in a small text language instead of C.
+
+   A bot is a list of statements, one per line or separated by ';':
+
+     # comment
+     name big-smithy
+     play village, smithy
+     buy province if coins>=8
+     buy gold if coins>=6
+     buy smithy if coins>=4 and count(smithy)<2
+     buy duchy if coins>=5 and provinces<=4
+     buy silver if coins>=3
+
+   The buy phase buys the first card whose conditions all hold and that
+   the player can afford; conditions compare coins, provinces (left in
+   the supply) or count(card) (copies owned, as fullDeckCount) with a
+   number using <, <=, >, >= or ==.  Coins from RULE_COIN_CAP on, and
+   counts from RULE_COUNT_CAP on, look the same to a bot, so a condition
+   that would tell them apart is rejected.  The action phase plays the
+   first action in hand in play order; without play statements that is
+   villages first, then the actions that need no choices in the order
+   they are bought.  Card names are the enum names in dominion.h.
+
+   A loaded bot is compiled into a decision table: the rules that pass
+   their coin, province and cost conditions are precomputed as a bit mask
+   for every coin and province count, and count conditions as masks for
+   every count, so a buy decision is a few table lookups and mask ands
+   instead of walking the rules. */
+
+#define RULE_MAX 16         /* buy rules per bot */
+#define RULE_COUNTS 2       /* count conditions per rule */
+#define RULE_ANY 99         /* upper bound meaning none */
+#define RULE_TEXT_MAX (RULE_MAX * 96)
+
+#define RULE_COIN_CAP 16    /* coin counts from here on look the same */
+#define RULE_PROVINCE_CAP 12
+#define RULE_COUNT_CAP 16
+
+struct ruleCount {
+    int card;
+    int min;
+    int max;
+};
+
+struct buyRule {
+    int card;
+    int minCoins;
+    int maxCoins;
+    int minProvinces;
+    int maxProvinces;
+    int numCounts;
+    struct ruleCount count[RULE_COUNTS];
+};
+
+struct decisionTable {
+    unsigned int byCoins[RULE_COIN_CAP + 1][RULE_PROVINCE_CAP + 1];
+    int numCounted;                     //distinct cards in count conditions
+    int counted[RULE_MAX * RULE_COUNTS];
+    unsigned int byCount[RULE_MAX * RULE_COUNTS][RULE_COUNT_CAP + 1];
+    int card[RULE_MAX + 1];             //card of each rule, then -1
+    unsigned char playRank[treasure_map + 1];   //255: never play
+};
+
+struct ruleBot {
+    char name[64];
+    int numRules;
+    struct buyRule rule[RULE_MAX];
+    int numPlays;
+    int play[treasure_map + 1];
+    struct decisionTable table;         //filled by ruleBotCompile
+};
+
+void ruleInit(struct buyRule *r, int card, int minCoins);
+/* Rule that buys card with at least minCoins and no other condition */
+
+void ruleBotCompile(struct ruleBot *rb);
+/* Build rb's decision table; needed again after the rules change */
+
+void ruleBotSimBot(struct ruleBot *rb, struct simBot *bot);
+/* Compile rb and make bot play by it; rb must outlive bot */
+
+int ruleBotParse(const char *text, struct ruleBot *rb);
+/* Parse a whole program; -1 (with a message on stderr) on a bad statement */
+
+int ruleBotLoad(const char *path, struct ruleBot *rb);
+int ruleBotSave(const char *path, struct ruleBot *rb);
+
+int ruleBotWrite(FILE *f, struct ruleBot *rb);
+/* One statement per line, in a form ruleBotParse reads back */
+
+void ruleBotFormat(struct ruleBot *rb, char *text, size_t size);
+/* The statements on one line, separated by "; " (size RULE_TEXT_MAX is
+   always enough); also parseable, and used for cache keys */
+
+int cardFromName(const char *name);
+/* Card number of an enum name, -1 if there is none */
+
+const char* cardName(int card);
+/* Enum name of a card, "?" if it is not one */
+
+#endif
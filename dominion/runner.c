@@ -0,0 +1,299 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include "runner.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+
+#define MAX_WORKERS 256
+
+struct runnerRecord {
+    int worker;
+    int status;
+    long unit;
+};
+
+struct workerSlot {
+    pid_t pid;
+    int taskFd;
+    int alive;
+    long queued[RUNNER_MAX_INFLIGHT]; //in the order the worker runs them
+    int queuedCount;
+};
+
+static int readFull(int fd, void *buf, size_t size) {
+    size_t done = 0;
+    ssize_t n;
+
+    while (done < size) {
+        n = read(fd, (char*)buf + done, size - done);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+            return (int)done;
+        done += n;
+    }
+    return (int)done;
+}
+
+static int writeFull(int fd, const void *buf, size_t size) {
+    size_t done = 0;
+    ssize_t n;
+
+    while (done < size) {
+        n = write(fd, (const char*)buf + done, size - done);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+            return -1;
+        done += n;
+    }
+    return 0;
+}
+
+static void workerMain(struct runner *r, int id, int taskFd, int resultFd) {
+    char buf[sizeof(struct runnerRecord) + RUNNER_MAX_RESULT];
+    struct runnerRecord *rec = (struct runnerRecord*)buf;
+    size_t size = sizeof(struct runnerRecord) + r->resultSize;
+    long unit;
+    int devNull;
+
+    //card effects print; keep that out of the driver's output
+    devNull = open("/dev/null", O_WRONLY);
+    if (devNull >= 0) {
+        dup2(devNull, STDOUT_FILENO);
+        close(devNull);
+    }
+
+    while (readFull(taskFd, &unit, sizeof(unit)) == sizeof(unit) && unit >= 0) {
+        memset(buf, 0, size);
+        rec->worker = id;
+        rec->unit = unit;
+        rec->status = r->work(unit, buf + sizeof(struct runnerRecord), r->ctx);
+        if (writeFull(resultFd, buf, size) < 0)
+            break;
+    }
+    _exit(0);
+}
+
+static int runInProcess(struct runner *r) {
+    char result[RUNNER_MAX_RESULT];
+    long unit;
+    int stop = 0;
+
+    while (!stop && (unit = r->next(r->ctx)) >= 0) {
+        memset(result, 0, r->resultSize);
+        if (r->work(unit, result, r->ctx) < 0) {
+            fprintf(stderr, "runner: unit %ld failed\n", unit);
+            return -1;
+        }
+        stop = r->collect(unit, result, r->ctx);
+    }
+    return 0;
+}
+
+//units to hand out again because their worker died
+struct retryList {
+    long unit[MAX_WORKERS * RUNNER_MAX_INFLIGHT];
+    int count;
+    long retried[MAX_WORKERS * RUNNER_MAX_INFLIGHT];
+    int retriedCount;
+};
+
+static int alreadyRetried(struct retryList *l, long unit) {
+    int i;
+    for (i = 0; i < l->retriedCount; i++) {
+        if (l->retried[i] == unit)
+            return 1;
+    }
+    return 0;
+}
+
+static int reapDead(struct workerSlot *w, int workers, struct retryList *l, int *inflight) {
+    pid_t pid;
+    int status, i, j;
+
+    while ((pid = waitpid(-1, &status, WNOHANG)) > 0) {
+        for (i = 0; i < workers; i++) {
+            if (w[i].pid != pid || !w[i].alive)
+                continue;
+            w[i].alive = 0;
+            close(w[i].taskFd);
+            for (j = 0; j < w[i].queuedCount; j++) {
+                if (alreadyRetried(l, w[i].queued[j]) ||
+                        l->retriedCount >= MAX_WORKERS * RUNNER_MAX_INFLIGHT) {
+                    fprintf(stderr, "runner: unit %ld killed two workers\n", w[i].queued[j]);
+                    return -1;
+                }
+                fprintf(stderr, "runner: worker %d died, retrying unit %ld\n", i, w[i].queued[j]);
+                l->retried[l->retriedCount++] = w[i].queued[j];
+                l->unit[l->count++] = w[i].queued[j];
+                (*inflight)--;
+            }
+            w[i].queuedCount = 0;
+        }
+    }
+    return 0;
+}
+
+int runnerRun(struct runner *r) {
+    static struct retryList retry;
+    struct workerSlot w[MAX_WORKERS];
+    char buf[sizeof(struct runnerRecord) + RUNNER_MAX_RESULT];
+    struct runnerRecord *rec = (struct runnerRecord*)buf;
+    size_t size = sizeof(struct runnerRecord) + r->resultSize;
+    int resultPipe[2];
+    int taskPipe[2];
+    int workers = r->workers;
+    int depth = r->inflight;
+    int inflight = 0;
+    int stopping = 0;
+    int exhausted = 0;
+    int failed = 0;
+    int alive;
+    void (*oldPipe)(int);
+    struct pollfd pfd;
+    long unit;
+    int i, j;
+
+    if (r->resultSize < 0 || r->resultSize > RUNNER_MAX_RESULT) {
+        return -1;
+    }
+    if (workers <= 0) {
+        return runInProcess(r);
+    }
+    if (workers > MAX_WORKERS)
+        workers = MAX_WORKERS;
+    if (depth < 1)
+        depth = 1;
+    if (depth > RUNNER_MAX_INFLIGHT)
+        depth = RUNNER_MAX_INFLIGHT;
+
+    if (pipe(resultPipe) < 0) {
+        return -1;
+    }
+    fflush(NULL); //do not let workers inherit buffered output
+
+    for (i = 0; i < workers; i++) {
+        if (pipe(taskPipe) < 0) {
+            workers = i;
+            break;
+        }
+        w[i].pid = fork();
+        if (w[i].pid == 0) {
+            for (j = 0; j < i; j++)
+                close(w[j].taskFd);
+            close(taskPipe[1]);
+            close(resultPipe[0]);
+            workerMain(r, i, taskPipe[0], resultPipe[1]);
+        }
+        close(taskPipe[0]);
+        if (w[i].pid < 0) {
+            close(taskPipe[1]);
+            workers = i;
+            break;
+        }
+        w[i].taskFd = taskPipe[1];
+        w[i].alive = 1;
+        w[i].queuedCount = 0;
+    }
+    close(resultPipe[1]);
+    if (workers == 0) {
+        close(resultPipe[0]);
+        return -1;
+    }
+
+    oldPipe = signal(SIGPIPE, SIG_IGN);
+    fcntl(resultPipe[0], F_SETFL, fcntl(resultPipe[0], F_GETFL) | O_NONBLOCK);
+    retry.count = retry.retriedCount = 0;
+
+    while (!failed) {
+        //keep every live worker's queue full
+        for (i = 0; i < workers && !exhausted; i++) {
+            while (w[i].alive && w[i].queuedCount < depth) {
+                if (retry.count > 0)
+                    unit = retry.unit[--retry.count];
+                else if (!stopping)
+                    unit = r->next(r->ctx);
+                else
+                    unit = -1;
+                if (unit < 0) {
+                    exhausted = 1;
+                    break;
+                }
+                if (writeFull(w[i].taskFd, &unit, sizeof(unit)) < 0) {
+                    retry.unit[retry.count++] = unit;
+                    break; //dead, reaped below
+                }
+                w[i].queued[w[i].queuedCount++] = unit;
+                inflight++;
+            }
+        }
+        exhausted = 0;
+
+        if (inflight == 0 && retry.count == 0) {
+            break;
+        }
+
+        //collect everything that is ready
+        while (readFull(resultPipe[0], buf, size) == (int)size) {
+            struct workerSlot *s = &w[rec->worker];
+            for (j = 0; j < s->queuedCount && s->queued[j] != rec->unit; j++)
+                ;
+            if (j == s->queuedCount)
+                continue; //was already handed to another worker
+            memmove(&s->queued[j], &s->queued[j + 1], (s->queuedCount - j - 1) * sizeof(long));
+            s->queuedCount--;
+            inflight--;
+
+            if (rec->status < 0) {
+                fprintf(stderr, "runner: unit %ld failed\n", rec->unit);
+                failed = 1;
+                break;
+            }
+            if (r->collect(rec->unit, buf + sizeof(struct runnerRecord), r->ctx))
+                stopping = 1;
+        }
+
+        if (reapDead(w, workers, &retry, &inflight) < 0) {
+            failed = 1;
+        }
+        for (alive = 0, i = 0; i < workers; i++)
+            alive += w[i].alive;
+        if (alive == 0 && (inflight > 0 || retry.count > 0)) {
+            failed = 1;
+        }
+
+        if (!failed && inflight > 0) {
+            pfd.fd = resultPipe[0];
+            pfd.events = POLLIN;
+            poll(&pfd, 1, 200);
+        }
+    }
+
+    for (i = 0; i < workers; i++) {
+        if (w[i].alive) {
+            close(w[i].taskFd); //worker sees EOF and exits
+        }
+    }
+    for (i = 0; i < workers; i++) {
+        if (w[i].alive) {
+            waitpid(w[i].pid, NULL, 0);
+        }
+    }
+    close(resultPipe[0]);
+    signal(SIGPIPE, oldPipe);
+    return failed ? -1 : 0;
+}
+
+int runnerDefaultWorkers(void) {
+    long n = sysconf(_SC_NPROCESSORS_ONLN);
+    return n > 0 ? (int)n : 1;
+}
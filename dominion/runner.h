@@ -0,0 +1,48 @@
+#ifndef _RUNNER_H
+#define _RUNNER_H
+
+/* Parallel work-unit runner for the campaign drivers.
+
+   The engine keeps its random number generator in globals (rngs.c), so
+   runs are sharded across cores with worker processes rather than
+   threads.  The parent hands out unit numbers, workers compute a fixed
+   size result per unit and the parent collects the results one at a time,
+   so all aggregation and file output happen in the parent, off the
+   workers' path.
+
+   Results are collected in completion order; collect must not depend on
+   that order if runs are to be reproducible.  Workers are forked when
+   runnerRun starts and see ctx as it was then, so everything work needs
+   that changes later has to be encoded in the unit number.  A unit whose
+   worker dies is handed to another worker once. */
+
+#define RUNNER_MAX_RESULT 3840
+#define RUNNER_MAX_INFLIGHT 8
+
+struct runner {
+    int workers;        /* worker processes; 0 runs every unit in-process */
+    int inflight;       /* units queued per worker, 1 .. RUNNER_MAX_INFLIGHT */
+    int resultSize;     /* bytes per result, at most RUNNER_MAX_RESULT */
+
+    long (*next)(void *ctx);
+    /* Next unit to run, or -1 if there is none; asked again after every
+       collect, so it may return more units once results come in */
+
+    int (*work)(long unit, void *result, void *ctx);
+    /* Runs in a worker; fills result (zeroed beforehand); -1 fails the run */
+
+    int (*collect)(long unit, void *result, void *ctx);
+    /* Runs in the parent; nonzero stops handing out units (units already
+       queued are still collected) */
+
+    void *ctx;
+};
+
+int runnerRun(struct runner *r);
+/* Run until next has no more units and all results are collected;
+   returns 0, or -1 if a unit failed twice or workers could not start */
+
+int runnerDefaultWorkers(void);
+/* Number of online CPUs */
+
+#endif
@@ -0,0 +1,212 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include "search.h"
+#include "pool.h"
+#include "playout.h"
+#include "rngs.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+static const int searchCards[] = {village, great_hall, council_room, smithy, adventurer};
+#define NUM_SEARCH_CARDS ((int)(sizeof(searchCards) / sizeof(searchCards[0])))
+
+static struct ttable *table;
+static pid_t tableOwner;
+
+struct search {
+    long long nodes;
+};
+
+static long long nowNanoseconds(void) {
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+static int findInHand(struct gameState *state, int card) {
+    int player = whoseTurn(state), i;
+
+    for (i = 0; i < state->handCount[player]; i++) {
+        if (state->hand[player][i] == card)
+            return i;
+    }
+    return -1;
+}
+
+//what a finished action phase is worth: the best card each buy gets,
+//spending the coins greedily
+static int spendValue(struct gameState *state) {
+    static const int worth[] = {0, 0, 0, 15, 15, 25, 40, 40, 100};
+    static const int cost[] = {0, 0, 0, 3, 3, 5, 6, 6, 8};
+    int coins = state->coins, buys, c, value = 0;
+
+    for (buys = state->numBuys; buys > 0 && coins >= 3; buys--) {
+        c = coins > 8 ? 8 : coins;
+        value += worth[c];
+        coins -= cost[c];
+    }
+    return value;
+}
+
+//shuffles during a play come from streams seeded by the position, so
+//the position alone decides where a play leads
+static void seedShuffles(struct gameState *state, unsigned long long key) {
+    long seed = (long)(key % (2147483647ULL - 1)) + 1;
+    int p;
+
+    for (p = 0; state->playerStreams && p < state->numPlayers; p++) {
+        SelectStream(PLAYER_STREAM_BASE + p);
+        PutSeed(seed);
+    }
+    SelectStream(1);
+    PutSeed(seed);
+}
+
+//best value of the rest of the action phase; plays is how many plays
+//led here
+static int searchValue(struct search *s, struct gameState *state, int plays) {
+    unsigned long long key = stateHash(state);
+    struct gameState *child;
+    struct ttEntry entry = {0, 0, -1};
+    int i, pos, value, best;
+    int remaining = SEARCH_MAX_PLAYS - plays;
+
+    s->nodes++;
+    //only a value searched exactly as deep is reused, else it would
+    //depend on which line got here first
+    if (ttProbe(table, key, &entry) && entry.depth == remaining)
+        return entry.value;
+    if (entry.depth != remaining)
+        entry.visits = 0;
+
+    best = spendValue(state);
+    if (state->numActions > 0 && remaining > 0 && (child = poolAcquire()) != NULL) {
+        for (i = 0; i < NUM_SEARCH_CARDS; i++) {
+            if ((pos = findInHand(state, searchCards[i])) == -1)
+                continue;
+            memcpy(child, state, sizeof(struct gameState));
+            seedShuffles(child, key);
+            if (playCard(pos, -1, -1, -1, child) != 0)
+                continue;
+            value = searchValue(s, child, plays + 1);
+            if (value > best)
+                best = value;
+        }
+        poolRelease(child);
+    }
+
+    entry.value = best;
+    entry.visits++;
+    entry.depth = remaining;
+    ttStore(table, key, &entry);
+    return best;
+}
+
+int searchAction(struct gameState *state, int choices[3], void *ctx) {
+    int player = whoseTurn(state);
+    int candidate[NUM_SEARCH_CARDS], total[NUM_SEARCH_CARDS];
+    long saved[1 + MAX_PLAYERS];
+    struct gameState *root, *child;
+    struct playoutRng rng;
+    struct search s = {0};
+    long long start = nowNanoseconds();
+    int i, j, n, t, sample, stop = 0, best = -1;
+
+    (void)ctx;
+    choices[0] = choices[1] = choices[2] = -1;
+    if (state->numActions < 1 || (table == NULL && searchStart() < 0))
+        return -1;
+    for (i = n = 0; i < NUM_SEARCH_CARDS; i++) {
+        if ((candidate[n] = findInHand(state, searchCards[i])) != -1)
+            total[n++] = 0;
+    }
+    if (n == 0)
+        return -1;
+    root = poolAcquire();
+    child = poolAcquire();
+    if (root == NULL || child == NULL) {
+        if (root != NULL)
+            poolRelease(root);
+        return candidate[0];
+    }
+
+    for (i = 0; i < state->numPlayers; i++) {
+        SelectStream(PLAYER_STREAM_BASE + i);
+        GetSeed(&saved[1 + i]);
+    }
+    SelectStream(1);
+    GetSeed(&saved[0]);
+    ttNewGeneration(table);
+
+    //sample deck orders come from the position too
+    playoutSeed(&rng, stateHash(state));
+    for (sample = 0; sample < SEARCH_SAMPLES; sample++) {
+        memcpy(root, state, sizeof(struct gameState));
+        for (i = root->deckCount[player] - 1; i > 0; i--) {
+            j = playoutRandom(&rng, i + 1);
+            t = root->deck[player][i];
+            root->deck[player][i] = root->deck[player][j];
+            root->deck[player][j] = t;
+        }
+        stateHashDeckOrder(root, 1);
+        stop += spendValue(root);
+        for (i = 0; i < n; i++) {
+            memcpy(child, root, sizeof(struct gameState));
+            seedShuffles(child, stateHash(root));
+            if (playCard(candidate[i], -1, -1, -1, child) == 0)
+                total[i] += searchValue(&s, child, 1);
+            else
+                total[i] = -1000000;
+        }
+    }
+
+    for (i = 0; i < state->numPlayers; i++) {
+        SelectStream(PLAYER_STREAM_BASE + i);
+        PutSeed(saved[1 + i]);
+    }
+    SelectStream(1);
+    PutSeed(saved[0]);
+    poolRelease(root);
+    poolRelease(child);
+
+    //the first of the best, so villages win ties
+    for (i = 0; i < n; i++) {
+        if (total[i] >= stop && (best == -1 || total[i] > total[best]))
+            best = i;
+    }
+    ttCount(table, s.nodes, nowNanoseconds() - start);
+    return best == -1 ? -1 : candidate[best];
+}
+
+static void printStats(void) {
+    struct ttStats stats;
+
+    if (table == NULL || getpid() != tableOwner)
+        return;
+    ttGetStats(table, &stats);
+    if (stats.nodes == 0)
+        return;
+    fprintf(stderr, "lookahead: %lld nodes, %.0f nodes/s, hit rate %.1f%% of %lld probes, %lld stores, %lld replaced\n",
+            stats.nodes, stats.nanoseconds > 0 ? stats.nodes * 1e9 / stats.nanoseconds : 0.0,
+            stats.probes > 0 ? 100.0 * stats.hits / stats.probes : 0.0, stats.probes,
+            stats.stores, stats.replaced);
+}
+
+int searchStart(void) {
+    if (table != NULL)
+        return 0;
+    table = ttNew(SEARCH_TABLE_BITS);
+    if (table == NULL)
+        return -1;
+    tableOwner = getpid();
+    atexit(printStats);
+    return 0;
+}
+
+struct ttable* searchTable(void) {
+    return table;
+}
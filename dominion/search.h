@@ -0,0 +1,37 @@
+#ifndef _SEARCH_H
+#define _SEARCH_H
+
+#include "dominion.h"
+#include "ttable.h"
+
+/* Lookahead over the action phase, for the "lookahead" bot (see sim.h).
+
+   Before each play the bot deals its unseen deck a few sample orders and
+   for each searches every order of the choice-free actions in hand
+   (village, great hall, council room, smithy, adventurer) through the
+   engine, valuing where each line ends by what its coins and buys can
+   get.  Different orders that reach the same position (village then
+   smithy, smithy then village) are searched once: positions are looked
+   up by stateHash in a transposition table (ttable.h) shared by every
+   process forked after searchStart.
+
+   A position's value depends on nothing but the position, shuffles
+   inside the search included, so results are the same whatever the
+   table held before.  rngs.c is left as it was found. */
+
+#define SEARCH_SAMPLES 4        /* deck orders per decision */
+#define SEARCH_MAX_PLAYS 8      /* plays per line */
+#define SEARCH_TABLE_BITS 16    /* 2^16 buckets, 4 MB */
+
+int searchStart(void);
+/* Create the shared table if there is none yet; 0, or -1 if out of
+   memory.  The process that creates it prints the table's counters to
+   stderr at exit */
+
+int searchAction(struct gameState *state, int choices[3], void *ctx);
+/* The bot's action function */
+
+struct ttable* searchTable(void);
+/* The shared table, NULL before searchStart */
+
+#endif
@@ -0,0 +1,298 @@
+#include "sequence.h"
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define SEQ_CACHE 8         /* sequencers the bot keeps */
+#define SEQ_BOT_BUY_WORTH 2.0
+#define MAX_DRAW 4          /* most cards one play draws */
+#define MAX_OUTCOMES 126    /* ways 4 draws fall into SEQ_KINDS + 1 kinds */
+
+const int seqCards[SEQ_KINDS] = {village, great_hall, smithy, council_room, adventurer};
+
+//what each of seqCards does, by the card texts
+static const int plusActions[SEQ_KINDS] = {2, 1, 0, 0, 0};
+static const int plusCards[SEQ_KINDS] = {1, 1, 3, 4, 0};
+static const int plusBuys[SEQ_KINDS] = {0, 0, 0, 1, 0};
+
+//positions pack into a key: three bits of each held count, then actions
+//left and draws left, four bits each
+#define HELD_SHIFT(k) (3 * (k))
+#define HELD(key, k) ((int)((key) >> HELD_SHIFT(k) & 7))
+#define HELD_MASK ((1u << 3 * SEQ_KINDS) - 1)
+#define ACTIONS_SHIFT (3 * SEQ_KINDS)
+#define DRAWS_SHIFT (ACTIONS_SHIFT + 4)
+
+//three bit fields never carry into each other when a held count of at
+//most SEQ_MAX_HELD gets at most MAX_DRAW more; fields that went past
+//SEQ_MAX_HELD are set back to it
+#define FIELD_HIGH 044444u
+#define SATURATE(h) (((h) & ~(((h) & FIELD_HIGH) * 7 / 4)) | ((h) & FIELD_HIGH) * 3 / 4)
+
+struct outcome {
+    double p;
+    unsigned int drawn;     //held counts to add, packed like a key
+};
+
+struct memo {
+    unsigned int key;   //key + 1; 0 for a free slot
+    int card;
+    float coins;
+    float buys;
+};
+
+struct sequencer {
+    struct drawOdds odds;
+    double buyWorth;
+    double coinsPerDraw;
+    double adventurerCoins;
+    int outcomes[MAX_DRAW + 1];
+    struct outcome outcome[MAX_DRAW + 1][MAX_OUTCOMES];
+    struct memo *memo;
+    size_t mask;
+    long long count;
+};
+
+static double choose(int n, int k) {
+    double c = 1;
+    int i;
+
+    for (i = 1; i <= k; i++)
+        c = c * (n - k + i) / i;
+    return c;
+}
+
+//every way draws can fall among the kinds, with its probability; kinds
+//past the last are cards the model does not play
+static void enumerate(struct sequencer *s, int draws, int kind, int left,
+                      unsigned char drawn[SEQ_KINDS], double p) {
+    double q;
+    int n;
+
+    if (kind == SEQ_KINDS) {
+        q = 1;
+        for (n = 0; n < SEQ_KINDS; n++)
+            q -= (double)s->odds.count[n] / s->odds.cards;
+        p *= left == 0 ? 1 : q <= 0 ? 0 : pow(q, left);
+        if (p > 0) {
+            s->outcome[draws][s->outcomes[draws]].p = p;
+            s->outcome[draws][s->outcomes[draws]].drawn = 0;
+            for (n = 0; n < SEQ_KINDS; n++)
+                s->outcome[draws][s->outcomes[draws]].drawn |= (unsigned)drawn[n] << HELD_SHIFT(n);
+            s->outcomes[draws]++;
+        }
+        return;
+    }
+    for (n = 0; n <= left; n++) {
+        q = (double)s->odds.count[kind] / s->odds.cards;
+        drawn[kind] = (unsigned char)n;
+        if (n == 0 || q > 0)
+            enumerate(s, draws, kind + 1, left - n, drawn, p * choose(left, n) * pow(q, n));
+    }
+    drawn[kind] = 0;
+}
+
+struct sequencer* sequencerNew(const struct drawOdds *odds, double buyWorth) {
+    struct sequencer *s = calloc(1, sizeof(struct sequencer));
+    unsigned char drawn[SEQ_KINDS] = {0};
+    int d;
+
+    if (s == NULL)
+        return NULL;
+    s->odds = *odds;
+    s->buyWorth = buyWorth;
+    s->mask = 1023;
+    s->memo = calloc(s->mask + 1, sizeof(struct memo));
+    if (s->memo == NULL) {
+        free(s);
+        return NULL;
+    }
+    if (odds->cards > 0) {
+        s->coinsPerDraw = (double)odds->coins / odds->cards;
+        for (d = 1; d <= MAX_DRAW; d++)
+            enumerate(s, d, 0, d, drawn, 1);
+    }
+    //adventurer digs up two treasures, if there are any
+    if (odds->treasures > 0)
+        s->adventurerCoins = 2.0 * odds->coins / odds->treasures;
+    return s;
+}
+
+void sequencerFree(struct sequencer *s) {
+    if (s == NULL)
+        return;
+    free(s->memo);
+    free(s);
+}
+
+long long sequencerPositions(struct sequencer *s) {
+    return s->count;
+}
+
+static struct memo* findMemo(struct sequencer *s, unsigned int key) {
+    size_t i;
+
+    for (i = (key * 0x9e3779b1u) & s->mask; ; i = (i + 1) & s->mask) {
+        if (s->memo[i].key == key + 1 || s->memo[i].key == 0)
+            return &s->memo[i];
+    }
+}
+
+static int addMemo(struct sequencer *s, unsigned int key, const struct memo *m) {
+    struct memo *old = s->memo, *slot;
+    size_t i, size = s->mask + 1;
+
+    if ((size_t)s->count + 1 > size / 4 * 3) {
+        s->memo = calloc(size * 2, sizeof(struct memo));
+        if (s->memo == NULL) {
+            s->memo = old;
+            return -1;
+        }
+        s->mask = size * 2 - 1;
+        for (i = 0; i < size; i++) {
+            if (old[i].key != 0)
+                *findMemo(s, old[i].key - 1) = old[i];
+        }
+        free(old);
+    }
+    slot = findMemo(s, key);
+    *slot = *m;
+    slot->key = key + 1;
+    s->count++;
+    return 0;
+}
+
+//the best way on from a position; positions only lead to ones with
+//fewer cards held plus draws left, so this ends
+static int solve(struct sequencer *s, unsigned int key, struct memo *best) {
+    struct memo *found = findMemo(s, key), next;
+    unsigned int base, child, held;
+    int actions = key >> ACTIONS_SHIFT & 15, drawsLeft = key >> DRAWS_SHIFT;
+    int k, i, draws, after;
+    double coins, buys, p;
+
+    if (found->key != 0) {
+        *best = *found;
+        return 0;
+    }
+    best->card = -1;
+    best->coins = best->buys = 0;
+    for (k = 0; actions > 0 && k < SEQ_KINDS; k++) {
+        if (HELD(key, k) == 0)
+            continue;
+        draws = plusCards[k] < drawsLeft ? plusCards[k] : drawsLeft;
+        coins = draws * s->coinsPerDraw + (seqCards[k] == adventurer ? s->adventurerCoins : 0);
+        buys = plusBuys[k];
+        after = actions - 1 + plusActions[k];
+        base = (key - (1u << HELD_SHIFT(k))) & HELD_MASK;
+        base |= (unsigned)(after < SEQ_MAX_ACTIONS ? after : SEQ_MAX_ACTIONS) << ACTIONS_SHIFT;
+        base |= (unsigned)(drawsLeft - draws) << DRAWS_SHIFT;
+        //with no actions left the turn's plays are over
+        for (i = 0; after > 0 && i < (draws > 0 ? s->outcomes[draws] : 1); i++) {
+            child = base;
+            p = 1;
+            if (draws > 0) {
+                p = s->outcome[draws][i].p;
+                held = (base & HELD_MASK) + s->outcome[draws][i].drawn;
+                child = (base & ~HELD_MASK) | SATURATE(held);
+            }
+            if (solve(s, child, &next) < 0)
+                return -1;
+            coins += p * next.coins;
+            buys += p * next.buys;
+        }
+        if (coins + s->buyWorth * buys > best->coins + s->buyWorth * best->buys + 1e-9) {
+            best->card = seqCards[k];
+            best->coins = coins;
+            best->buys = buys;
+        }
+    }
+    return addMemo(s, key, best);
+}
+
+int sequencerPlan(struct sequencer *s, const int held[SEQ_KINDS], int actions,
+                  int drawsLeft, struct seqPlan *plan) {
+    unsigned int key = 0;
+    struct memo m;
+    int k;
+
+    for (k = 0; k < SEQ_KINDS; k++)
+        key |= (unsigned)(held[k] < SEQ_MAX_HELD ? held[k] : SEQ_MAX_HELD) << HELD_SHIFT(k);
+    if (actions < 0)
+        actions = 0;
+    if (drawsLeft < 0)
+        drawsLeft = 0;
+    key |= (unsigned)(actions < SEQ_MAX_ACTIONS ? actions : SEQ_MAX_ACTIONS) << ACTIONS_SHIFT;
+    key |= (unsigned)(drawsLeft < SEQ_MAX_DRAWS ? drawsLeft : SEQ_MAX_DRAWS) << DRAWS_SHIFT;
+    if (solve(s, key, &m) < 0)
+        return -1;
+    plan->card = m.card;
+    plan->coins = m.coins;
+    plan->buys = m.buys;
+    return 0;
+}
+
+void drawOddsOwned(struct gameState *state, int player, struct drawOdds *odds) {
+    int k;
+
+    memset(odds, 0, sizeof(struct drawOdds));
+    odds->cards = state->handCount[player] + state->deckCount[player] + state->discardCount[player];
+    for (k = 0; k < SEQ_KINDS; k++)
+        odds->count[k] = fullDeckCount(player, seqCards[k], state);
+    odds->treasures = fullDeckCount(player, copper, state) + fullDeckCount(player, silver, state) +
+                      fullDeckCount(player, gold, state);
+    odds->coins = fullDeckCount(player, copper, state) + 2 * fullDeckCount(player, silver, state) +
+                  3 * fullDeckCount(player, gold, state);
+}
+
+//sequencers for the deck compositions seen last, replaced in turn
+static struct sequencer *cache[SEQ_CACHE];
+static int nextVictim;
+
+static struct sequencer* cachedSequencer(const struct drawOdds *odds) {
+    int i;
+
+    for (i = 0; i < SEQ_CACHE; i++) {
+        if (cache[i] != NULL && memcmp(&cache[i]->odds, odds, sizeof(struct drawOdds)) == 0)
+            return cache[i];
+    }
+    sequencerFree(cache[nextVictim]);
+    cache[nextVictim] = sequencerNew(odds, SEQ_BOT_BUY_WORTH);
+    i = nextVictim;
+    nextVictim = (nextVictim + 1) % SEQ_CACHE;
+    return cache[i];
+}
+
+int sequenceAction(struct gameState *state, int choices[3], void *ctx) {
+    int player = whoseTurn(state);
+    int held[SEQ_KINDS] = {0};
+    struct drawOdds odds;
+    struct sequencer *s;
+    struct seqPlan plan;
+    int i, k, any = 0;
+
+    (void)ctx;
+    choices[0] = choices[1] = choices[2] = -1;
+    if (state->numActions < 1)
+        return -1;
+    for (i = 0; i < state->handCount[player]; i++) {
+        for (k = 0; k < SEQ_KINDS; k++) {
+            if (state->hand[player][i] == seqCards[k]) {
+                held[k]++;
+                any = 1;
+            }
+        }
+    }
+    if (!any)
+        return -1;
+    drawOddsOwned(state, player, &odds);
+    s = cachedSequencer(&odds);
+    if (s == NULL || sequencerPlan(s, held, state->numActions,
+                                   state->deckCount[player] + state->discardCount[player], &plan) < 0)
+        return -1;
+    for (i = 0; plan.card != -1 && i < state->handCount[player]; i++) {
+        if (state->hand[player][i] == plan.card)
+            return i;
+    }
+    return -1;
+}
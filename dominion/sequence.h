@@ -0,0 +1,63 @@
+#ifndef _SEQUENCE_H
+#define _SEQUENCE_H
+
+#include "dominion.h"
+
+/* Action phase sequencing.
+
+   A sequencer finds the order to play the choice-free actions in a hand
+   (village, great hall, smithy, council room, adventurer) that gets the
+   most expected coins and buys out of the turn.  Draws are modelled as
+   independent, each card coming up with the odds it has in the player's
+   cards, up to the number of cards left to draw.  Every position it
+   works out, keyed by the actions in hand, actions left and draws left,
+   is kept, so after the first query of a turn the positions the turn can
+   reach are answered from memory.
+
+   The "sequence" bot (sim.h) keeps sequencers for the last few deck
+   compositions it has seen and asks one before every play. */
+
+#define SEQ_KINDS 5         /* action cards the model plays */
+#define SEQ_MAX_HELD 3      /* of one kind in hand; more are not counted */
+#define SEQ_MAX_ACTIONS 7   /* actions left beyond this are not counted */
+#define SEQ_MAX_DRAWS 10    /* draws left beyond this are not counted */
+
+extern const int seqCards[SEQ_KINDS];
+/* The cards, in the order ties are broken */
+
+struct drawOdds {
+    int cards;              //cards draws come from
+    int count[SEQ_KINDS];   //of each of seqCards among them
+    int treasures;          //copper, silver and gold among them
+    int coins;              //what those treasures are worth together
+};
+
+void drawOddsOwned(struct gameState *state, int player, struct drawOdds *odds);
+/* Odds from all the cards the player has outside play */
+
+struct seqPlan {
+    int card;       //card to play next, -1 to stop
+    double coins;   //expected coins from here on, played this way
+    double buys;    //expected extra buys
+};
+
+struct sequencer;
+
+struct sequencer* sequencerNew(const struct drawOdds *odds, double buyWorth);
+/* Sequencer for these odds, valuing a buy at buyWorth coins; NULL if out
+   of memory */
+
+void sequencerFree(struct sequencer *s);
+
+int sequencerPlan(struct sequencer *s, const int held[SEQ_KINDS], int actions,
+                  int drawsLeft, struct seqPlan *plan);
+/* Best play with held[k] of seqCards[k] in hand; 0, or -1 if out of
+   memory */
+
+long long sequencerPositions(struct sequencer *s);
+/* Positions worked out and kept so far */
+
+int sequenceAction(struct gameState *state, int choices[3], void *ctx);
+/* The bot's action function */
+
+#endif
@@ -0,0 +1,238 @@
+#include "sim.h"
+#include "pool.h"
+#include "rules.h"
+#include "plugin.h"
+#include "ipcbot.h"
+#include "search.h"
+#include "sequence.h"
+#include <stdlib.h>
+#include <string.h>
+
+static int findInHand(struct gameState *state, int card) {
+    int i;
+    for (i = 0; i < numHandCards(state); i++) {
+        if (handCard(i, state) == card)
+            return i;
+    }
+    return -1;
+}
+
+static int owned(struct gameState *state, int card) {
+    return fullDeckCount(whoseTurn(state), card, state);
+}
+
+static int available(struct gameState *state, int card) {
+    return supplyCount(card, state) > 0;
+}
+
+//Big Money: treasure and victory cards only, greening as provinces run out
+static int bigMoneyBuy(struct gameState *state, void *ctx) {
+    int coins = state->coins;
+    int provinces = supplyCount(province, state);
+
+    (void)ctx;
+    if (coins >= 8 && available(state, province))
+        return province;
+    if (coins >= 6 && provinces <= 2 && available(state, duchy))
+        return duchy;
+    if (coins >= 6 && available(state, gold))
+        return gold;
+    if (coins >= 5 && provinces <= 4 && available(state, duchy))
+        return duchy;
+    if (coins >= 3 && available(state, silver))
+        return silver;
+    if (coins >= 2 && provinces <= 2 && available(state, estate))
+        return estate;
+    return -1;
+}
+
+static int noAction(struct gameState *state, int choices[3], void *ctx) {
+    (void)state;
+    (void)choices;
+    (void)ctx;
+    return -1;
+}
+
+//plays villages before terminal actions
+static int playFirst(struct gameState *state, int choices[3], void *ctx) {
+    static const int order[] = {village, great_hall, council_room, smithy, adventurer};
+    int i, pos;
+
+    (void)ctx;
+    choices[0] = choices[1] = choices[2] = -1;
+    for (i = 0; i < (int)(sizeof(order) / sizeof(order[0])); i++) {
+        pos = findInHand(state, order[i]);
+        if (pos != -1)
+            return pos;
+    }
+    return -1;
+}
+
+static int smithyBuy(struct gameState *state, void *ctx) {
+    int coins = state->coins;
+
+    if (coins >= 4 && coins < 6 && owned(state, smithy) < 2 && available(state, smithy))
+        return smithy;
+    return bigMoneyBuy(state, ctx);
+}
+
+static int councilBuy(struct gameState *state, void *ctx) {
+    int coins = state->coins;
+
+    if (coins == 5 && owned(state, council_room) < 2 && available(state, council_room))
+        return council_room;
+    return bigMoneyBuy(state, ctx);
+}
+
+static int adventurerBuy(struct gameState *state, void *ctx) {
+    int coins = state->coins;
+
+    if (coins >= 6 && coins < 8 && owned(state, adventurer) < 2 && available(state, adventurer))
+        return adventurer;
+    return bigMoneyBuy(state, ctx);
+}
+
+static int villageSmithyBuy(struct gameState *state, void *ctx) {
+    int coins = state->coins;
+    int smithies = owned(state, smithy);
+    int villages = owned(state, village);
+
+    if (coins >= 4 && coins < 6 && smithies <= villages && smithies < 4 && available(state, smithy))
+        return smithy;
+    if (coins >= 3 && coins < 6 && villages < smithies && available(state, village))
+        return village;
+    return bigMoneyBuy(state, ctx);
+}
+
+static struct simBot builtinBots[] = {
+    {"bigmoney", noAction, bigMoneyBuy, NULL, NULL},
+    {"smithy", playFirst, smithyBuy, NULL, NULL},
+    {"council", playFirst, councilBuy, NULL, NULL},
+    {"adventurer", playFirst, adventurerBuy, NULL, NULL},
+    {"village", playFirst, villageSmithyBuy, NULL, NULL},
+    {"lookahead", searchAction, villageSmithyBuy, NULL, NULL},
+    {"sequence", sequenceAction, villageSmithyBuy, NULL, NULL},
+};
+
+#define NUM_BUILTIN_BOTS ((int)(sizeof(builtinBots) / sizeof(builtinBots[0])))
+
+//rule bots loaded so far, so a file named twice gives the same bot
+struct loadedBot {
+    char path[256];
+    struct ruleBot rules;
+    struct simBot bot;
+    char definition[RULE_TEXT_MAX];
+    struct loadedBot *next;
+};
+
+static struct loadedBot *loadedBots;
+
+static struct simBot* loadRuleBot(const char *path) {
+    struct loadedBot *l;
+
+    for (l = loadedBots; l != NULL; l = l->next) {
+        if (strcmp(l->path, path) == 0)
+            return &l->bot;
+    }
+    l = calloc(1, sizeof(struct loadedBot));
+    if (l == NULL || ruleBotLoad(path, &l->rules) < 0) {
+        free(l);
+        return NULL;
+    }
+    snprintf(l->path, sizeof(l->path), "%s", path);
+    ruleBotSimBot(&l->rules, &l->bot);
+    ruleBotFormat(&l->rules, l->definition, sizeof(l->definition));
+    l->bot.definition = l->definition;
+    l->next = loadedBots;
+    loadedBots = l;
+    return &l->bot;
+}
+
+struct simBot* simFindBot(const char *name) {
+    size_t len = strlen(name);
+    int i;
+
+    for (i = 0; i < NUM_BUILTIN_BOTS; i++) {
+        if (strcmp(builtinBots[i].name, name) != 0)
+            continue;
+        //the search table is made now, so workers forked later share it
+        if (builtinBots[i].action == searchAction && searchStart() < 0)
+            return NULL;
+        return &builtinBots[i];
+    }
+    if (strncmp(name, "ipc:", 4) == 0 || strncmp(name, "pipe:", 5) == 0)
+        return ipcBotFind(name);
+    if (len > 6 && strcmp(name + len - 6, ".rules") == 0)
+        return loadRuleBot(name);
+    if (len > 3 && strcmp(name + len - 3, ".so") == 0)
+        return pluginLoad(name);
+    return NULL;
+}
+
+const char* simBotNames(void) {
+    return "bigmoney smithy council adventurer village lookahead sequence <file>.rules <plugin>.so ipc:<command>";
+}
+
+int simSeed(int baseSeed, long unit, int game) {
+    unsigned long long x = (unsigned long long)baseSeed * 0x9E3779B97F4A7C15ULL;
+
+    //splitmix64 finalizer over (seed, unit, game)
+    x ^= (unsigned long long)unit * 0xBF58476D1CE4E5B9ULL + (unsigned long long)game;
+    x ^= x >> 30;
+    x *= 0xBF58476D1CE4E5B9ULL;
+    x ^= x >> 27;
+    x *= 0x94D049BB133111EBULL;
+    x ^= x >> 31;
+    return (int)(x % 2147483646ULL) + 1;
+}
+
+void simPlayTurn(struct gameState *state, struct simBot *bot) {
+    int choices[3];
+    int pos, card, plays = 0;
+
+    while (state->numActions > 0 && plays < MAX_HAND) {
+        pos = bot->action(state, choices, bot->ctx);
+        if (pos < 0 || playCard(pos, choices[0], choices[1], choices[2], state) < 0)
+            break;
+        plays++;
+    }
+
+    while (state->numBuys > 0) {
+        card = bot->buy(state, bot->ctx);
+        if (card < 0 || buyCard(card, state) < 0)
+            break;
+    }
+
+    endTurn(state);
+}
+
+int simPlayGame(struct gameTemplate *tmpl, int seed, struct simBot *bots[],
+                struct simResult *result) {
+    struct gameState *state = poolAcquire();
+    int p, turn;
+
+    //scoreFor reads deck entries past deckCount, so a reused state must not
+    //carry the previous game's cards or results would depend on the order
+    //games were played in
+    if (state != NULL) {
+        memset(state, 0, sizeof(struct gameState));
+    }
+    if (state == NULL || initializeGameFromTemplate(tmpl, seed, state) < 0) {
+        poolRelease(state);
+        return -1;
+    }
+
+    for (turn = 0; turn < SIM_MAX_TURNS * tmpl->numPlayers && !isGameOver(state); turn++) {
+        simPlayTurn(state, bots[whoseTurn(state)]);
+    }
+
+    result->numPlayers = tmpl->numPlayers;
+    result->turns = turn;
+    for (p = 0; p < MAX_PLAYERS; p++) {
+        result->score[p] = p < tmpl->numPlayers ? scoreFor(p, state) : 0;
+    }
+    getWinners(result->winner, state);
+
+    poolRelease(state);
+    return 0;
+}
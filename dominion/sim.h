@@ -0,0 +1,56 @@
+#ifndef _SIM_H
+#define _SIM_H
+
+#include "dominion.h"
+
+/* Silent bot-vs-bot game simulation for the campaign drivers. */
+
+#define SIM_MAX_TURNS 100 /* per player; longer games are cut off */
+
+struct simBot {
+    const char *name;
+
+    int (*action)(struct gameState *state, int choices[3], void *ctx);
+    /* Hand position of the action card to play next (and its choices),
+       or -1 to end the action phase */
+
+    int (*buy)(struct gameState *state, void *ctx);
+    /* Supply position to buy next, or -1 to end the buy phase */
+
+    void *ctx;
+
+    const char *definition;
+    /* Text that fully defines a bot read from a file, for result cache
+       keys; NULL for built-in bots, whose code is part of the engine hash */
+};
+/* Bots must not change the state they are shown */
+
+struct simResult {
+    int numPlayers;
+    int turns;                  //turns taken by all players together
+    int score[MAX_PLAYERS];
+    int winner[MAX_PLAYERS];    //1 for every winner, as getWinners
+};
+
+int simPlayGame(struct gameTemplate *tmpl, int seed, struct simBot *bots[],
+                struct simResult *result);
+/* Play one game from the template with bots[p] in seat p; -1 if the game
+   could not be set up */
+
+void simPlayTurn(struct gameState *state, struct simBot *bot);
+/* Let bot play the current player's whole turn, ending it */
+
+struct simBot* simFindBot(const char *name);
+/* Built-in bot by name, the rule bot (see rules.h) in the file name
+   when it ends in .rules, the plugin (see botplugin.h) when it ends in
+   .so, or a bot process (see ipcbot.h) for ipc:<command>; NULL if there
+   is none or the file or process is bad */
+
+const char* simBotNames(void);
+/* Space separated names of the built-in bots */
+
+int simSeed(int baseSeed, long unit, int game);
+/* Game seed derived from a campaign seed, work unit and game number;
+   always a valid initializeGame seed */
+
+#endif
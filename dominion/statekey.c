@@ -0,0 +1,274 @@
+#include "statekey.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define NUM_CARDS (treasure_map + 1)
+#define KEY_BLOCK (1 << 20)
+
+//unsigned numbers take 7 bits a byte, counters are zigzagged first so
+//small negative ones stay short
+static unsigned char* putNumber(unsigned char *p, unsigned int n) {
+    while (n >= 0x80) {
+        *p++ = (unsigned char)(n | 0x80);
+        n >>= 7;
+    }
+    *p++ = (unsigned char)n;
+    return p;
+}
+
+static unsigned char* putCounter(unsigned char *p, int n) {
+    return putNumber(p, ((unsigned int)n << 1) ^ (unsigned int)(n >> 31));
+}
+
+//the number of distinct cards, then each card with how many there are;
+//only the cards present are visited.  Some card effects leave -1 in a
+//pile, which is kept as a card of its own, NUM_CARDS
+static unsigned char* putPile(unsigned char *p, int *cards, int count) {
+    int histogram[NUM_CARDS + 1];
+    unsigned int present = 0;
+    int i, c;
+
+    for (i = 0; i < count; i++) {
+        c = cards[i] == -1 ? NUM_CARDS : cards[i];
+        if ((unsigned)c > NUM_CARDS)
+            return NULL;
+        if (!(present & 1u << c)) {
+            present |= 1u << c;
+            histogram[c] = 0;
+        }
+        histogram[c]++;
+    }
+    *p++ = (unsigned char)__builtin_popcount(present);
+    while (present != 0) {
+        c = __builtin_ctz(present);
+        present &= present - 1;
+        *p++ = (unsigned char)c;
+        if (histogram[c] < 0x80)
+            *p++ = (unsigned char)histogram[c];
+        else
+            p = putNumber(p, histogram[c]);
+    }
+    return p;
+}
+
+static unsigned char* putOrderedPile(unsigned char *p, int *cards, int count) {
+    int i;
+
+    p = putNumber(p, count);
+    for (i = 0; i < count; i++) {
+        if (cards[i] < -1 || cards[i] >= NUM_CARDS)
+            return NULL;
+        *p++ = (unsigned char)(cards[i] == -1 ? NUM_CARDS : cards[i]);
+    }
+    return p;
+}
+
+int stateKey(struct gameState *state, unsigned char key[STATE_KEY_MAX]) {
+    unsigned char *p = key, *embargoed;
+    int player, c;
+
+    if (state->numPlayers < 1 || state->numPlayers > MAX_PLAYERS)
+        return -1;
+    for (player = 0; player < state->numPlayers; player++) {
+        if (state->handCount[player] < 0 || state->handCount[player] > MAX_HAND ||
+                state->deckCount[player] < 0 || state->deckCount[player] > MAX_DECK ||
+                state->discardCount[player] < 0 || state->discardCount[player] > MAX_DECK)
+            return -1;
+    }
+    if (state->playedCardCount < 0 || state->playedCardCount > MAX_DECK ||
+            state->trashedCardCount < 0 || state->trashedCardCount > MAX_DECK)
+        return -1;
+
+    *p++ = (unsigned char)(state->numPlayers | state->hashDeckOrder << 4);
+    p = putCounter(p, state->whoseTurn);
+    p = putCounter(p, state->phase);
+    p = putCounter(p, state->numActions);
+    p = putCounter(p, state->numBuys);
+    p = putCounter(p, state->coins);
+    p = putCounter(p, state->outpostPlayed);
+    //supply counts are small, so they are one byte each in practice
+    for (c = 0; c < NUM_CARDS; c++) {
+        if (state->supplyCount[c] >= -1 && state->supplyCount[c] < 0x7e)
+            *p++ = (unsigned char)(state->supplyCount[c] + 1);
+        else {
+            *p++ = 0x7f;
+            p = putCounter(p, state->supplyCount[c]);
+        }
+    }
+    //embargo tokens as piles are: how many cards have some, then each
+    embargoed = p++;
+    *embargoed = 0;
+    for (c = 0; c < NUM_CARDS; c++) {
+        if (state->embargoTokens[c] != 0) {
+            *p++ = (unsigned char)c;
+            p = putCounter(p, state->embargoTokens[c]);
+            (*embargoed)++;
+        }
+    }
+
+    for (player = 0; p != NULL && player < state->numPlayers; player++) {
+        p = putPile(p, state->hand[player], state->handCount[player]);
+        if (p == NULL)
+            break;
+        if (state->hashDeckOrder)
+            p = putOrderedPile(p, state->deck[player], state->deckCount[player]);
+        else
+            p = putPile(p, state->deck[player], state->deckCount[player]);
+        if (p == NULL)
+            break;
+        p = putPile(p, state->discard[player], state->discardCount[player]);
+    }
+    if (p != NULL)
+        p = putPile(p, state->playedCards, state->playedCardCount);
+    if (p != NULL)
+        p = putPile(p, state->trash, state->trashedCardCount);
+    return p == NULL ? -1 : (int)(p - key);
+}
+
+struct keySlot {
+    const unsigned char *key;   //NULL for a free slot
+    unsigned int hash;
+    unsigned int length;
+};
+
+struct keyBlock {
+    struct keyBlock *next;
+    size_t used;
+    unsigned char bytes[KEY_BLOCK];
+};
+
+struct keySet {
+    struct keySlot *slots;
+    size_t mask;
+    long long count;
+    struct keyBlock *blocks;
+    size_t blockCount;
+};
+
+//eight bytes at a time, multiply and fold
+static unsigned long long hashKey(const unsigned char *key, int length) {
+    unsigned long long h = 0x9e3779b97f4a7c15ULL ^ (unsigned long long)length;
+    unsigned long long w;
+    int i;
+
+    for (i = 0; i + 8 <= length; i += 8) {
+        memcpy(&w, key + i, 8);
+        h = (h ^ w) * 0xff51afd7ed558ccdULL;
+        h ^= h >> 32;
+    }
+    if (i < length) {
+        w = 0;
+        memcpy(&w, key + i, length - i);
+        h = (h ^ w) * 0xff51afd7ed558ccdULL;
+    }
+    h ^= h >> 33;
+    h *= 0xc4ceb9fe1a85ec53ULL;
+    return h ^ (h >> 33);
+}
+
+static int growSlots(struct keySet *set, size_t size) {
+    struct keySlot *slots = calloc(size, sizeof(struct keySlot));
+    size_t i, j;
+
+    if (slots == NULL)
+        return -1;
+    for (i = 0; set->slots != NULL && i <= set->mask; i++) {
+        if (set->slots[i].key == NULL)
+            continue;
+        for (j = set->slots[i].hash & (size - 1); slots[j].key != NULL; j = (j + 1) & (size - 1));
+        slots[j] = set->slots[i];
+    }
+    free(set->slots);
+    set->slots = slots;
+    set->mask = size - 1;
+    return 0;
+}
+
+struct keySet* keySetNew(long long expected) {
+    struct keySet *set = calloc(1, sizeof(struct keySet));
+    size_t size = 1024;
+
+    while (size / 4 * 3 < (size_t)(expected > 0 ? expected : 0))
+        size *= 2;
+    if (set == NULL || growSlots(set, size) < 0) {
+        free(set);
+        return NULL;
+    }
+    return set;
+}
+
+void keySetFree(struct keySet *set) {
+    struct keyBlock *b, *next;
+
+    if (set == NULL)
+        return;
+    for (b = set->blocks; b != NULL; b = next) {
+        next = b->next;
+        free(b);
+    }
+    free(set->slots);
+    free(set);
+}
+
+//the slot holding the key, or the free slot where it would go
+static struct keySlot* findSlot(struct keySet *set, const unsigned char *key, int length,
+                                unsigned int hash) {
+    struct keySlot *s;
+    size_t i;
+
+    for (i = hash & set->mask; ; i = (i + 1) & set->mask) {
+        s = &set->slots[i];
+        if (s->key == NULL ||
+                (s->hash == hash && s->length == (unsigned)length && memcmp(s->key, key, length) == 0))
+            return s;
+    }
+}
+
+int keySetContains(struct keySet *set, const unsigned char *key, int length) {
+    return findSlot(set, key, length, (unsigned int)hashKey(key, length))->key != NULL;
+}
+
+int keySetAdd(struct keySet *set, const unsigned char *key, int length) {
+    unsigned int hash = (unsigned int)hashKey(key, length);
+    struct keySlot *s = findSlot(set, key, length, hash);
+    struct keyBlock *b = set->blocks;
+    unsigned char *copy;
+
+    if (s->key != NULL)
+        return 0;
+    if (length < 0 || length > STATE_KEY_MAX)
+        return -1;
+    if ((size_t)set->count + 1 > (set->mask + 1) / 4 * 3) {
+        if (growSlots(set, (set->mask + 1) * 2) < 0)
+            return -1;
+        s = findSlot(set, key, length, hash);
+    }
+
+    if (b == NULL || b->used + length > KEY_BLOCK) {
+        b = malloc(sizeof(struct keyBlock));
+        if (b == NULL)
+            return -1;
+        b->next = set->blocks;
+        b->used = 0;
+        set->blocks = b;
+        set->blockCount++;
+    }
+    copy = b->bytes + b->used;
+    memcpy(copy, key, length);
+    b->used += length;
+
+    s->key = copy;
+    s->hash = hash;
+    s->length = length;
+    set->count++;
+    return 1;
+}
+
+long long keySetCount(struct keySet *set) {
+    return set->count;
+}
+
+size_t keySetBytes(struct keySet *set) {
+    return sizeof(struct keySet) + (set->mask + 1) * sizeof(struct keySlot) +
+           set->blockCount * sizeof(struct keyBlock);
+}
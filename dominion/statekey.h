@@ -0,0 +1,44 @@
+#ifndef _STATEKEY_H
+#define _STATEKEY_H
+
+#include "dominion.h"
+#include <stddef.h>
+
+/* Canonical state keys and a set to keep them in.
+
+   stateKey writes a position as a few dozen bytes: the turn counters,
+   the supply and embargo counts, and for every pile how many of each
+   card it holds.  States that differ only in the order of hands and
+   discard piles, or of decks unless hashDeckOrder is set, get the same
+   key, so it tells positions apart exactly as stateHash does, without
+   collisions, at a few hundred times less memory than a gameState. */
+
+#define STATE_KEY_MAX 4096 /* room for any key, ordered decks included */
+
+int stateKey(struct gameState *state, unsigned char key[STATE_KEY_MAX]);
+/* Returns the key's length, or -1 if a pile holds something that is
+   neither a card nor the -1 some card effects leave behind */
+
+struct keySet;
+/* Open addressing table of keys; the keys themselves are packed one
+   after another in large blocks, so each costs its length and a 16 byte
+   slot */
+
+struct keySet* keySetNew(long long expected);
+/* Empty set sized for about expected keys (it grows past that); NULL if
+   out of memory */
+
+void keySetFree(struct keySet *set);
+
+int keySetAdd(struct keySet *set, const unsigned char *key, int length);
+/* 1 if the key was added, 0 if it was already there, -1 if out of
+   memory */
+
+int keySetContains(struct keySet *set, const unsigned char *key, int length);
+
+long long keySetCount(struct keySet *set);
+
+size_t keySetBytes(struct keySet *set);
+/* Memory held by the set */
+
+#endif
@@ -0,0 +1,399 @@
+/* Exhaustive kingdom sweep.
+
+   Plays a number of games of the given bots on every kingdom (or a range
+   of kingdom indexes, see kingdom.h), seats rotating from game to game,
+   sharded across worker processes.  One line per kingdom is streamed to
+   the output file:
+
+     index k1 .. k10 games wins(per bot) ties avgscore(per bot) avgturns
+
+   Progress (kingdoms done, running totals and how much of the output
+   file they cover) is checkpointed to <out>.ckpt every -interval seconds
+   and at the end, each time after the output file is synced.  Restarting with the same arguments resumes from the
+   checkpoint: the output is cut back to what the checkpoint covers and
+   only the remaining kingdoms are played, so the final file holds the
+   same lines, and the totals are the same, as for an uninterrupted run.
+   Lines are written in the order kingdoms finish, which depends on the
+   workers' timing either way; sort on the index to compare two files.
+
+   With -cache, kingdoms whose result is already in the result cache (see
+   cache.h) are written from it instead of being played again.
+
+   Usage: sweep [-bots a,b[,c,d]] [-games n] [-seed n] [-workers n]
+                [-first index] [-count n] [-out file] [-interval secs]
+                [-cache file] */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include "dominion.h"
+#include "cache.h"
+#include "checkpoint.h"
+#include "kingdom.h"
+#include "runner.h"
+#include "sim.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+struct sweepResult {
+    int games;
+    int wins[MAX_PLAYERS];
+    int ties;
+    long scoreSum[MAX_PLAYERS];
+    long turns;
+};
+
+//everything a resumed run needs; followed by the done bitmap
+struct sweepProgress {
+    char header[256];   //identifies the run, see formatHeader
+    long outputSize;    //bytes of output written for the done kingdoms
+    long completed;
+    long wins[MAX_PLAYERS];
+    long ties;
+    long games;
+};
+
+struct sweep {
+    struct simBot *bots[MAX_PLAYERS];
+    char botList[128];
+    int numPlayers;
+    int games;
+    int seed;
+    long first;
+    long count;
+    long cursor;
+    struct sweepProgress *progress;
+    unsigned char *done; //bitmap over [first, first + count), after progress
+    size_t progressSize;
+    long playedThisRun;
+    FILE *out;
+    struct checkpointWriter *checkpoint;
+    struct resultCache *cache;
+    long fromCache;
+    time_t started;
+    time_t reported;
+};
+
+static int isDone(struct sweep *s, long unit) {
+    long i = unit - s->first;
+    return (s->done[i / 8] >> (i % 8)) & 1;
+}
+
+static void markDone(struct sweep *s, long unit) {
+    long i = unit - s->first;
+    s->done[i / 8] |= 1 << (i % 8);
+}
+
+static int playKingdom(long unit, void *out, void *ctx) {
+    struct sweep *s = ctx;
+    struct sweepResult *r = out;
+    struct gameTemplate tmpl;
+    struct simBot *seats[MAX_PLAYERS];
+    struct simResult game;
+    int k[10];
+    int g, p, bot, winners;
+
+    if (kingdomFromIndex(unit, k) < 0 ||
+            initializeGameTemplate(s->numPlayers, k, &tmpl) < 0) {
+        return -1;
+    }
+
+    for (g = 0; g < s->games; g++) {
+        //seat p is taken by bot (p + g) % numPlayers
+        for (p = 0; p < s->numPlayers; p++) {
+            seats[p] = s->bots[(p + g) % s->numPlayers];
+        }
+        if (simPlayGame(&tmpl, simSeed(s->seed, unit, g), seats, &game) < 0) {
+            return -1;
+        }
+
+        winners = 0;
+        for (p = 0; p < s->numPlayers; p++) {
+            winners += game.winner[p];
+        }
+        for (p = 0; p < s->numPlayers; p++) {
+            bot = (p + g) % s->numPlayers;
+            r->scoreSum[bot] += game.score[p];
+            if (game.winner[p] && winners == 1) {
+                r->wins[bot]++;
+            }
+        }
+        if (winners > 1) {
+            r->ties++;
+        }
+        r->turns += game.turns;
+        r->games++;
+    }
+    return 0;
+}
+
+static int writeKingdom(long unit, void *result, void *ctx) {
+    struct sweep *s = ctx;
+    struct sweepProgress *pr = s->progress;
+    struct sweepResult *r = result;
+    int k[10];
+    int i;
+    time_t now;
+
+    kingdomFromIndex(unit, k);
+    fprintf(s->out, "%ld", unit);
+    for (i = 0; i < 10; i++) {
+        fprintf(s->out, " %d", k[i]);
+    }
+    fprintf(s->out, " %d", r->games);
+    for (i = 0; i < s->numPlayers; i++) {
+        fprintf(s->out, " %d", r->wins[i]);
+        pr->wins[i] += r->wins[i];
+    }
+    fprintf(s->out, " %d", r->ties);
+    for (i = 0; i < s->numPlayers; i++) {
+        fprintf(s->out, " %.2f", (double)r->scoreSum[i] / r->games);
+    }
+    fprintf(s->out, " %.2f\n", (double)r->turns / r->games);
+    fflush(s->out);
+
+    markDone(s, unit);
+    pr->ties += r->ties;
+    pr->games += r->games;
+    pr->completed++;
+    pr->outputSize = ftell(s->out);
+    s->playedThisRun++;
+
+    if (s->checkpoint != NULL && checkpointDue(s->checkpoint)) {
+        checkpointWrite(s->checkpoint, s->progress, s->progressSize);
+    }
+
+    now = time(NULL);
+    if (now - s->reported >= 10) {
+        s->reported = now;
+        printf("%ld/%ld kingdoms done, %.1f/s\n", pr->completed, s->count,
+               s->playedThisRun / (double)(now > s->started ? now - s->started : 1));
+        fflush(stdout);
+    }
+    return 0;
+}
+
+//everything a kingdom's result depends on
+static void unitKey(struct sweep *s, long unit, struct cacheKey *key) {
+    int k[10];
+    int i;
+
+    kingdomFromIndex(unit, k);
+    cacheKeyInit(key, "sweep");
+    cacheKeyAddString(key, s->botList);
+    for (i = 0; i < s->numPlayers; i++) {
+        cacheKeyAddString(key, s->bots[i]->definition != NULL ? s->bots[i]->definition : "");
+    }
+    cacheKeyAddInt(key, s->numPlayers);
+    cacheKeyAdd(key, k, sizeof(k));
+    cacheKeyAddInt(key, s->seed);
+    cacheKeyAddInt(key, unit);
+    cacheKeyAddInt(key, s->games);
+}
+
+static long nextKingdom(void *ctx) {
+    struct sweep *s = ctx;
+    struct sweepResult r;
+    struct cacheKey key;
+    long unit;
+
+    while (s->cursor < s->first + s->count) {
+        unit = s->cursor++;
+        if (isDone(s, unit))
+            continue;
+        if (s->cache != NULL) {
+            unitKey(s, unit, &key);
+            if (cacheGet(s->cache, &key, &r)) {
+                writeKingdom(unit, &r, s);
+                s->fromCache++;
+                continue;
+            }
+        }
+        return unit;
+    }
+    return -1;
+}
+
+static int collectKingdom(long unit, void *result, void *ctx) {
+    struct sweep *s = ctx;
+    struct cacheKey key;
+
+    if (s->cache != NULL) {
+        unitKey(s, unit, &key);
+        cachePut(s->cache, &key, result);
+    }
+    return writeKingdom(unit, result, s);
+}
+
+//header line identifying the run; a resumed run must match it
+static void formatHeader(struct sweep *s, char *line, size_t size) {
+    snprintf(line, size, "# sweep bots=%s games=%d seed=%d first=%ld count=%ld\n",
+             s->botList, s->games, s->seed, s->first, s->count);
+}
+
+//load the checkpoint and cut the output back to what it covers; returns
+//1 if resuming, 0 if starting fresh, -1 if the files do not belong together
+static int resume(struct sweep *s, const char *outPath, const char *ckptPath) {
+    char header[256];
+    struct stat st;
+    int loaded;
+
+    formatHeader(s, header, sizeof(header));
+    loaded = checkpointLoad(ckptPath, s->progress, s->progressSize);
+    if (loaded < 0 || (loaded == 1 && strcmp(s->progress->header, header) != 0)) {
+        fprintf(stderr, "%s does not belong to this sweep\n", ckptPath);
+        return -1;
+    }
+    if (loaded == 0) {
+        memset(s->progress, 0, s->progressSize);
+        strcpy(s->progress->header, header);
+        return 0;
+    }
+
+    if (stat(outPath, &st) < 0 || st.st_size < s->progress->outputSize ||
+            truncate(outPath, s->progress->outputSize) < 0) {
+        fprintf(stderr, "%s is shorter than %s says; cannot resume\n", outPath, ckptPath);
+        return -1;
+    }
+    printf("resuming: %ld kingdoms already done\n", s->progress->completed);
+    return 1;
+}
+
+int main(int argc, char** argv) {
+    struct sweep s;
+    struct runner r;
+    const char *outPath = "sweep.out";
+    const char *cachePath = NULL;
+    char ckptPath[1024];
+    char list[128];
+    char *name;
+    int interval = 60;
+    int i, resumed, failed;
+
+    memset(&s, 0, sizeof(s));
+    strcpy(s.botList, "bigmoney,smithy");
+    s.games = 10;
+    s.seed = 1;
+    s.first = 0;
+    s.count = kingdomCount();
+    memset(&r, 0, sizeof(r));
+    r.workers = runnerDefaultWorkers();
+
+    for (i = 1; i + 1 < argc; i += 2) {
+        if (strcmp(argv[i], "-bots") == 0)
+            snprintf(s.botList, sizeof(s.botList), "%s", argv[i + 1]);
+        else if (strcmp(argv[i], "-games") == 0)
+            s.games = atoi(argv[i + 1]);
+        else if (strcmp(argv[i], "-seed") == 0)
+            s.seed = atoi(argv[i + 1]);
+        else if (strcmp(argv[i], "-workers") == 0)
+            r.workers = atoi(argv[i + 1]);
+        else if (strcmp(argv[i], "-first") == 0)
+            s.first = atol(argv[i + 1]);
+        else if (strcmp(argv[i], "-count") == 0)
+            s.count = atol(argv[i + 1]);
+        else if (strcmp(argv[i], "-out") == 0)
+            outPath = argv[i + 1];
+        else if (strcmp(argv[i], "-interval") == 0)
+            interval = atoi(argv[i + 1]);
+        else if (strcmp(argv[i], "-cache") == 0)
+            cachePath = argv[i + 1];
+        else
+            break;
+    }
+    if (i < argc || s.games < 1 || s.first < 0 || s.count < 1 ||
+            s.first + s.count > kingdomCount()) {
+        printf("Usage: sweep [-bots a,b[,c,d]] [-games n] [-seed n] [-workers n]\n"
+               "             [-first index] [-count n] [-out file] [-interval secs]\n"
+               "             [-cache file]\n"
+               "bots: %s\n", simBotNames());
+        return 1;
+    }
+
+    //bot list, one bot per player
+    strcpy(list, s.botList);
+    for (name = strtok(list, ","); name != NULL; name = strtok(NULL, ",")) {
+        if (s.numPlayers == MAX_PLAYERS || (s.bots[s.numPlayers] = simFindBot(name)) == NULL) {
+            printf("unknown bot or too many bots: %s (bots: %s)\n", name, simBotNames());
+            return 1;
+        }
+        s.numPlayers++;
+    }
+    if (s.numPlayers < 2) {
+        printf("need at least 2 bots\n");
+        return 1;
+    }
+
+    s.progressSize = sizeof(struct sweepProgress) + s.count / 8 + 1;
+    s.progress = calloc(1, s.progressSize);
+    if (s.progress == NULL) {
+        return 1;
+    }
+    s.done = (unsigned char*)(s.progress + 1);
+
+    snprintf(ckptPath, sizeof(ckptPath), "%s.ckpt", outPath);
+    resumed = resume(&s, outPath, ckptPath);
+    if (resumed < 0) {
+        return 1;
+    }
+    s.out = fopen(outPath, resumed ? "a" : "w");
+    if (s.out == NULL) {
+        perror(outPath);
+        return 1;
+    }
+    if (!resumed) {
+        fputs(s.progress->header, s.out);
+        fflush(s.out);
+        s.progress->outputSize = ftell(s.out);
+    }
+
+    if (cachePath != NULL) {
+        s.cache = cacheOpen(cachePath, sizeof(struct sweepResult), 2 * kingdomCount());
+        if (s.cache == NULL) {
+            return 1;
+        }
+    }
+
+    s.checkpoint = checkpointOpen(ckptPath, interval);
+    if (s.checkpoint != NULL) {
+        //outputSize must never count lines a crash could lose
+        checkpointSyncFirst(s.checkpoint, fileno(s.out));
+    }
+    s.cursor = s.first;
+    s.started = s.reported = time(NULL);
+    r.inflight = 2;
+    r.resultSize = sizeof(struct sweepResult);
+    r.next = nextKingdom;
+    r.work = playKingdom;
+    r.collect = collectKingdom;
+    r.ctx = &s;
+
+    failed = runnerRun(&r) < 0;
+    cacheClose(s.cache);
+
+    //final snapshot covers every kingdom collected, even after a failure;
+    //the output stays open until it has been synced for it
+    if (s.checkpoint != NULL) {
+        checkpointWrite(s.checkpoint, s.progress, s.progressSize);
+        failed |= checkpointClose(s.checkpoint) < 0;
+    }
+    failed |= fclose(s.out) != 0;
+    if (failed) {
+        printf("sweep failed; rerun to resume\n");
+        return 1;
+    }
+
+    printf("%ld kingdoms, %ld games, outright wins:", s.progress->completed, s.progress->games);
+    for (i = 0; i < s.numPlayers; i++) {
+        printf(" %s %ld", s.bots[i]->name, s.progress->wins[i]);
+    }
+    printf(", ties %ld\n", s.progress->ties);
+    if (cachePath != NULL) {
+        printf("%ld kingdoms from %s\n", s.fromCache, cachePath);
+    }
+    free(s.progress);
+    return 0;
+}
@@ -0,0 +1,151 @@
+#include "dominion.h"
+#include "dominion_helpers.h"
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <assert.h>
+#include "rngs.h"
+#include "decide.h"
+
+#define NOISY_TEST 1
+
+//cards dealt into test hands: the kingdom cards played first, then
+//treasures and victory cards; minion is left out, its engine code is
+//called with the wrong arguments and reads out of bounds
+static int handCards[] = {feast, mine, remodel, baron, steward, ambassador, embargo,
+                          salvager, smithy, copper, silver, gold, estate, duchy, curse};
+
+#define HAND_CARDS ((int)(sizeof(handCards) / sizeof(handCards[0])))
+
+//a hand of up to 7 cards with the card to play at pos
+void dealHand(struct gameState *G, int card, int *pos) {
+    int player = whoseTurn(G);
+    int i;
+
+    G->handCount[player] = 1 + floor(Random() * 7);
+    for (i = 0; i < G->handCount[player]; i++) {
+        G->hand[player][i] = handCards[(int)floor(Random() * HAND_CARDS)];
+    }
+    *pos = floor(Random() * G->handCount[player]);
+    G->hand[player][*pos] = card;
+    G->numActions = 1;
+    updateCoins(player, G, 0);
+    stateHashReset(G);
+}
+
+//playCard's choices for the answers, by what the engine does with them;
+//written apart from decide.c so that its index handling is checked
+void choicesFor(int card, const int answer[3], int steps, int choice[3]) {
+    choice[0] = choice[1] = choice[2] = -1;
+    memcpy(choice, answer, steps * sizeof(int));
+    //steward's second card is looked up after the first was trashed,
+    //and cards after it have moved down one
+    if (card == steward && steps == 3 && answer[2] > answer[1])
+        choice[2] = answer[2] - 1;
+    //salvager trashes nothing for 0, so position 0 is never asked for
+    if (card == salvager && answer[0] == -1)
+        choice[0] = 0;
+}
+
+int main () {
+
+    int n, i, pos, card, seed, steps, count, r1, r2;
+    int k[10] = {feast, mine, remodel, baron, minion, steward, ambassador, embargo,
+                 salvager, smithy};
+    int answer[3], choice[3], options[MAX_HAND + treasure_map + 2];
+    int stewardTrash = 0, salvagerNone = 0, refused = 0, played = 0;
+    struct gameState start, G, T;
+    struct playFrame f;
+
+    printf ("Testing playBegin and playResume.\n");
+
+    printf ("RANDOM TESTS.\n");
+
+    SelectStream(2);
+    PutSeed(5);
+
+    for (n = 0; n < 9000; n++) {
+        seed = floor(Random() * 100000) + 1;
+        memset(&start, 0, sizeof(struct gameState));
+        assert(initializeGame(2, k, seed, &start) == 0);
+        SelectStream(2);
+        //supply piles run low as the game goes on
+        for (i = 0; i < 10; i++) {
+            if (Random() < 0.5)
+                start.supplyCount[k[i]] = floor(Random() * 3);
+        }
+        card = handCards[(int)floor(Random() * 9)];
+        dealHand(&start, card, &pos);
+        memcpy(&G, &start, sizeof(struct gameState));
+        memcpy(&T, &start, sizeof(struct gameState));
+
+        //one decision at a time, with random legal answers
+        SelectStream(1);
+        PutSeed(seed);
+        r1 = playBegin(&f, pos, &T);
+        if (r1 == -1) {
+            if (NOISY_TEST && memcmp(&T, &start, sizeof(struct gameState)) != 0) {
+                printf("seed %d: refused %d at %d changed the state\n", seed, card, pos);
+            }
+            assert(memcmp(&T, &start, sizeof(struct gameState)) == 0);
+            refused++;
+            SelectStream(2);
+            continue;
+        }
+        for (steps = 0; r1 == PLAY_DECIDE; steps++) {
+            SelectStream(2);
+            count = decisionOptions(&f.request, &T, options, sizeof(options) / sizeof(options[0]));
+            assert(count > 0);
+            answer[steps] = options[(int)floor(Random() * count)];
+            SelectStream(1);
+            r1 = playResume(&f, answer[steps], &T);
+        }
+        if (card == steward && steps == 3)
+            stewardTrash++;
+        if (card == salvager && answer[0] == -1)
+            salvagerNone++;
+
+        //the same play all at once
+        choicesFor(card, answer, steps, choice);
+        SelectStream(1);
+        PutSeed(seed);
+        r2 = playCard(pos, choice[0], choice[1], choice[2], &G);
+        SelectStream(2);
+
+        if (NOISY_TEST && (r1 != r2 || memcmp(&G, &T, sizeof(struct gameState)) != 0)) {
+            printf("seed %d: card %d at %d with %d %d %d: playCard %d, playResume %d\n",
+                   seed, card, pos, choice[0], choice[1], choice[2], r2, r1);
+        }
+        assert(r1 == r2);
+        assert(memcmp(&G, &T, sizeof(struct gameState)) == 0);
+        played++;
+    }
+    printf("%d plays, %d refused, %d steward trashes, %d salvagers trashing nothing\n",
+           played, refused, stewardTrash, salvagerNone);
+    assert(stewardTrash > 0 && salvagerNone > 0 && refused > 0);
+
+    printf ("REFUSED PLAY TESTS.\n");
+
+    //mine without another treasure, gardens and a treasure are not played,
+    //wherever they are in the hand
+    memset(&start, 0, sizeof(struct gameState));
+    assert(initializeGame(2, k, 1, &start) == 0);
+    for (pos = 0; pos < 3; pos++) {
+        for (i = 0; i < 3; i++) {
+            start.hand[0][i] = estate;
+        }
+        start.handCount[0] = 3;
+        for (card = 0; card < 3; card++) {
+            start.hand[0][pos] = card == 0 ? mine : card == 1 ? gardens : copper;
+            stateHashReset(&start);
+            memcpy(&T, &start, sizeof(struct gameState));
+            assert(playBegin(&f, pos, &T) == -1);
+            assert(memcmp(&T, &start, sizeof(struct gameState)) == 0);
+        }
+    }
+
+    printf ("ALL TESTS OK\n");
+
+    exit(0);
+}
@@ -0,0 +1,228 @@
+#include "dominion.h"
+#include "dominion_helpers.h"
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <assert.h>
+#include "rngs.h"
+#include "statekey.h"
+#include "zones.h"
+
+#define NOISY_TEST 1
+
+//the kept hash must match one computed from scratch
+int checkHash(struct gameState *G, const char *after) {
+    if (NOISY_TEST && stateHash(G) != stateHashRecompute(G)) {
+        printf("hash wrong after %s (player %d, deck order %d)\n", after, whoseTurn(G), G->hashDeckOrder);
+    }
+    assert(stateHash(G) == stateHashRecompute(G));
+    return 0;
+}
+
+//a random action from the hand with random choices; only cards whose
+//engine code cannot loop or write out of bounds
+int randomPlay(struct gameState *G) {
+    int player = whoseTurn(G);
+    int pos = floor(Random() * G->handCount[player]);
+    int card = handCard(pos, G);
+    int other = floor(Random() * G->handCount[player]);
+    int third = floor(Random() * G->handCount[player]);
+
+    //the engine plays whatever was left in an empty hand
+    if (G->handCount[player] == 0)
+        return -1;
+    switch (card) {
+    case remodel:
+    case mine:
+        return playCard(pos, other, floor(Random() * (gold + 1)), -1, G);
+    case steward:
+        if (G->handCount[player] < 3)
+            return -1;
+        return playCard(pos, floor(Random() * 3) + 1, other, third, G);
+    case embargo:
+        return playCard(pos, floor(Random() * (treasure_map + 1)), -1, -1, G);
+    case salvager:
+        return playCard(pos, other, -1, -1, G);
+    case adventurer:
+    case council_room:
+    case smithy:
+    case village:
+    case great_hall:
+    case cutpurse:
+        return playCard(pos, -1, -1, -1, G);
+    }
+    return -1;
+}
+
+//reverse a pile in place; a different order of the same cards
+void reversePile(int *cards, int count) {
+    int i, t;
+
+    for (i = 0; i < count / 2; i++) {
+        t = cards[i];
+        cards[i] = cards[count - 1 - i];
+        cards[count - 1 - i] = t;
+    }
+}
+
+//the same cards in every pile, in the same order
+int samePiles(struct gameState *G, struct gameState *T) {
+    int p;
+
+    for (p = 0; p < G->numPlayers; p++) {
+        if (G->handCount[p] != T->handCount[p] || G->deckCount[p] != T->deckCount[p] ||
+                G->discardCount[p] != T->discardCount[p] ||
+                memcmp(G->hand[p], T->hand[p], G->handCount[p] * sizeof(int)) != 0 ||
+                memcmp(G->deck[p], T->deck[p], G->deckCount[p] * sizeof(int)) != 0 ||
+                memcmp(G->discard[p], T->discard[p], G->discardCount[p] * sizeof(int)) != 0)
+            return 0;
+    }
+    return G->playedCardCount == T->playedCardCount && G->trashedCardCount == T->trashedCardCount &&
+           memcmp(G->playedCards, T->playedCards, G->playedCardCount * sizeof(int)) == 0 &&
+           memcmp(G->trash, T->trash, G->trashedCardCount * sizeof(int)) == 0;
+}
+
+int main () {
+
+    int n, i, turn, seed, ordered;
+    int k[10] = {adventurer, council_room, smithy, village, great_hall,
+                 cutpurse, embargo, salvager, steward, remodel
+                };
+    unsigned long long before;
+    unsigned char key[STATE_KEY_MAX], other[STATE_KEY_MAX];
+    int length;
+    struct keySet *set = keySetNew(0);
+    struct zoneState *z, *b;
+    struct zoneStats zs;
+    struct gameState G, T;
+    struct gameTemplate tmpl;
+
+    printf ("Testing stateHash.\n");
+
+    printf ("RANDOM TESTS.\n");
+
+    SelectStream(2);
+    PutSeed(3);
+
+    for (n = 0; n < 1000; n++) {
+        seed = floor(Random() * 100000) + 1;
+        ordered = n % 2;
+
+        memset(&G, 0, sizeof(struct gameState));
+        assert(initializeGame(2 + n % 3, k, seed, &G) == 0);
+        checkHash(&G, "initializeGame");
+        stateHashDeckOrder(&G, ordered);
+        checkHash(&G, "stateHashDeckOrder");
+
+        for (turn = 0; turn < 60 && !isGameOver(&G); turn++) {
+            for (i = 0; i < 3; i++) {
+                SelectStream(2);
+                if (randomPlay(&G) == 0)
+                    checkHash(&G, "playCard");
+            }
+            SelectStream(2);
+            for (i = 0; i < 2; i++) {
+                buyCard(floor(Random() * (treasure_map + 1)), &G);
+                checkHash(&G, "buyCard");
+            }
+            endTurn(&G);
+            checkHash(&G, "endTurn");
+        }
+
+        //the deck order only counts when asked for
+        memcpy(&T, &G, sizeof(struct gameState));
+        before = stateHash(&T);
+        if (T.deckCount[0] > 1) {
+            shuffle(0, &T);
+            checkHash(&T, "shuffle");
+            if (!ordered)
+                assert(stateHash(&T) == before);
+        }
+
+        //keys see the same positions as the hash
+        memcpy(&T, &G, sizeof(struct gameState));
+        for (i = 0; i < T.numPlayers; i++) {
+            reversePile(T.hand[i], T.handCount[i]);
+            reversePile(T.discard[i], T.discardCount[i]);
+            reversePile(T.deck[i], T.deckCount[i]);
+        }
+        stateHashReset(&T);
+        length = stateKey(&G, key);
+        assert(length > 0 && stateKey(&T, other) > 0);
+        assert((stateKey(&T, other) == length && memcmp(key, other, length) == 0) ==
+               (stateHash(&T) == stateHash(&G)));
+        assert(keySetAdd(set, key, length) == 1);
+        assert(keySetContains(set, key, length));
+        assert(keySetAdd(set, other, stateKey(&T, other)) == (stateHash(&T) != stateHash(&G)));
+
+        //zone states give the position back, and a changed branch leaves
+        //the state it came from alone
+        z = zoneCapture(&G, NULL);
+        assert(z != NULL);
+        memset(&T, 0, sizeof(struct gameState));
+        zoneRestore(z, &T);
+        assert(samePiles(&G, &T) && stateHash(&T) == stateHash(&G));
+        checkHash(&T, "zoneRestore");
+        b = zoneBranch(z);
+        assert(zoneSetCard(b, ZONE_DECK(0), 0, curse) == (G.deckCount[0] > 0 ? 0 : -1));
+        zoneRestore(b, &T);
+        checkHash(&T, "zoneSetCard");
+        zoneRestore(z, &T);
+        assert(samePiles(&G, &T));
+        zoneFree(b);
+        endTurn(&T);
+        b = zoneCapture(&T, z);
+        zoneFree(z);
+        memset(&G, 0, sizeof(struct gameState));
+        zoneRestore(b, &G);
+        assert(samePiles(&G, &T) && stateHash(&G) == stateHash(&T));
+        zoneFree(b);
+
+        SelectStream(2);
+    }
+
+    printf ("SAME POSITION TESTS.\n");
+
+    //cards in other places of the same piles, and one card moved away
+    //and back, hash the same
+    memset(&G, 0, sizeof(struct gameState));
+    assert(initializeGame(2, k, 7, &G) == 0);
+    memcpy(&T, &G, sizeof(struct gameState));
+    i = T.hand[0][0];
+    T.hand[0][0] = T.hand[0][4];
+    T.hand[0][4] = i;
+    stateHashReset(&T);
+    assert(stateHash(&T) == stateHash(&G));
+    gainCard(silver, &T, 0, 1);
+    assert(stateHash(&T) != stateHash(&G));
+    T.discardCount[1]--;
+    T.supplyCount[silver]++;
+    stateHashReset(&T);
+    assert(stateHash(&T) == stateHash(&G));
+    T.coins++;
+    assert(stateHash(&T) != stateHash(&G));
+    length = stateKey(&G, key);
+    assert(stateKey(&T, other) != length || memcmp(key, other, length) != 0);
+
+    printf ("UNZEROED STATE TESTS.\n");
+
+    //the initializers set everything the hash covers, whatever was left
+    //in the state before
+    memset(&T, 0x41, sizeof(struct gameState));
+    assert(initializeGame(2, k, 7, &T) == 0);
+    checkHash(&T, "initializeGame");
+    assert(stateHash(&T) == stateHash(&G));
+    assert(initializeGameTemplate(2, k, &tmpl) == 0);
+    memset(&T, 0x41, sizeof(struct gameState));
+    assert(initializeGameFromTemplate(&tmpl, 7, &T) == 0);
+    checkHash(&T, "initializeGameFromTemplate");
+
+    keySetFree(set);
+    zoneGetStats(&zs);
+    assert(zs.states == 0 && zs.chunks == 0 && zs.bytes == 0);
+
+    printf ("ALL TESTS OK\n");
+
+    exit(0);
+}
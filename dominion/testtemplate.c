@@ -0,0 +1,152 @@
+#include "dominion.h"
+#include "dominion_helpers.h"
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <assert.h>
+#include "rngs.h"
+#include "buyplan.h"
+
+#define NOISY_TEST 1
+
+static int testBuyValue(int card, void *ctx) {
+    (void)ctx;
+    return card == province ? 100 : card == gold ? 30 : card == silver ? 10 : 0;
+}
+
+//compare everything initializeGame sets up
+int checkSameStart(struct gameState *a, struct gameState *b) {
+    int p;
+
+    assert(a->numPlayers == b->numPlayers);
+    assert(memcmp(a->supplyCount, b->supplyCount, sizeof(a->supplyCount)) == 0);
+    assert(memcmp(a->embargoTokens, b->embargoTokens, sizeof(a->embargoTokens)) == 0);
+    assert(a->outpostPlayed == b->outpostPlayed);
+    assert(a->phase == b->phase);
+    assert(a->numActions == b->numActions);
+    assert(a->numBuys == b->numBuys);
+    assert(a->coins == b->coins);
+    assert(a->whoseTurn == b->whoseTurn);
+    assert(a->trashedCardCount == b->trashedCardCount);
+
+    for (p = 0; p < a->numPlayers; p++) {
+        assert(a->handCount[p] == b->handCount[p]);
+        assert(a->deckCount[p] == b->deckCount[p]);
+        assert(a->discardCount[p] == b->discardCount[p]);
+        assert(memcmp(a->hand[p], b->hand[p], sizeof(int) * a->handCount[p]) == 0);
+        assert(memcmp(a->deck[p], b->deck[p], sizeof(int) * a->deckCount[p]) == 0);
+    }
+    assert(stateHash(a) == stateHash(b));
+    return 0;
+}
+
+int main () {
+
+    int n, i, players, seed, r1, r2;
+    int k[10];
+    struct gameState G, T;
+    struct gameTemplate tmpl, four;
+    struct buyTable table;
+    const struct buyPlan *plan;
+    struct buyPlan bought;
+
+    printf ("Testing initializeGameFromTemplate.\n");
+
+    printf ("RANDOM TESTS.\n");
+
+    SelectStream(2);
+    PutSeed(3);
+
+    for (n = 0; n < 2000; n++) {
+        players = floor(Random() * 5) + 1; //includes invalid counts
+        for (i = 0; i < 10; i++) {
+            k[i] = adventurer + floor(Random() * (treasure_map - adventurer + 1));
+        }
+        seed = floor(Random() * 100000) + 1;
+
+        memset(&G, 0, sizeof(struct gameState));
+        memset(&T, 0, sizeof(struct gameState));
+        r1 = initializeGame(players, k, seed, &G);
+        r2 = initializeGameTemplate(players, k, &tmpl);
+        if (r2 == 0) {
+            r2 = initializeGameFromTemplate(&tmpl, seed, &T);
+        }
+
+        if (NOISY_TEST && r1 != r2) {
+            printf("players %d seed %d: initializeGame %d, template %d\n", players, seed, r1, r2);
+        }
+        assert(r1 == r2);
+        if (r1 == 0) {
+            checkSameStart(&G, &T);
+        }
+
+        SelectStream(2);
+    }
+
+    printf ("PLAYER STREAM TESTS.\n");
+
+    //with per-player streams a seat's deal does not depend on the others
+    fillKingdomCards(k, adventurer, council_room, feast, gardens, mine,
+                     remodel, smithy, village, baron, great_hall);
+    assert(initializeGameTemplate(2, k, &tmpl) == 0);
+    assert(initializeGameTemplate(4, k, &four) == 0);
+    tmpl.playerStreams = 1;
+    four.playerStreams = 1;
+
+    for (seed = 1; seed <= 500; seed++) {
+        memset(&G, 0, sizeof(struct gameState));
+        memset(&T, 0, sizeof(struct gameState));
+        assert(initializeGameFromTemplate(&tmpl, seed, &G) == 0);
+        assert(initializeGameFromTemplate(&four, seed, &T) == 0);
+
+        for (i = 0; i < 2; i++) {
+            if (NOISY_TEST && memcmp(G.deck[i], T.deck[i], sizeof(int) * G.deckCount[i]) != 0) {
+                printf("seed %d: player %d deck differs between 2 and 4 players\n", seed, i);
+            }
+            assert(G.deckCount[i] == T.deckCount[i]);
+            assert(memcmp(G.deck[i], T.deck[i], sizeof(int) * G.deckCount[i]) == 0);
+        }
+        assert(memcmp(G.hand[0], T.hand[0], sizeof(int) * 5) == 0);
+    }
+
+    printf ("BUY TABLE TESTS.\n");
+
+    buyTableBuild(&table, tmpl.supplyCount, testBuyValue, NULL);
+    plan = buyTableLookup(&table, 8, 1);
+    assert(plan->count == 1 && plan->cards[0] == province);
+    plan = buyTableLookup(&table, 11, 2);
+    assert(plan->count == 2 && plan->value == 110 && plan->cost == 11);
+    plan = buyTableLookup(&table, 2, 1);
+    assert(plan->count == 0);
+    //more coins and buys than the table holds are planned at its edge
+    assert(buyTableLookup(&table, 100, 9) == buyTableLookup(&table, BUY_MAX_COINS, BUY_MAX_BUYS));
+
+    //a pile run short makes the plan be worked out from the supply
+    memset(&G, 0, sizeof(struct gameState));
+    assert(initializeGameFromTemplate(&tmpl, 1, &G) == 0);
+    assert(buyTablePlan(&table, &G, 16, 2, &bought) == 1);
+    assert(bought.count == 2 && bought.value == 200);
+    G.supplyCount[province] = 1;
+    assert(buyTablePlan(&table, &G, 16, 2, &bought) == 0);
+    assert(bought.count == 2 && bought.value == 130 && bought.cost == 14);
+
+    //tables are kept per kingdom, whatever the number of players
+    assert(buyTableFor(&G, testBuyValue, NULL) != NULL);
+    memset(&T, 0, sizeof(struct gameState));
+    assert(initializeGameFromTemplate(&four, 1, &T) == 0);
+    assert(buyTableFor(&G, testBuyValue, NULL) == buyTableFor(&T, testBuyValue, NULL));
+
+    //only the last few are kept
+    for (i = 0; i < BUY_KEPT_TABLES; i++) {
+        assert(buyTableFor(&G, testBuyValue, k + i) != NULL);
+    }
+    assert(buyTableFor(&G, testBuyValue, k) != NULL);
+    plan = buyTableLookup(buyTableFor(&G, testBuyValue, NULL), 8, 1);
+    assert(plan->count == 1 && plan->cards[0] == province);
+    buyTableForget();
+
+    printf ("ALL TESTS OK\n");
+
+    exit(0);
+}
@@ -0,0 +1,782 @@
+/* Round-robin bot tournament.
+
+   Every pair of the given bots plays -games two-player games on one
+   kingdom, seats alternating, in work units of -batch games sharded
+   across worker processes.  Per-pair totals are printed at the end.
+
+   Progress (units done and the per-pair totals so far) is checkpointed
+   to -checkpoint every -interval seconds and at the end.  Game seeds only
+   depend on -seed, the unit and the game number, so a run resumed from a
+   checkpoint plays exactly the games that are missing and ends with the
+   same totals as an uninterrupted run.
+
+   A pair's seeds depend on the two bots' names rather than on where they
+   are in -bots, so with -cache (see cache.h) a batch already played for
+   the same pair, kingdom and seeds in any earlier run is taken from the
+   cache instead of being played again.
+
+   With -paired 1 the pair is evaluated with common random numbers: each
+   of the -games seeds is dealt once per seating, every player shuffling
+   from their own rngs.c stream (see gameTemplate), so both bots get the
+   same cards in the same seats and seat order and shuffle luck mostly
+   cancel out.  Confidence intervals are then taken over the per-seed
+   differences, and "x" is how many independent games each game played
+   was worth ("-" when the deals did not vary at all, as for a bot
+   against itself).
+
+   With -sprt d each pair is a sequential probability ratio test instead
+   of a fixed match: after every batch two tests are updated, "A scores
+   0.5 + d" and "B scores 0.5 + d" each against "they are even", at
+   error rates -alpha and -beta, and the pair stops being scheduled once
+   one bot is shown better or both tests find them within d.  -games is
+   then the most a pair may play.  The tests only ever see a pair's
+   batches in order, so the verdict and the games used are the same for
+   any number of workers, with or without resuming.
+
+   With -race o1,o2,... the -bots are candidates raced against that
+   opponent pool instead of a round robin.  Round r gives every remaining
+   candidate -batch << r deals against each opponent in total, the
+   rounds doubling like successive halving, and at the end of a round
+   every candidate whose score is below the leader's beyond their joint
+   confidence bounds is dropped (-alpha, Bonferroni-corrected over the
+   candidates).  The race ends when one candidate is left or the next
+   round would pass -games, and prints the candidates ranked, with
+   intervals.  Rounds end only when all their batches are in, so the
+   eliminations are the same for any number of workers.
+
+   Usage: tournament [-bots a,b,...] [-games n] [-batch n] [-seed n]
+                     [-workers n] [-kingdom k1,..,k10] [-paired 0|1]
+                     [-sprt d] [-alpha a] [-beta b] [-race o1,o2,...]
+                     [-checkpoint file] [-interval secs] [-cache file] */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include "dominion.h"
+#include "cache.h"
+#include "checkpoint.h"
+#include "runner.h"
+#include "sim.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define MAX_BOTS 64
+#define MAX_PAIRS (MAX_BOTS * (MAX_BOTS - 1) / 2)
+
+//totals for one pair; "a" is the bot first by name.  A deal is one seed,
+//played once per seating in paired mode and once otherwise; points are
+//A's in half points (2 for a win, 1 for a tie), kept as integers so that
+//totals do not depend on the order units are collected in
+struct pairStats {
+    long games;
+    long winsA;
+    long winsB;
+    long ties;
+    long scoreA;
+    long scoreB;
+    long turns;
+    long deals;
+    long gamePointsSq;  //sum over games of points^2
+    long dealPoints;    //sum over deals of the deal's points
+    long dealPointsSq;
+    long dealDiff;      //sum over deals of A's score minus B's
+    long dealDiffSq;
+};
+
+#define SPRT_RUNNING 0
+#define SPRT_ACCEPT 1   //the bot is better by d
+#define SPRT_REJECT -1  //it is not
+
+//everything a resumed run needs; followed by the unit results (with
+//-sprt) and the done bitmap
+struct tournamentProgress {
+    char config[2048];
+    long completed;
+    struct pairStats pair[MAX_PAIRS];   //with -sprt, of the batches tested
+    long tested[MAX_PAIRS];             //batches the tests have seen
+    int testA[MAX_PAIRS];               //"A is better", SPRT_*
+    int testB[MAX_PAIRS];
+    int round;                          //race round being played
+    int raceOver;
+    int out[MAX_BOTS];                  //round + 1 a candidate was dropped in
+};
+
+struct tournament {
+    struct simBot *bots[MAX_BOTS];     //with -race, candidates then opponents
+    int numBots;
+    int numCandidates;                  //0 for a round robin
+    int pairA[MAX_PAIRS];
+    int pairB[MAX_PAIRS];
+    long pairId[MAX_PAIRS];     //seed stream of the pair
+    int numPairs;
+    int kingdom[10];
+    struct gameTemplate tmpl;
+    int games;
+    int batch;
+    int seed;
+    int paired;
+    double sprt;        //0 for a fixed match
+    double alpha;
+    double beta;
+    long blocks;        //units per pair
+    long units;
+    long cursor;
+    struct tournamentProgress *progress;
+    struct pairStats *results;  //every unit's result, with -sprt
+    unsigned char *done;
+    size_t progressSize;
+    struct checkpointWriter *checkpoint;
+    struct resultCache *cache;
+    long fromCache;
+};
+
+static int isDone(struct tournament *t, long unit) {
+    return (t->done[unit / 8] >> (unit % 8)) & 1;
+}
+
+//units go round the pairs, so all pairs progress together
+static int unitPair(struct tournament *t, long unit) {
+    return (int)(unit % t->numPairs);
+}
+
+static long unitBlock(struct tournament *t, long unit) {
+    return unit / t->numPairs;
+}
+
+//games first .. last - 1 of the unit's pair
+static void unitGames(struct tournament *t, long unit, int *first, int *last) {
+    *first = (int)(unitBlock(t, unit) * t->batch);
+    *last = *first + t->batch < t->games ? *first + t->batch : t->games;
+}
+
+static int playUnit(long unit, void *out, void *ctx) {
+    struct tournament *t = ctx;
+    struct pairStats *r = out;
+    struct simBot *seats[2];
+    struct simResult game;
+    int pair = unitPair(t, unit);
+    int g, first, last, aSeat, seed, points, dealPoints, dealDiff;
+
+    unitGames(t, unit, &first, &last);
+
+    for (g = first; g < last; g++) {
+        seed = simSeed(t->seed, t->pairId[pair], g);
+        dealPoints = 0;
+        dealDiff = 0;
+
+        //unpaired deals alternate seats from one deal to the next
+        for (aSeat = t->paired ? 0 : g % 2; aSeat < (t->paired ? 2 : g % 2 + 1); aSeat++) {
+            seats[aSeat] = t->bots[t->pairA[pair]];
+            seats[1 - aSeat] = t->bots[t->pairB[pair]];
+            if (simPlayGame(&t->tmpl, seed, seats, &game) < 0) {
+                return -1;
+            }
+
+            if (game.winner[aSeat] && game.winner[1 - aSeat]) {
+                r->ties++;
+                points = 1;
+            } else if (game.winner[aSeat]) {
+                r->winsA++;
+                points = 2;
+            } else {
+                r->winsB++;
+                points = 0;
+            }
+            r->scoreA += game.score[aSeat];
+            r->scoreB += game.score[1 - aSeat];
+            r->turns += game.turns;
+            r->games++;
+            r->gamePointsSq += points * points;
+            dealPoints += points;
+            dealDiff += game.score[aSeat] - game.score[1 - aSeat];
+        }
+
+        r->deals++;
+        r->dealPoints += dealPoints;
+        r->dealPointsSq += dealPoints * dealPoints;
+        r->dealDiff += dealDiff;
+        r->dealDiffSq += (long)dealDiff * dealDiff;
+    }
+    return 0;
+}
+
+static void addStats(struct pairStats *p, struct pairStats *r) {
+    p->games += r->games;
+    p->winsA += r->winsA;
+    p->winsB += r->winsB;
+    p->ties += r->ties;
+    p->scoreA += r->scoreA;
+    p->scoreB += r->scoreB;
+    p->turns += r->turns;
+    p->deals += r->deals;
+    p->gamePointsSq += r->gamePointsSq;
+    p->dealPoints += r->dealPoints;
+    p->dealPointsSq += r->dealPointsSq;
+    p->dealDiff += r->dealDiff;
+    p->dealDiffSq += r->dealDiffSq;
+}
+
+//race pairs are candidate-major: pair = candidate * opponents + opponent
+static int raceOpponents(struct tournament *t) {
+    return t->numBots - t->numCandidates;
+}
+
+static int decided(struct tournament *t, int pair) {
+    int a = t->progress->testA[pair];
+    int b = t->progress->testB[pair];
+
+    if (t->numCandidates > 0)
+        return t->progress->raceOver || t->progress->out[pair / raceOpponents(t)];
+    return t->sprt > 0 && (a == SPRT_ACCEPT || b == SPRT_ACCEPT ||
+                           (a == SPRT_REJECT && b == SPRT_REJECT));
+}
+
+//log-likelihood ratio of A scoring p1 rather than p0 per game, from the
+//normal approximation to the per-deal score so it holds for paired deals
+static double llr(struct tournament *t, struct pairStats *p, double p0, double p1) {
+    int k = t->paired ? 2 : 1;
+    double mean = p->dealPoints / (2.0 * k * p->deals);
+    double var = p->dealPointsSq / (4.0 * k * k * p->deals) - mean * mean;
+
+    //a pair that always ends the same way is decided by its mean alone
+    if (var < 1e-9)
+        var = 1e-9;
+    return p->deals * (p1 - p0) * (2 * mean - p0 - p1) / (2 * var);
+}
+
+static void updateTest(int *test, double ratio, double lower, double upper) {
+    if (*test != SPRT_RUNNING)
+        return;
+    if (ratio >= upper)
+        *test = SPRT_ACCEPT;
+    else if (ratio <= lower)
+        *test = SPRT_REJECT;
+}
+
+//feed the pair's next batches to its tests for as long as they are in
+static void runTests(struct tournament *t, int pair) {
+    struct tournamentProgress *pr = t->progress;
+    struct pairStats *p = &pr->pair[pair];
+    double lower = log(t->beta / (1 - t->alpha));
+    double upper = log((1 - t->beta) / t->alpha);
+    long unit;
+
+    while (!decided(t, pair) && pr->tested[pair] < t->blocks) {
+        unit = pr->tested[pair] * t->numPairs + pair;
+        if (!isDone(t, unit))
+            break;
+        addStats(p, &t->results[unit]);
+        pr->tested[pair]++;
+        updateTest(&pr->testA[pair], llr(t, p, 0.5, 0.5 + t->sprt), lower, upper);
+        updateTest(&pr->testB[pair], llr(t, p, 0.5, 0.5 - t->sprt), lower, upper);
+    }
+}
+
+//blocks per pair played by the end of the current race round
+static long raceLimit(struct tournament *t) {
+    long limit = 1L << (t->progress->round < 30 ? t->progress->round : 30);
+    return limit < t->blocks ? limit : t->blocks;
+}
+
+//candidate's score over the opponent pool, and the variance of that mean
+static void candidateScore(struct tournament *t, int c, double *mean, double *var) {
+    int k = t->paired ? 2 : 1;
+    int m = raceOpponents(t);
+    struct pairStats *p;
+    double rate, v;
+    int o;
+
+    *mean = *var = 0;
+    for (o = 0; o < m; o++) {
+        p = &t->progress->pair[c * m + o];
+        rate = p->dealPoints / (2.0 * k * p->deals);
+        v = p->dealPointsSq / (4.0 * k * k * p->deals) - rate * rate;
+        *mean += rate / m;
+        *var += (p->deals > 1 ? v / (p->deals - 1) : 0.25) / ((double)m * m);
+    }
+}
+
+//two-sided normal quantile for error rate a, by bisection on erfc
+static double zFor(double a) {
+    double lo = 0, hi = 10, mid;
+    int i;
+
+    for (i = 0; i < 60; i++) {
+        mid = (lo + hi) / 2;
+        if (erfc(mid / sqrt(2)) > a)
+            lo = mid;
+        else
+            hi = mid;
+    }
+    return hi;
+}
+
+static double raceZ(struct tournament *t) {
+    return zFor(t->alpha / t->numCandidates);
+}
+
+//end every race round whose batches are all in
+static void raceAdvance(struct tournament *t) {
+    struct tournamentProgress *pr = t->progress;
+    double mean[MAX_BOTS], var[MAX_BOTS];
+    double z = raceZ(t);
+    long limit, block;
+    int c, o, best, alive;
+    int m = raceOpponents(t);
+
+    while (!pr->raceOver) {
+        limit = raceLimit(t);
+        for (c = 0; c < t->numCandidates; c++) {
+            if (pr->out[c])
+                continue;
+            for (o = 0; o < m; o++) {
+                for (block = 0; block < limit; block++) {
+                    if (!isDone(t, block * t->numPairs + c * m + o))
+                        return;
+                }
+            }
+        }
+
+        best = -1;
+        for (c = 0; c < t->numCandidates; c++) {
+            if (pr->out[c])
+                continue;
+            candidateScore(t, c, &mean[c], &var[c]);
+            if (best < 0 || mean[c] > mean[best])
+                best = c;
+        }
+        alive = 0;
+        for (c = 0; c < t->numCandidates; c++) {
+            if (pr->out[c])
+                continue;
+            if (mean[c] + z * sqrt(var[c]) < mean[best] - z * sqrt(var[best]))
+                pr->out[c] = pr->round + 1;
+            else
+                alive++;
+        }
+
+        if (alive <= 1 || limit == t->blocks)
+            pr->raceOver = 1;
+        else
+            pr->round++;
+    }
+}
+
+static int addUnit(long unit, void *result, void *ctx) {
+    struct tournament *t = ctx;
+    struct pairStats *r = result;
+    int pair = unitPair(t, unit);
+
+    t->done[unit / 8] |= 1 << (unit % 8);
+    t->progress->completed++;
+    if (t->sprt > 0) {
+        t->results[unit] = *r;
+        runTests(t, pair);
+    } else {
+        addStats(&t->progress->pair[pair], r);
+    }
+    if (t->numCandidates > 0) {
+        raceAdvance(t);
+    }
+
+    if (t->checkpoint != NULL && checkpointDue(t->checkpoint)) {
+        checkpointWrite(t->checkpoint, t->progress, t->progressSize);
+    }
+    return 0;
+}
+
+static void cacheKeyAddBot(struct cacheKey *key, struct simBot *bot) {
+    cacheKeyAddString(key, bot->name);
+    cacheKeyAddString(key, bot->definition != NULL ? bot->definition : "");
+}
+
+//everything a unit's result depends on
+static void unitKey(struct tournament *t, long unit, struct cacheKey *key) {
+    int pair = unitPair(t, unit);
+    int first, last;
+
+    unitGames(t, unit, &first, &last);
+    cacheKeyInit(key, t->paired ? "tournament-paired" : "tournament");
+    cacheKeyAddBot(key, t->bots[t->pairA[pair]]);
+    cacheKeyAddBot(key, t->bots[t->pairB[pair]]);
+    cacheKeyAddInt(key, 2);
+    cacheKeyAdd(key, t->kingdom, sizeof(t->kingdom));
+    cacheKeyAddInt(key, t->seed);
+    cacheKeyAddInt(key, first);
+    cacheKeyAddInt(key, last);
+}
+
+static long nextUnit(void *ctx) {
+    struct tournament *t = ctx;
+    struct pairStats r;
+    struct cacheKey key;
+    long unit;
+
+    while (t->cursor < t->units) {
+        //the next race round starts once this one's results are all in
+        if (t->numCandidates > 0 && !t->progress->raceOver &&
+                unitBlock(t, t->cursor) >= raceLimit(t))
+            return -1;
+        unit = t->cursor++;
+        if (isDone(t, unit) || decided(t, unitPair(t, unit)))
+            continue;
+        if (t->cache != NULL) {
+            unitKey(t, unit, &key);
+            if (cacheGet(t->cache, &key, &r)) {
+                addUnit(unit, &r, t);
+                t->fromCache++;
+                continue;
+            }
+        }
+        return unit;
+    }
+    return -1;
+}
+
+static int collectUnit(long unit, void *result, void *ctx) {
+    struct tournament *t = ctx;
+    struct cacheKey key;
+
+    if (t->cache != NULL) {
+        unitKey(t, unit, &key);
+        cachePut(t->cache, &key, result);
+    }
+    return addUnit(unit, result, t);
+}
+
+//mean and 95% half width of sum / n over n samples with sum of squares sq
+static void meanInterval(double sum, double sq, long n, double *mean, double *half) {
+    double var;
+
+    *mean = sum / n;
+    var = n > 1 ? (sq - sum * sum / n) / (n - 1) : 0;
+    *half = 1.96 * sqrt(var > 0 ? var / n : 0);
+}
+
+static const char* verdict(struct tournament *t, int pair) {
+    if (t->progress->testA[pair] == SPRT_ACCEPT)
+        return "A better";
+    if (t->progress->testB[pair] == SPRT_ACCEPT)
+        return "B better";
+    if (decided(t, pair))
+        return "even";
+    return "undecided";
+}
+
+static void printRace(struct tournament *t) {
+    struct tournamentProgress *pr = t->progress;
+    double mean[MAX_BOTS], var[MAX_BOTS];
+    double z = raceZ(t);
+    int order[MAX_BOTS];
+    int c, i, j, tmp, a, b, m = raceOpponents(t);
+    long games, played = 0;
+
+    for (c = 0; c < t->numCandidates; c++) {
+        candidateScore(t, c, &mean[c], &var[c]);
+        order[c] = c;
+    }
+    //survivors first, then by the round dropped in, then by score
+    for (i = 1; i < t->numCandidates; i++) {
+        for (j = i; j > 0; j--) {
+            a = order[j - 1];
+            b = order[j];
+            if ((pr->out[a] == 0 ? 1000 : pr->out[a]) > (pr->out[b] == 0 ? 1000 : pr->out[b]) ||
+                    ((pr->out[a] == pr->out[b]) && mean[a] >= mean[b]))
+                break;
+            tmp = order[j - 1];
+            order[j - 1] = order[j];
+            order[j] = tmp;
+        }
+    }
+
+    printf("%4s %-16s %8s %18s  %s\n", "rank", "candidate", "games", "score% (race CI)", "status");
+    for (i = 0; i < t->numCandidates; i++) {
+        c = order[i];
+        games = 0;
+        for (j = 0; j < m; j++) {
+            games += pr->pair[c * m + j].games;
+        }
+        played += games;
+        printf("%4d %-16s %8ld %8.1f +-%6.1f  ", i + 1, t->bots[c]->name, games,
+               100 * mean[c], 100 * z * sqrt(var[c]));
+        if (pr->out[c])
+            printf("dropped after round %d\n", pr->out[c]);
+        else
+            printf("%s\n", pr->raceOver ? "in final" : "racing");
+    }
+    printf("race against");
+    for (j = 0; j < m; j++) {
+        printf(" %s", t->bots[t->numCandidates + j]->name);
+    }
+    printf(": %d rounds, %ld games, full evaluation %ld\n", pr->round + 1, played,
+           (long)t->games * (t->paired ? 2 : 1) * t->numPairs);
+}
+
+static void printResults(struct tournament *t) {
+    struct pairStats *p;
+    double rate, half, diff, diffHalf, gameVar;
+    char x[16];
+    int k = t->paired ? 2 : 1;     //games per deal
+    long used = 0, played = 0;
+    int i;
+
+    printf("%-12s %-12s %8s %8s %8s %6s %14s %15s %5s%s\n", "bot A", "bot B", "games",
+           "A wins", "B wins", "ties", "A win% (95%)", "A-B score", "x",
+           t->sprt > 0 ? "  verdict" : "");
+    for (i = 0; i < t->numPairs; i++) {
+        p = &t->progress->pair[i];
+        if (p->games == 0)
+            continue;
+
+        //ties count half a win; the interval is over deals
+        meanInterval(p->dealPoints / (2.0 * k), p->dealPointsSq / (4.0 * k * k), p->deals,
+                     &rate, &half);
+        meanInterval((double)p->dealDiff / k, (double)p->dealDiffSq / (k * k), p->deals,
+                     &diff, &diffHalf);
+
+        //variance of the same number of independent games over the actual
+        //one; with no variance over deals there is no ratio to show
+        gameVar = p->gamePointsSq / (4.0 * p->games) - rate * rate;
+        if (half > 0)
+            snprintf(x, sizeof(x), "%5.1f", gameVar / p->games / (half * half / (1.96 * 1.96)));
+        else
+            snprintf(x, sizeof(x), "%5s", "-");
+
+        printf("%-12s %-12s %8ld %8ld %8ld %6ld %6.1f +-%5.1f %7.2f +-%5.2f %s%s%s\n",
+               t->bots[t->pairA[i]]->name, t->bots[t->pairB[i]]->name, p->games,
+               p->winsA, p->winsB, p->ties, 100 * rate, 100 * half, diff, diffHalf, x,
+               t->sprt > 0 ? "  " : "", t->sprt > 0 ? verdict(t, i) : "");
+        used += p->games;
+    }
+
+    if (t->sprt > 0) {
+        //batches already running when their pair was decided are wasted
+        for (i = 0; i < t->units; i++) {
+            if (isDone(t, i))
+                played += t->results[i].games;
+        }
+        printf("sprt d=%.3f alpha=%.3f beta=%.3f: tests used %ld games, %ld played, "
+               "fixed match %ld\n", t->sprt, t->alpha, t->beta, used, played,
+               (long)t->games * k * t->numPairs);
+    }
+}
+
+//FNV-1a of "a,b"; seeds must not change with the engine build
+static long pairId(const char *a, const char *b) {
+    unsigned long long h = 14695981039346656037ULL;
+    char names[128];
+    int i;
+
+    snprintf(names, sizeof(names), "%s,%s", a, b);
+    for (i = 0; names[i] != '\0'; i++) {
+        h = (h ^ (unsigned char)names[i]) * 1099511628211ULL;
+    }
+    return (long)(h >> 1);
+}
+
+static int addBots(struct tournament *t, const char *names) {
+    char list[1024];
+    char *name;
+
+    snprintf(list, sizeof(list), "%s", names);
+    for (name = strtok(list, ","); name != NULL; name = strtok(NULL, ",")) {
+        if (t->numBots == MAX_BOTS || (t->bots[t->numBots] = simFindBot(name)) == NULL) {
+            printf("unknown bot or too many bots: %s (bots: %s)\n", name, simBotNames());
+            return -1;
+        }
+        t->numBots++;
+    }
+    return 0;
+}
+
+static void addPair(struct tournament *t, int a, int b) {
+    t->pairA[t->numPairs] = a;
+    t->pairB[t->numPairs] = b;
+    t->pairId[t->numPairs] = pairId(t->bots[a]->name, t->bots[b]->name);
+    t->numPairs++;
+}
+
+static int parseKingdom(const char *arg, int k[10]) {
+    char copy[256];
+    char *tok;
+    int n = 0;
+
+    snprintf(copy, sizeof(copy), "%s", arg);
+    for (tok = strtok(copy, ","); tok != NULL; tok = strtok(NULL, ",")) {
+        if (n == 10)
+            return -1;
+        k[n++] = atoi(tok);
+    }
+    return n == 10 ? 0 : -1;
+}
+
+int main(int argc, char** argv) {
+    static struct tournament t;
+    struct runner r;
+    const char *botList = "bigmoney,smithy,council,village";
+    const char *ckptPath = "tournament.ckpt";
+    const char *cachePath = NULL;
+    const char *raceList = NULL;
+    int defaultKingdom[10] = {adventurer, gardens, embargo, village, minion, mine,
+                              cutpurse, sea_hag, tribute, smithy
+                             };
+    int interval = 60;
+    int i, j, loaded, failed;
+
+    memset(&r, 0, sizeof(r));
+    r.workers = runnerDefaultWorkers();
+    memcpy(t.kingdom, defaultKingdom, sizeof(defaultKingdom));
+    t.games = 1000;
+    t.batch = 100;
+    t.seed = 1;
+    t.alpha = 0.05;
+    t.beta = 0.05;
+
+    for (i = 1; i + 1 < argc; i += 2) {
+        if (strcmp(argv[i], "-bots") == 0)
+            botList = argv[i + 1];
+        else if (strcmp(argv[i], "-games") == 0)
+            t.games = atoi(argv[i + 1]);
+        else if (strcmp(argv[i], "-batch") == 0)
+            t.batch = atoi(argv[i + 1]);
+        else if (strcmp(argv[i], "-seed") == 0)
+            t.seed = atoi(argv[i + 1]);
+        else if (strcmp(argv[i], "-workers") == 0)
+            r.workers = atoi(argv[i + 1]);
+        else if (strcmp(argv[i], "-kingdom") == 0 && parseKingdom(argv[i + 1], t.kingdom) == 0)
+            ;
+        else if (strcmp(argv[i], "-checkpoint") == 0)
+            ckptPath = argv[i + 1];
+        else if (strcmp(argv[i], "-interval") == 0)
+            interval = atoi(argv[i + 1]);
+        else if (strcmp(argv[i], "-cache") == 0)
+            cachePath = argv[i + 1];
+        else if (strcmp(argv[i], "-paired") == 0)
+            t.paired = atoi(argv[i + 1]) != 0;
+        else if (strcmp(argv[i], "-sprt") == 0)
+            t.sprt = atof(argv[i + 1]);
+        else if (strcmp(argv[i], "-alpha") == 0)
+            t.alpha = atof(argv[i + 1]);
+        else if (strcmp(argv[i], "-beta") == 0)
+            t.beta = atof(argv[i + 1]);
+        else if (strcmp(argv[i], "-race") == 0)
+            raceList = argv[i + 1];
+        else
+            break;
+    }
+    if (i < argc || t.games < 1 || t.batch < 1 || t.sprt < 0 || t.sprt >= 0.5 ||
+            t.alpha <= 0 || t.alpha >= 0.5 || t.beta <= 0 || t.beta >= 0.5 ||
+            (raceList != NULL && t.sprt > 0) ||
+            initializeGameTemplate(2, t.kingdom, &t.tmpl) < 0) {
+        printf("Usage: tournament [-bots a,b,...] [-games n] [-batch n] [-seed n]\n"
+               "                  [-workers n] [-kingdom k1,..,k10] [-paired 0|1]\n"
+               "                  [-sprt d] [-alpha a] [-beta b] [-race o1,o2,...]\n"
+               "                  [-checkpoint file] [-interval secs] [-cache file]\n"
+               "bots: %s\n", simBotNames());
+        return 1;
+    }
+
+    t.tmpl.playerStreams = t.paired;
+
+    if (addBots(&t, botList) < 0) {
+        return 1;
+    }
+    if (raceList != NULL) {
+        //every candidate against every opponent, the candidate as A
+        t.numCandidates = t.numBots;
+        if (addBots(&t, raceList) < 0) {
+            return 1;
+        }
+        for (i = 0; i < t.numCandidates; i++) {
+            for (j = t.numCandidates; j < t.numBots; j++) {
+                addPair(&t, i, j);
+            }
+        }
+    } else {
+        for (i = 0; i < t.numBots; i++) {
+            for (j = i + 1; j < t.numBots; j++) {
+                //bot A is the one first by name, whatever the order in -bots
+                if (strcmp(t.bots[i]->name, t.bots[j]->name) <= 0)
+                    addPair(&t, i, j);
+                else
+                    addPair(&t, j, i);
+            }
+        }
+    }
+    if (t.numPairs == 0) {
+        printf("need at least 2 bots\n");
+        return 1;
+    }
+
+    t.blocks = (t.games + t.batch - 1) / t.batch;
+    t.units = t.blocks * t.numPairs;
+    t.progressSize = sizeof(struct tournamentProgress) + t.units / 8 + 1;
+    if (t.sprt > 0) {
+        t.progressSize += t.units * sizeof(struct pairStats);
+    }
+    t.progress = calloc(1, t.progressSize);
+    if (t.progress == NULL) {
+        return 1;
+    }
+    t.results = (struct pairStats*)(t.progress + 1);
+    t.done = (unsigned char*)(t.sprt > 0 ? t.results + t.units : t.results);
+
+    //a checkpoint only resumes the run it was written by
+    snprintf(t.progress->config, sizeof(t.progress->config),
+             "bots=%s race=%s games=%d batch=%d seed=%d paired=%d sprt=%g,%g,%g "
+             "kingdom=%d,%d,%d,%d,%d,%d,%d,%d,%d,%d",
+             botList, raceList != NULL ? raceList : "", t.games, t.batch, t.seed, t.paired,
+             t.sprt, t.alpha, t.beta, t.kingdom[0], t.kingdom[1], t.kingdom[2],
+             t.kingdom[3], t.kingdom[4], t.kingdom[5], t.kingdom[6], t.kingdom[7],
+             t.kingdom[8], t.kingdom[9]);
+    {
+        struct tournamentProgress *saved = calloc(1, t.progressSize);
+        loaded = saved == NULL ? -1 : checkpointLoad(ckptPath, saved, t.progressSize);
+        if (loaded < 0 || (loaded == 1 && strcmp(saved->config, t.progress->config) != 0)) {
+            fprintf(stderr, "%s does not belong to this tournament\n", ckptPath);
+            return 1;
+        }
+        if (loaded == 1) {
+            memcpy(t.progress, saved, t.progressSize);
+            printf("resuming: %ld of %ld units already done\n", t.progress->completed, t.units);
+        }
+        free(saved);
+    }
+
+    if (cachePath != NULL) {
+        t.cache = cacheOpen(cachePath, sizeof(struct pairStats), 1 << 16);
+        if (t.cache == NULL) {
+            return 1;
+        }
+    }
+
+    t.checkpoint = checkpointOpen(ckptPath, interval);
+    r.inflight = 2;
+    r.resultSize = sizeof(struct pairStats);
+    r.next = nextUnit;
+    r.work = playUnit;
+    r.collect = collectUnit;
+    r.ctx = &t;
+
+    failed = runnerRun(&r) < 0;
+    cacheClose(t.cache);
+    if (t.checkpoint != NULL) {
+        checkpointWrite(t.checkpoint, t.progress, t.progressSize);
+        failed |= checkpointClose(t.checkpoint) < 0;
+    }
+    if (failed) {
+        printf("tournament failed; rerun to resume\n");
+        return 1;
+    }
+
+    if (t.numCandidates > 0)
+        printRace(&t);
+    else
+        printResults(&t);
+    if (cachePath != NULL) {
+        printf("%ld of %ld units from %s\n", t.fromCache, t.units, cachePath);
+    }
+    free(t.progress);
+    return 0;
+}
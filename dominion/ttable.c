@@ -0,0 +1,169 @@
+#define _GNU_SOURCE
+
+#include "ttable.h"
+#include <string.h>
+#include <sys/mman.h>
+
+//an entry's data word: value in the low half, then visits, depth and the
+//generation that stored it
+#define DATA_VALUE(d) ((int)(unsigned int)(d))
+#define DATA_VISITS(d) ((int)((d) >> 32 & 0xffff))
+#define DATA_DEPTH(d) ((int)((d) >> 48 & 0xff))
+#define DATA_GENERATION(d) ((unsigned int)((d) >> 56))
+
+struct ttSlot {
+    unsigned long long check;   //key ^ data; both zero for an empty slot
+    unsigned long long data;
+};
+
+struct ttBucket {
+    struct ttSlot slot[TT_BUCKET_ENTRIES];
+} __attribute__((aligned(64)));
+
+struct ttable {
+    unsigned long long mask;
+    size_t bytes;
+    unsigned int generation;
+    struct ttStats counts __attribute__((aligned(64)));
+    struct ttBucket buckets[] __attribute__((aligned(64)));
+};
+
+//probe and store counts are kept per thread and added to the shared
+//counters by ttCount, so they cost no shared cache line writes
+static __thread struct ttable *pendingTable;
+static __thread struct ttStats pending;
+
+static void flushPending(void) {
+    if (pendingTable != NULL) {
+        __atomic_fetch_add(&pendingTable->counts.probes, pending.probes, __ATOMIC_RELAXED);
+        __atomic_fetch_add(&pendingTable->counts.hits, pending.hits, __ATOMIC_RELAXED);
+        __atomic_fetch_add(&pendingTable->counts.stores, pending.stores, __ATOMIC_RELAXED);
+        __atomic_fetch_add(&pendingTable->counts.replaced, pending.replaced, __ATOMIC_RELAXED);
+    }
+    memset(&pending, 0, sizeof(pending));
+    pendingTable = NULL;
+}
+
+static struct ttStats* counts(struct ttable *tt) {
+    if (pendingTable != tt) {
+        flushPending();
+        pendingTable = tt;
+    }
+    return &pending;
+}
+
+struct ttable* ttNew(int log2Buckets) {
+    struct ttable *tt;
+    size_t bytes;
+
+    if (log2Buckets < 1 || log2Buckets > 30)
+        return NULL;
+    bytes = sizeof(struct ttable) + ((size_t)1 << log2Buckets) * sizeof(struct ttBucket);
+    //anonymous shared memory is zeroed, which is an empty table
+    tt = mmap(NULL, bytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (tt == MAP_FAILED)
+        return NULL;
+    tt->mask = ((unsigned long long)1 << log2Buckets) - 1;
+    tt->bytes = bytes;
+    return tt;
+}
+
+void ttFree(struct ttable *tt) {
+    if (tt == NULL)
+        return;
+    if (pendingTable == tt) {
+        memset(&pending, 0, sizeof(pending));
+        pendingTable = NULL;
+    }
+    munmap(tt, tt->bytes);
+}
+
+int ttProbe(struct ttable *tt, unsigned long long key, struct ttEntry *entry) {
+    struct ttBucket *b = &tt->buckets[key & tt->mask];
+    unsigned long long check, data;
+    int i;
+
+    counts(tt)->probes++;
+    for (i = 0; i < TT_BUCKET_ENTRIES; i++) {
+        check = __atomic_load_n(&b->slot[i].check, __ATOMIC_RELAXED);
+        data = __atomic_load_n(&b->slot[i].data, __ATOMIC_RELAXED);
+        if ((check ^ data) == key && (check | data) != 0) {
+            entry->value = DATA_VALUE(data);
+            entry->visits = DATA_VISITS(data);
+            entry->depth = DATA_DEPTH(data);
+            pending.hits++;
+            return 1;
+        }
+    }
+    return 0;
+}
+
+//lower is replaced first: entries of older searches, then shallow ones,
+//then rarely visited ones
+static unsigned int keepScore(unsigned long long data, unsigned int generation) {
+    return (DATA_GENERATION(data) == generation) << 24 | DATA_DEPTH(data) << 16 | DATA_VISITS(data);
+}
+
+void ttStore(struct ttable *tt, unsigned long long key, const struct ttEntry *entry) {
+    struct ttBucket *b = &tt->buckets[key & tt->mask];
+    unsigned int generation = __atomic_load_n(&tt->generation, __ATOMIC_RELAXED) & 0xff;
+    unsigned long long check, data, newData;
+    unsigned int score, lowest = ~0u;
+    int i, victim = 0, replacing = 1;
+
+    for (i = 0; i < TT_BUCKET_ENTRIES; i++) {
+        check = __atomic_load_n(&b->slot[i].check, __ATOMIC_RELAXED);
+        data = __atomic_load_n(&b->slot[i].data, __ATOMIC_RELAXED);
+        if ((check | data) == 0 || (check ^ data) == key) {
+            victim = i;
+            replacing = 0;
+            break;
+        }
+        score = keepScore(data, generation);
+        if (score < lowest) {
+            lowest = score;
+            victim = i;
+        }
+    }
+    counts(tt)->stores++;
+    if (replacing)
+        pending.replaced++;
+
+    newData = (unsigned long long)(unsigned int)entry->value |
+              (unsigned long long)(entry->visits > 0xffff ? 0xffff : entry->visits < 0 ? 0 : entry->visits) << 32 |
+              (unsigned long long)(entry->depth > 0xff ? 0xff : entry->depth < 0 ? 0 : entry->depth) << 48 |
+              (unsigned long long)generation << 56;
+    __atomic_store_n(&b->slot[victim].data, newData, __ATOMIC_RELAXED);
+    __atomic_store_n(&b->slot[victim].check, key ^ newData, __ATOMIC_RELAXED);
+}
+
+void ttNewGeneration(struct ttable *tt) {
+    __atomic_fetch_add(&tt->generation, 1, __ATOMIC_RELAXED);
+}
+
+void ttClear(struct ttable *tt) {
+    if (pendingTable == tt) {
+        memset(&pending, 0, sizeof(pending));
+        pendingTable = NULL;
+    }
+    memset(tt->buckets, 0, (tt->mask + 1) * sizeof(struct ttBucket));
+    memset(&tt->counts, 0, sizeof(tt->counts));
+    tt->generation = 0;
+}
+
+void ttCount(struct ttable *tt, long long nodes, long long nanoseconds) {
+    counts(tt);
+    flushPending();
+    __atomic_fetch_add(&tt->counts.nodes, nodes, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&tt->counts.nanoseconds, nanoseconds, __ATOMIC_RELAXED);
+}
+
+void ttGetStats(struct ttable *tt, struct ttStats *stats) {
+    ttCount(tt, 0, 0);
+    stats->probes = __atomic_load_n(&tt->counts.probes, __ATOMIC_RELAXED);
+    stats->hits = __atomic_load_n(&tt->counts.hits, __ATOMIC_RELAXED);
+    stats->stores = __atomic_load_n(&tt->counts.stores, __ATOMIC_RELAXED);
+    stats->replaced = __atomic_load_n(&tt->counts.replaced, __ATOMIC_RELAXED);
+    stats->nodes = __atomic_load_n(&tt->counts.nodes, __ATOMIC_RELAXED);
+    stats->nanoseconds = __atomic_load_n(&tt->counts.nanoseconds, __ATOMIC_RELAXED);
+}
@@ -0,0 +1,64 @@
+#ifndef _TTABLE_H
+#define _TTABLE_H
+
+/* Shared transposition table for tree searches over game states.
+
+   Entries are keyed by a 64-bit position hash (stateHash) and hold what a
+   search wants to keep about a position: a value, a visit count and the
+   depth it was searched to.  The table is a power of two of 64 byte
+   buckets, one cache line each, of TT_BUCKET_ENTRIES entries; a key can
+   only live in its own bucket, and storing into a full bucket replaces
+   the entry of an older search generation first, then the shallowest,
+   then the least visited.
+
+   There are no locks.  An entry is two 64-bit words written and read
+   with atomic stores and loads; the first is the key xor the second, so
+   a probe that sees half of one store and half of another fails the key
+   check and reports a miss.  The memory is mapped shared before anyone
+   forks, so worker processes (see runner.h) as well as threads see each
+   other's entries.  Two stores of one key racing may keep either. */
+
+#define TT_BUCKET_ENTRIES 4
+
+struct ttEntry {
+    int value;
+    int visits;     //saturates at 65535
+    int depth;      //0 .. 255
+};
+
+struct ttable;
+
+struct ttable* ttNew(int log2Buckets);
+/* Table of 2^log2Buckets buckets (64 bytes each), all empty; NULL if
+   out of memory or log2Buckets is not in 1 .. 30 */
+
+void ttFree(struct ttable *tt);
+
+int ttProbe(struct ttable *tt, unsigned long long key, struct ttEntry *entry);
+/* 1 and the entry if the key is in the table, else 0 */
+
+void ttStore(struct ttable *tt, unsigned long long key, const struct ttEntry *entry);
+
+void ttNewGeneration(struct ttable *tt);
+/* Start a new search; entries stored before are replaced first */
+
+void ttClear(struct ttable *tt);
+/* Empty the table and zero its counters; no one may be using it */
+
+struct ttStats {
+    long long probes;
+    long long hits;
+    long long stores;
+    long long replaced;     //stores that pushed out another key
+    long long nodes;        //positions searched, as reported by the searches
+    long long nanoseconds;  //time spent searching, likewise
+};
+/* Hit rate is hits / probes and nodes/sec is nodes * 1e9 / nanoseconds */
+
+void ttGetStats(struct ttable *tt, struct ttStats *stats);
+/* Counters summed over everyone using the table */
+
+void ttCount(struct ttable *tt, long long nodes, long long nanoseconds);
+/* Add a search's nodes and time to the table's counters */
+
+#endif
@@ -0,0 +1,223 @@
+#include "zones.h"
+#include <stdlib.h>
+#include <string.h>
+
+//the counters and supply at the start of a gameState, kept as they are
+#define ZONE_HEAD offsetof(struct gameState, hand)
+
+struct zoneChunk {
+    int refs;
+    int cards[ZONE_CHUNK];
+};
+
+struct zoneState {
+    unsigned char head[ZONE_HEAD];
+    //the fields after the piles
+    int playerStreams;
+    int hashDeckOrder;
+    unsigned long long hash;
+    int hashStale;              //a card was set since capture
+    int count[ZONE_PILES];
+    int first[ZONE_PILES + 1];  //each pile's first chunk in chunk[]
+    struct zoneChunk *chunk[];
+};
+
+static struct zoneStats stats;
+
+#define CHUNKS(count) (((count) + ZONE_CHUNK - 1) / ZONE_CHUNK)
+#define STATE_BYTES(chunks) (sizeof(struct zoneState) + (chunks) * sizeof(struct zoneChunk*))
+
+static void countState(int chunks, int sign) {
+    __atomic_fetch_add(&stats.states, sign, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&stats.bytes, sign * (long long)STATE_BYTES(chunks), __ATOMIC_RELAXED);
+}
+
+static struct zoneChunk* newChunk(const int *cards, int n) {
+    struct zoneChunk *c = malloc(sizeof(struct zoneChunk));
+
+    if (c == NULL)
+        return NULL;
+    c->refs = 1;
+    memcpy(c->cards, cards, n * sizeof(int));
+    __atomic_fetch_add(&stats.chunks, 1, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&stats.bytes, (long long)sizeof(struct zoneChunk), __ATOMIC_RELAXED);
+    __atomic_fetch_add(&stats.chunksCopied, 1, __ATOMIC_RELAXED);
+    return c;
+}
+
+static void releaseChunk(struct zoneChunk *c) {
+    if (__atomic_sub_fetch(&c->refs, 1, __ATOMIC_ACQ_REL) == 0) {
+        __atomic_fetch_sub(&stats.chunks, 1, __ATOMIC_RELAXED);
+        __atomic_fetch_sub(&stats.bytes, (long long)sizeof(struct zoneChunk), __ATOMIC_RELAXED);
+        free(c);
+    }
+}
+
+static int* pileCards(struct gameState *state, int pile, int **count) {
+    int p = pile % MAX_PLAYERS;
+
+    switch (pile / MAX_PLAYERS) {
+    case 0:
+        *count = &state->handCount[p];
+        return state->hand[p];
+    case 1:
+        *count = &state->deckCount[p];
+        return state->deck[p];
+    case 2:
+        *count = &state->discardCount[p];
+        return state->discard[p];
+    }
+    if (pile == ZONE_PLAYED) {
+        *count = &state->playedCardCount;
+        return state->playedCards;
+    }
+    *count = &state->trashedCardCount;
+    return state->trash;
+}
+
+static int pileMax(int pile) {
+    return pile < MAX_PLAYERS ? MAX_HAND : MAX_DECK;
+}
+
+//piles of players not in the game are left empty
+static int pileUsed(struct gameState *state, int pile) {
+    return pile >= ZONE_PLAYED || pile % MAX_PLAYERS < state->numPlayers;
+}
+
+struct zoneState* zoneCapture(struct gameState *state, struct zoneState *base) {
+    struct zoneState *z;
+    struct zoneChunk *c;
+    int count[ZONE_PILES];
+    int *cards, *n;
+    int pile, k, live, total, chunks = 0;
+
+    if (state->numPlayers < 1 || state->numPlayers > MAX_PLAYERS)
+        return NULL;
+    for (pile = 0; pile < ZONE_PILES; pile++) {
+        pileCards(state, pile, &n);
+        count[pile] = pileUsed(state, pile) ? *n : 0;
+        if (count[pile] < 0 || count[pile] > pileMax(pile))
+            return NULL;
+        chunks += CHUNKS(count[pile]);
+    }
+    z = malloc(STATE_BYTES(chunks));
+    if (z == NULL)
+        return NULL;
+    total = chunks;
+    memcpy(z->head, state, ZONE_HEAD);
+    z->playerStreams = state->playerStreams;
+    z->hashDeckOrder = state->hashDeckOrder;
+    z->hash = state->hash;
+    z->hashStale = 0;
+    countState(total, 1);
+
+    chunks = 0;
+    for (pile = 0; pile < ZONE_PILES; pile++) {
+        cards = pileCards(state, pile, &n);
+        z->count[pile] = count[pile];
+        z->first[pile] = chunks;
+        for (k = 0; k < CHUNKS(count[pile]); k++) {
+            live = count[pile] - k * ZONE_CHUNK < ZONE_CHUNK ? count[pile] - k * ZONE_CHUNK : ZONE_CHUNK;
+            //a chunk of base at the same place is shared if it starts
+            //with the same cards; it cannot change while it is shared
+            if (base != NULL && k < base->first[pile + 1] - base->first[pile] &&
+                    memcmp(base->chunk[base->first[pile] + k]->cards, cards + k * ZONE_CHUNK,
+                           live * sizeof(int)) == 0) {
+                c = base->chunk[base->first[pile] + k];
+                __atomic_fetch_add(&c->refs, 1, __ATOMIC_RELAXED);
+            } else if ((c = newChunk(cards + k * ZONE_CHUNK, live)) == NULL) {
+                while (chunks > 0)
+                    releaseChunk(z->chunk[--chunks]);
+                countState(total, -1);
+                free(z);
+                return NULL;
+            }
+            z->chunk[chunks++] = c;
+        }
+    }
+    z->first[ZONE_PILES] = chunks;
+    return z;
+}
+
+void zoneRestore(struct zoneState *z, struct gameState *state) {
+    int *cards, *n;
+    int pile, k, live;
+
+    memcpy(state, z->head, ZONE_HEAD);
+    state->playerStreams = z->playerStreams;
+    state->hashDeckOrder = z->hashDeckOrder;
+    for (pile = 0; pile < ZONE_PILES; pile++) {
+        cards = pileCards(state, pile, &n);
+        *n = z->count[pile];
+        for (k = 0; k * ZONE_CHUNK < z->count[pile]; k++) {
+            live = z->count[pile] - k * ZONE_CHUNK < ZONE_CHUNK ? z->count[pile] - k * ZONE_CHUNK : ZONE_CHUNK;
+            memcpy(cards + k * ZONE_CHUNK, z->chunk[z->first[pile] + k]->cards, live * sizeof(int));
+        }
+    }
+    if (z->hashStale)
+        stateHashReset(state);
+    else
+        state->hash = z->hash;
+}
+
+struct zoneState* zoneBranch(struct zoneState *z) {
+    int chunks = z->first[ZONE_PILES];
+    struct zoneState *b = malloc(STATE_BYTES(chunks));
+    int i;
+
+    if (b == NULL)
+        return NULL;
+    memcpy(b, z, STATE_BYTES(chunks));
+    for (i = 0; i < chunks; i++)
+        __atomic_fetch_add(&b->chunk[i]->refs, 1, __ATOMIC_RELAXED);
+    countState(chunks, 1);
+    return b;
+}
+
+void zoneFree(struct zoneState *z) {
+    int i;
+
+    if (z == NULL)
+        return;
+    for (i = 0; i < z->first[ZONE_PILES]; i++)
+        releaseChunk(z->chunk[i]);
+    countState(z->first[ZONE_PILES], -1);
+    free(z);
+}
+
+int zoneCount(struct zoneState *z, int pile) {
+    if (pile < 0 || pile >= ZONE_PILES)
+        return -1;
+    return z->count[pile];
+}
+
+int zoneCard(struct zoneState *z, int pile, int pos) {
+    if (pile < 0 || pile >= ZONE_PILES || pos < 0 || pos >= z->count[pile])
+        return -1;
+    return z->chunk[z->first[pile] + pos / ZONE_CHUNK]->cards[pos % ZONE_CHUNK];
+}
+
+int zoneSetCard(struct zoneState *z, int pile, int pos, int card) {
+    struct zoneChunk **c, *copy;
+
+    if (pile < 0 || pile >= ZONE_PILES || pos < 0 || pos >= z->count[pile])
+        return -1;
+    c = &z->chunk[z->first[pile] + pos / ZONE_CHUNK];
+    if (__atomic_load_n(&(*c)->refs, __ATOMIC_ACQUIRE) > 1) {
+        copy = newChunk((*c)->cards, ZONE_CHUNK);
+        if (copy == NULL)
+            return -1;
+        releaseChunk(*c);
+        *c = copy;
+    }
+    (*c)->cards[pos % ZONE_CHUNK] = card;
+    z->hashStale = 1;
+    return 0;
+}
+
+void zoneGetStats(struct zoneStats *s) {
+    s->states = __atomic_load_n(&stats.states, __ATOMIC_RELAXED);
+    s->chunks = __atomic_load_n(&stats.chunks, __ATOMIC_RELAXED);
+    s->bytes = __atomic_load_n(&stats.bytes, __ATOMIC_RELAXED);
+    s->chunksCopied = __atomic_load_n(&stats.chunksCopied, __ATOMIC_RELAXED);
+}
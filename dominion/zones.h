@@ -0,0 +1,66 @@
+#ifndef _ZONES_H
+#define _ZONES_H
+
+#include "dominion.h"
+#include <stddef.h>
+
+/* Persistent game states for search trees.
+
+   A zoneState keeps a position with its piles (hands, decks, discards,
+   played cards, trash) cut into chunks of ZONE_CHUNK cards.  Chunks are
+   never changed while more than one state holds them, so states share
+   whatever chunks they have in common: branching a state copies its
+   counters and a pointer per chunk, a few hundred bytes instead of a
+   whole gameState, and changing a card copies only the chunk it is in.
+
+   The engine still plays on gameStates: zoneRestore writes a state out,
+   and zoneCapture reads one back in, sharing every chunk that still
+   holds the same cards as the state it was restored from.  Cards past a
+   pile's count are not kept.  States may be branched and freed on any
+   thread. */
+
+#define ZONE_CHUNK 16
+
+/* Pile numbers */
+#define ZONE_HAND(player) (player)
+#define ZONE_DECK(player) (MAX_PLAYERS + (player))
+#define ZONE_DISCARD(player) (2 * MAX_PLAYERS + (player))
+#define ZONE_PLAYED (3 * MAX_PLAYERS)
+#define ZONE_TRASH (3 * MAX_PLAYERS + 1)
+#define ZONE_PILES (3 * MAX_PLAYERS + 2)
+
+struct zoneState;
+
+struct zoneState* zoneCapture(struct gameState *state, struct zoneState *base);
+/* The position in state, sharing chunks with base (NULL for none) where
+   they hold the same cards in the same place; NULL if out of memory or
+   a pile count is out of range */
+
+void zoneRestore(struct zoneState *z, struct gameState *state);
+/* Make state the position z holds */
+
+struct zoneState* zoneBranch(struct zoneState *z);
+/* A copy of z sharing all its chunks; NULL if out of memory */
+
+void zoneFree(struct zoneState *z);
+
+int zoneCount(struct zoneState *z, int pile);
+
+int zoneCard(struct zoneState *z, int pile, int pos);
+/* The card, or -1 if pos is not in the pile */
+
+int zoneSetCard(struct zoneState *z, int pile, int pos, int card);
+/* Replace a card, copying its chunk first if another state holds it;
+   -1 if pos is not in the pile or out of memory.  The state's hash is
+   recomputed when it is restored */
+
+struct zoneStats {
+    long long states;           //zoneStates alive
+    long long chunks;           //chunks alive, each counted once
+    long long bytes;            //memory held by both
+    long long chunksCopied;     //chunks made by capture and copy-on-write so far
+};
+
+void zoneGetStats(struct zoneStats *stats);
+
+#endif